@@ -0,0 +1,58 @@
+// Benchmark the startup of the service from a catalog file against the number of load threads
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "service.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+// the catalog goes to the temp directory, it takes about 40 bytes a showing
+const string CATALOG_PATH = (filesystem::temp_directory_path() / "bb_bench_catalog.csv").string();
+
+// every movie shows in this many theaters, so both the movies and the theaters are many
+constexpr size_t THEATERS_PER_MOVIE = 500;
+
+void writeCatalog(size_t showings)
+{
+    ofstream out(CATALOG_PATH, ios::binary);
+    out << "movie,theater,seats,seats_per_row\n";
+    for (size_t i = 0; i < showings; ++i) {
+        size_t movie = i / THEATERS_PER_MOVIE;
+        // spread the theaters of every movie over all of them, in no particular order
+        size_t theater = (i % THEATERS_PER_MOVIE + movie * 7919) % (showings / 20 + THEATERS_PER_MOVIE);
+        out << "Movie " << movie << ",Theater " << theater << ',' << 64 + i % 400 << ",16\n";
+    }
+}
+
+// Parse and index a catalog of the first argument showings, from scratch as on a first start,
+// with the second argument threads, all cores if 0.
+void BM_loadCatalog(benchmark::State& state)
+{
+    size_t showings = state.range(0);
+    writeCatalog(showings);
+    Service::Options options;
+    options.catalog_path = CATALOG_PATH;
+    options.load_threads = state.range(1);
+
+    for (auto _ : state) {
+        auto service = Service::create(options);
+        benchmark::DoNotOptimize(service.get());
+        // unmapping the seats is not part of the startup
+        state.PauseTiming();
+        service.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * showings);
+    filesystem::remove(CATALOG_PATH);
+}
+BENCHMARK(BM_loadCatalog)->ArgNames({"showings", "threads"})
+    ->Args({1000000, 1})->Args({1000000, 0})->Args({10000000, 1})->Args({10000000, 0})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}   // namespace
@@ -0,0 +1,131 @@
+// Benchmark the booking path under contention, on a single hot showing and over shards
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/service.cpp"
+
+namespace {
+
+/**
+ * The per-record mutex booking path GuardedRecord used before it switched to compare-and-swap,
+ * kept here as the baseline.
+ */
+class LockedRecord
+{
+    SeatMask _booked_mask;
+    mutex _m;
+
+public:
+    // the seat arena of GuardedRecord is not needed, the mask is kept in place
+    LockedRecord(const BookingRecord& record, void*) : _booked_mask(record.booked_mask) {}
+
+    bool book(SeatMask seat_mask)
+    {
+        const lock_guard<mutex> lock(_m);
+        if (_booked_mask & seat_mask) {
+            return false;
+        }
+        _booked_mask |= seat_mask;
+        return true;
+    }
+
+    void release(SeatMask seat_mask)
+    {
+        const lock_guard<mutex> lock(_m);
+        _booked_mask &= ~seat_mask;
+    }
+};
+
+const BookingRecord HOT_SHOWING = {"Opening Night", "Landmark Cinemas", NO_SEATS};
+
+// Every thread books and gives back its own seat, so each iteration is two writes to the shared
+// record. Threads beyond MAX_SEATS share seats and see some bookings fail.
+template<typename Record>
+void BM_bookContended(benchmark::State& state)
+{
+    static Record* record;
+    static GuardedRecord::Words seats(GuardedRecord::wordsFor(HOT_SHOWING.seats));
+    if (state.thread_index() == 0) {
+        record = new Record(HOT_SHOWING, seats.data());
+    }
+    const SeatMask seat = SeatMask{1} << (state.thread_index() % MAX_SEATS);
+
+    for (auto _ : state) {
+        if (record->book(seat)) {
+            record->release(seat);
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        delete record;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_bookContended, GuardedRecord)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_bookContended, LockedRecord)->ThreadRange(1, 64)->UseRealTime();
+
+// Many showings of 64 seats, a cache line each, spread over as many shards as threads.
+constexpr size_t SHOWINGS = 1 << 14;
+const BookingRecord SHOWING = {"Matinee", "Landmark Cinemas", NO_SEATS, 64, 8};
+
+// Every thread books and gives back its own seat of showings picked at random, either right
+// away on seats shared by all threads (0), or through the thread of the shard that owns the
+// showing and keeps its seats on its cores (1).
+void BM_bookSharded(benchmark::State& state)
+{
+    static unique_ptr<ShardRouter> router;
+    static vector<GuardedRecord::Words> seats;
+    const size_t shards = state.threads();
+    const size_t per_shard = SHOWINGS / shards;
+    const size_t words = GuardedRecord::wordsFor(SHOWING.seats);
+    if (state.thread_index() == 0) {
+        seats.resize(state.range(0) ? shards : 1);
+        auto allocate = [&](size_t shard) {
+            seats[shard] = GuardedRecord::Words(words * (seats.size() == 1 ? SHOWINGS : per_shard));
+            for (size_t i = 0; i < seats[shard].size(); i += words) {
+                GuardedRecord(SHOWING, seats[shard].data() + i);
+            }
+        };
+        if (state.range(0)) {
+            router = make_unique<ShardRouter>(shards);
+            router->forEach(allocate);
+        } else {
+            allocate(0);
+        }
+    }
+    const SeatMask seat = SeatMask{1} << (state.thread_index() % SHOWING.seats);
+    uint64_t random = state.thread_index() * 0x9e3779b97f4a7c15 + 1;
+
+    for (auto _ : state) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        size_t showing = random % (per_shard * shards);
+        auto book = [&](atomic<SeatSet::Word>* words) {
+            GuardedRecord record(words, SHOWING.seats, SHOWING.seats_per_row, nullptr);
+            if (record.book(seat)) {
+                record.release(seat);
+            }
+            return true;
+        };
+        if (router) {
+            size_t shard = showing / per_shard;
+            router->run(shard, [&] { return book(seats[shard].data() + showing % per_shard * words); });
+        } else {
+            book(seats[0].data() + showing * words);
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        router.reset();
+        seats.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_bookSharded)->ArgName("routed")->Arg(0)->Arg(1)->ThreadRange(1, 32)->UseRealTime();
+
+}
@@ -0,0 +1,84 @@
+// Benchmark the handlers of the busiest routes end to end, on requests made up in place of the server's
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+#include <httplib/httplib.h>
+
+#include "../src/handlers.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+// the service instance has the built-in catalog
+const string MOVIE = "Kingdom of the Planet of the Apes";
+const string THEATER = "Scotiabank IMAX";
+
+httplib::Request request(initializer_list<pair<string, string>> params)
+{
+    httplib::Request req;
+    for (auto& [name, value] : params) {
+        req.params.emplace(name, value);
+    }
+    return req;
+}
+
+/*
+ * Pull the body of @a res out of its content provider, if it has one, as the server would send
+ * it; the size of the body.
+ */
+size_t drain(httplib::Response& res)
+{
+    if (!res.content_provider_) {
+        return res.body.size();
+    }
+    size_t sent = 0;
+    bool done = false;
+    httplib::DataSink sink;
+    sink.write = [&](const char* data, size_t size) {
+        benchmark::DoNotOptimize(data);
+        sent += size;
+        return true;
+    };
+    sink.is_writable = [] { return true; };
+    sink.done = [&] { done = true; };
+    while (!done && (res.is_chunked_content_provider_ || sent < res.content_length_)) {
+        if (!res.content_provider_(sent, res.content_length_ - sent, sink)) {
+            break;
+        }
+    }
+    return sent;
+}
+
+void BM_handle(benchmark::State& state, void (*handler)(const httplib::Request&, httplib::Response&),
+               const httplib::Request& req)
+{
+    size_t bytes = 0;
+    for (auto _ : state) {
+        httplib::Response res;
+        handler(req, res);
+        bytes += drain(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+}
+
+// The movie and theater pages, with the seat map of a showing of 480 seats. Pages are cached
+// until a booking changes them, so they are rendered once and then sent out of the cache.
+BENCHMARK_CAPTURE(BM_handle, getMovie, getMovie, request({}));
+BENCHMARK_CAPTURE(BM_handle, getMovieSeatMap, getMovie, request({{"name", MOVIE}, {"theater", THEATER}}));
+BENCHMARK_CAPTURE(BM_handle, getTheater, getTheater, request({}));
+BENCHMARK_CAPTURE(BM_handle, getTheaterSeatMap, getTheater, request({{"name", THEATER}, {"movie", MOVIE}}));
+
+// The same as JSON.
+BENCHMARK_CAPTURE(BM_handle, getApiMovies, getApiMovies, request({}));
+BENCHMARK_CAPTURE(BM_handle, getApiTheaters, getApiTheaters, request({{"movie", MOVIE}}));
+BENCHMARK_CAPTURE(BM_handle, getApiSeats, getApiSeats, request({{"movie", MOVIE}, {"theater", THEATER}}));
+
+// A booking of a seat that is taken after the first iteration, which is what most bookings of
+// a popular showing end up as: the request parsed, the showing looked up, and a conflict answered.
+BENCHMARK_CAPTURE(BM_handle, postBookTaken, postBook, request({{"movie", MOVIE}, {"theater", THEATER}, {"seats", "100"}}));
+
+}   // namespace
@@ -0,0 +1,168 @@
+// Benchmark rendering a page with the HTML builders, counting heap allocations per page
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/html.h"
+
+using namespace std;
+using namespace bb;
+
+static atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+/**
+ * The std::function taggers html.h used before the builders became plain structs, kept here
+ * as the baseline.
+ */
+namespace tagger {
+
+using ostream = std::ostream;
+using tagger = std::function<ostream&(ostream&)>;
+
+inline ostream& operator<<(ostream& out, const tagger& t)
+{
+    return t(out);
+}
+
+template<typename T>
+void do_echo_(ostream& out, T t)
+{
+    out << t;
+}
+
+template<typename T, typename... Tail>
+void do_echo_(ostream& out, T t, Tail... tail)
+{
+    out << t;
+    do_echo_(out, tail...);
+}
+
+template<typename T, typename... Tail>
+tagger echo(T t, Tail... tail)
+{
+    return [=](ostream& out) -> ostream& {
+        do_echo_(out, t, tail...);
+        return out;
+    };
+}
+
+template<typename T, typename U>
+tagger attr(T name, U value)
+{
+    return echo(' ', name, "=\"", value, '"');
+}
+
+template<typename T, typename U, typename V>
+tagger tag(T name, U attributes, V content)
+{
+    return echo('<', name, attributes, '>', content, "</", name, '>');
+}
+
+template<typename T, typename U>
+tagger tag(T name, U content)
+{
+    return tag(name, "", content);
+}
+
+template<typename T, typename U>
+tagger a(T href, U content)
+{
+    return tag("a", attr("href", href), content);
+}
+
+template<typename T>
+tagger li(bool selected, T content)
+{
+    return echo(selected ? "<li class=\"selected\">" : "<li>", content, "</li>");
+}
+
+}   // namespace tagger
+
+const vector<string> MOVIES = {
+    "Back to Black", "Furiosa: A Mad Max Saga", "Garfield Movie, The", "IF",
+    "Kingdom of the Planet of the Apes", "Bad Boys: Ride or Die", "Inside Out 2",
+    "Challengers", "Fall Guy, The", "Civil War", "Dune: Part Two", "Godzilla x Kong",
+};
+
+// the movie list of the front page, the bulk of what getMovie renders
+template<typename Out>
+void renderTagger(Out& out, const string& selected)
+{
+    using namespace tagger;
+    out << tag("h1", echo("Movies showing ", tag("span", selected)));
+    for (auto& movie : MOVIES) {
+        out << li(movie == selected, a(echo("/movie?name=", movie), movie));
+    }
+}
+
+template<typename Out>
+void renderBuilder(Out& out, const string& selected)
+{
+    out << html::tag("h1", html::echo("Movies showing ", html::tag("span", selected)));
+    for (auto& movie : MOVIES) {
+        out << html::li(movie == selected, html::a(html::echo("/movie?name=", movie), movie));
+    }
+}
+
+void reportAllocations(benchmark::State& state, size_t before)
+{
+    state.counters["allocs_per_page"] = benchmark::Counter(
+        double(allocations.load(memory_order_relaxed) - before) / state.iterations());
+}
+
+void BM_renderTagger(benchmark::State& state)
+{
+    ostringstream out;
+    size_t before = allocations.load(memory_order_relaxed);
+    for (auto _ : state) {
+        out.str("");
+        renderTagger(out, MOVIES[3]);
+        benchmark::DoNotOptimize(out);
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_renderTagger);
+
+void BM_renderBuilder(benchmark::State& state)
+{
+    html::Buffer out;
+    // the first page grows the buffer, every page after it reuses the storage
+    renderBuilder(out, MOVIES[3]);
+    size_t before = allocations.load(memory_order_relaxed);
+    for (auto _ : state) {
+        out.clear();
+        renderBuilder(out, MOVIES[3]);
+        benchmark::DoNotOptimize(out.str().data());
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_renderBuilder);
+
+}   // namespace
@@ -0,0 +1,218 @@
+// Benchmark the service calls behind every page and booking, on catalogs from the demo one to millions of showings
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "service.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+const string CATALOG_PATH = (filesystem::temp_directory_path() / "bb_bench_service.csv").string();
+
+// the showings of the built-in catalog
+constexpr size_t DEMO_SHOWINGS = 10;
+
+// every movie shows in this many theaters
+constexpr size_t THEATERS_PER_MOVIE = 50;
+
+// the showings start this far apart, one after the other
+constexpr StartTime SHOWTIME_STEP = 600;
+
+/**
+ * A service with @a showings showings of MAX_SEATS seats, or with the built-in catalog for the
+ * showings of the demo, whose showings have no time.
+ */
+unique_ptr<Service> createService(size_t showings)
+{
+    Service::Options options;
+    if (showings != DEMO_SHOWINGS) {
+        {
+            ofstream out(CATALOG_PATH, ios::binary);
+            out << "movie,theater,seats,seats_per_row,start\n";
+            size_t theaters = max(THEATERS_PER_MOVIE, showings / THEATERS_PER_MOVIE);
+            for (size_t i = 0; i < showings; ++i) {
+                size_t movie = i / THEATERS_PER_MOVIE;
+                out << "Movie " << movie << ",Theater " << (i % THEATERS_PER_MOVIE + movie) % theaters << ','
+                    << MAX_SEATS << ',' << SEATS_PER_ROW << ',' << StartTime(i) * SHOWTIME_STEP << '\n';
+            }
+        }
+        options.catalog_path = CATALOG_PATH;
+    }
+    auto service = Service::create(options);
+    filesystem::remove(CATALOG_PATH);
+    return service;
+}
+
+/**
+ * The service with @a showings showings that the read-only benchmarks share, as loading millions
+ * of showings takes a while.
+ */
+Service& sharedService(size_t showings)
+{
+    static map<size_t, unique_ptr<Service>> services;
+    auto& service = services[showings];
+    if (!service) {
+        service = createService(showings);
+    }
+    return *service;
+}
+
+/**
+ * Up to 1024 showings of @a service by their names, spread over the movies.
+ */
+vector<pair<string, string>> sampleShowings(const Service& service)
+{
+    vector<pair<string, string>> showings;
+    auto movies = service.movies();
+    size_t step = max<size_t>(1, movies.size() / 1024);
+    for (size_t i = 0; i < movies.size() && showings.size() < 1024; i += step) {
+        string movie(movies[i]);
+        for (auto theater : service.theaters(movie)) {
+            showings.emplace_back(movie, string(theater));
+            if (showings.size() % 4 == 0) {
+                break;
+            }
+        }
+    }
+    return showings;
+}
+
+void showingArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgName("showings");
+    for (size_t showings : {DEMO_SHOWINGS, size_t{10000}, size_t{1000000}}) {
+        b->Arg(showings);
+    }
+}
+
+// Every iteration books the next free seat, going through the showings a seat at a time, so
+// that with more than one thread, the threads book seats of the same showings at once. Once
+// every seat is taken, the bookings fail, which takes 64 iterations a showing.
+void BM_book(benchmark::State& state)
+{
+    static unique_ptr<Service> service;
+    static atomic<size_t> next{0};
+    const size_t showings = state.range(0);
+    if (state.thread_index() == 0) {
+        service = createService(showings);
+        next = 0;
+    }
+
+    size_t booked = 0;
+    for (auto _ : state) {
+        size_t seat = next.fetch_add(1, memory_order_relaxed);
+        booked += service->book(seat / MAX_SEATS % showings, SeatMask{1} << seat % MAX_SEATS);
+    }
+
+    state.counters["booked"] = booked;
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        service.reset();
+    }
+}
+BENCHMARK(BM_book)->Apply(showingArgs)->UseRealTime();
+BENCHMARK(BM_book)->ArgName("showings")->Arg(1000000)->ThreadRange(2, 16)->UseRealTime();
+
+// The available seats of showings by their names, as the theater page looks them up.
+void BM_availableSeats(benchmark::State& state)
+{
+    auto& service = sharedService(state.range(0));
+    auto showings = sampleShowings(service);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto& [movie, theater] = showings[i++ % showings.size()];
+        benchmark::DoNotOptimize(service.availableSeats(movie, theater));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_availableSeats)->Apply(showingArgs);
+
+// All the movies, and the theaters of one of them, as the movie page lists them.
+void BM_movies(benchmark::State& state)
+{
+    auto& service = sharedService(state.range(0));
+    auto showings = sampleShowings(service);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto movies = service.movies();
+        auto theaters = service.theaters(showings[i++ % showings.size()].first);
+        benchmark::DoNotOptimize(movies.size() + theaters.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_movies)->Apply(showingArgs);
+
+// All the theaters, and the movies showing in one of them, as the theater page lists them.
+void BM_theaters(benchmark::State& state)
+{
+    auto& service = sharedService(state.range(0));
+    auto showings = sampleShowings(service);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto theaters = service.theaters();
+        auto movies = service.movies(showings[i++ % showings.size()].second);
+        benchmark::DoNotOptimize(movies.size() + theaters.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_theaters)->Apply(showingArgs);
+
+// The showings of a movie that start in a four hour window, as the movie page lists them.
+void BM_showtimes(benchmark::State& state)
+{
+    auto& service = sharedService(state.range(0));
+    auto showings = sampleShowings(service);
+    size_t i = 0;
+    size_t listed = 0;
+
+    for (auto _ : state) {
+        auto& [movie, theater] = showings[i++ % showings.size()];
+        auto from = service.start(service.showing(movie, theater));
+        auto showtimes = service.movieShowtimes(movie, from, from + 4 * 3600);
+        listed += showtimes.size();
+        benchmark::DoNotOptimize(showtimes.size());
+    }
+    state.SetItemsProcessed(listed);
+}
+BENCHMARK(BM_showtimes)->Apply(showingArgs);
+
+// The search box as a name is typed into it, a byte at a time, and with two letters the wrong
+// way round, which only the fuzzy search finds.
+void BM_search(benchmark::State& state)
+{
+    auto& service = sharedService(state.range(0));
+    vector<string> queries;
+    for (auto& [movie, theater] : sampleShowings(service)) {
+        for (size_t n = 1; n <= movie.size(); ++n) {
+            queries.push_back(movie.substr(0, n));
+        }
+        auto typo = movie;
+        swap(typo[1], typo[2]);
+        queries.push_back(typo);
+    }
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto& query = queries[i++ % queries.size()];
+        auto movies = service.searchMovies(query, 10);
+        auto theaters = service.searchTheaters(query, 10);
+        benchmark::DoNotOptimize(movies.size() + theaters.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_search)->Apply(showingArgs);
+
+}   // namespace
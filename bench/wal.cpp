@@ -0,0 +1,47 @@
+// Benchmark the throughput of durable bookings against the group commit window of the log
+#include <filesystem>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/wal.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+// the log goes to the temp directory; point TMPDIR at the disk to measure
+const string LOG_PATH = (filesystem::temp_directory_path() / "bb_bench_wal.log").string();
+
+// a booking as ServiceImpl logs it: a movie, a theater and a few seat ranges
+const string BOOKING(64, 'b');
+
+// Every thread commits bookings one after another, as concurrent book() calls do. The first
+// argument is the group commit window in microseconds: waiting longer lets more bookings share
+// an fsync, at the cost of latency when there are only a few of them.
+void BM_commit(benchmark::State& state)
+{
+    static WriteAheadLog* log;
+    if (state.thread_index() == 0) {
+        filesystem::remove(LOG_PATH);
+        log = new WriteAheadLog(LOG_PATH, chrono::microseconds(state.range(0)));
+    }
+
+    for (auto _ : state) {
+        log->commit(BOOKING);
+    }
+
+    if (state.thread_index() == 0) {
+        state.counters["commits_per_sync"] = benchmark::Counter(
+            double(state.iterations() * state.threads()) / log->syncs());
+        delete log;
+        filesystem::remove(LOG_PATH);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_commit)->ArgName("window_us")->Arg(0)->Arg(100)->Arg(500)->Arg(2000)
+    ->ThreadRange(1, 32)->UseRealTime();
+
+}
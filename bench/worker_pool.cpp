@@ -0,0 +1,50 @@
+// Benchmark the server's worker pool against httplib's, on bursts of short tasks
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <httplib/httplib.h>
+
+#include "../src/worker_pool.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+// tasks per burst, queued all at once like the connections a burst of requests brings
+constexpr size_t BURST = 1000;
+
+// Each iteration queues a burst of tasks, each spinning for about as long as the first argument
+// says, in nanoseconds, and waits until all of them are done, on the second argument workers.
+template<typename Pool>
+void BM_burst(benchmark::State& state)
+{
+    const auto work = chrono::nanoseconds(state.range(0));
+    Pool pool(state.range(1));
+    atomic<size_t> done{0};
+
+    for (auto _ : state) {
+        done.store(0, memory_order_relaxed);
+        for (size_t i = 0; i < BURST; ++i) {
+            pool.enqueue([&] {
+                auto until = chrono::steady_clock::now() + work;
+                while (chrono::steady_clock::now() < until) {
+                }
+                done.fetch_add(1, memory_order_release);
+            });
+        }
+        while (done.load(memory_order_acquire) != BURST) {
+            this_thread::yield();
+        }
+    }
+    pool.shutdown();
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK_TEMPLATE(BM_burst, WorkerPool)->ArgNames({"work_ns", "workers"})
+    ->ArgsProduct({{0, 1000, 10000}, {1, 4, 16}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_burst, httplib::ThreadPool)->ArgNames({"work_ns", "workers"})
+    ->ArgsProduct({{0, 1000, 10000}, {1, 4, 16}})->UseRealTime();
+
+}   // namespace
@@ -20,14 +20,17 @@ class bbRecipe(ConanFile):
     settings = "os", "compiler", "build_type", "arch"
 
     # Sources are located in the same place as this recipe, copy them to the recipe
-    exports_sources = "CMakeLists.txt", "include/*", "src/*", "tests/*"
+    exports_sources = "CMakeLists.txt", "include/*", "src/*", "tests/*", "bench/*"
 
     def validate(self):
         check_min_cppstd(self, "17")
 
     def requirements(self):
         self.requires("cpp-httplib/0.15.3")
+        self.requires("zlib/1.3.1")
+        self.requires("brotli/1.1.0")
         self.test_requires("gtest/1.14.0")
+        self.test_requires("benchmark/1.8.3")
 
     def layout(self):
         cmake_layout(self)
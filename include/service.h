@@ -18,8 +18,17 @@
  */
 #pragma once
 
-#include <list>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace bb {
 
@@ -32,12 +41,190 @@ using SeatMask = size_t;
  */
 constexpr int BITS_PER_BYTE = 8;
 /**
- * @brief The maximum number of seats a theater has.
+ * @brief The number of seats a theater has unless its showing says otherwise.
+ *
+ * Larger venues are described by a SeatSet; a SeatMask only ever covers the first seats of a
+ * showing.
  */
 constexpr int MAX_SEATS = 20;
 static_assert(sizeof(SeatMask) * BITS_PER_BYTE > MAX_SEATS, "Insufficient bits for representing the seats");
 constexpr SeatMask NO_SEATS = 0;
 constexpr SeatMask ALL_SEATS = (1 << MAX_SEATS) - 1;
+/**
+ * @brief The number of seats in a row unless the showing says otherwise.
+ */
+constexpr int SEATS_PER_ROW = 5;
+/**
+ * @brief The widest row a showing can have.
+ */
+constexpr int MAX_SEATS_PER_ROW = 64;
+
+/**
+ * @brief The id of a movie, resolved once with Service::movieId().
+ */
+using MovieId = std::uint32_t;
+/**
+ * @brief The id of a theater, resolved once with Service::theaterId().
+ */
+using TheaterId = std::uint32_t;
+/**
+ * @brief The id of a showing of a movie in a theater, resolved once with Service::showing().
+ */
+using ShowingId = std::uint32_t;
+/**
+ * @brief The id of seats on hold, from Service::hold(), which is never 0.
+ */
+using HoldId = std::uint64_t;
+/**
+ * @brief When a showing starts, in seconds since the epoch; 0 for a showing without a time.
+ */
+using StartTime = std::int64_t;
+
+/**
+ * @brief Where Service::bookBest() looks for seats first.
+ *
+ * Rows are numbered from the front, i.e. the screen. Within a row the seats closest to the
+ * middle are always preferred.
+ */
+enum class SeatPreference
+{
+    CENTER,     ///< the middle rows
+    FRONT,      ///< the rows closest to the screen
+    BACK,       ///< the rows furthest from the screen
+};
+/**
+ * @internal
+ */
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @internal
+ * An allocator that places every allocation at the start of a cache line.
+ */
+template<typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{CACHE_LINE_SIZE}));
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        ::operator delete(p, std::align_val_t{CACHE_LINE_SIZE});
+    }
+
+    template<typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+/**
+ * @brief A set of seats of a showing of any size, one bit per seat.
+ *
+ * Seats are numbered from 0 and stored in 64-bit words. The words are cache-line aligned and
+ * padded to whole cache lines so that counts and scans run as vectorized kernels without a
+ * scalar tail. Bits beyond size() are always zero.
+ */
+class SeatSet
+{
+public:
+    using Word = std::uint64_t;
+    static constexpr std::size_t WORD_BITS = sizeof(Word) * BITS_PER_BYTE;
+    static constexpr std::size_t WORDS_PER_LINE = CACHE_LINE_SIZE / sizeof(Word);
+
+    SeatSet() = default;
+
+    /**
+     * @brief Create an empty set for a showing with @a seats seats.
+     */
+    explicit SeatSet(std::size_t seats);
+
+    /**
+     * @brief Create a set from a SeatMask, with bit i of @a mask being seat i.
+     * @throw std::invalid_argument if @a mask has bits beyond @a seats.
+     */
+    static SeatSet fromMask(SeatMask mask, std::size_t seats);
+
+    /**
+     * @brief Parse the compact run-length encoding produced by toRanges().
+     * @param ranges comma separated 1-based seat numbers or inclusive ranges, e.g. "1-5,9,12-20".
+     * @param seats the number of seats of the showing.
+     * @throw std::invalid_argument if @a ranges is malformed or refers to a seat out of range.
+     */
+    static SeatSet fromRanges(std::string_view ranges, std::size_t seats);
+
+    /**
+     * @brief Encode the set as comma separated 1-based seat numbers or inclusive ranges.
+     */
+    std::string toRanges() const;
+
+    /**
+     * @brief The first seats of the set as a SeatMask, for showings of up to 64 seats.
+     */
+    SeatMask mask() const { return _words.empty() ? NO_SEATS : _words[0]; }
+
+    /**
+     * @brief The number of seats of the showing, not the number of seats in the set.
+     */
+    std::size_t size() const { return _size; }
+
+    bool test(std::size_t seat) const { return (_words[seat / WORD_BITS] >> (seat % WORD_BITS)) & 1; }
+    void set(std::size_t seat) { _words[seat / WORD_BITS] |= Word{1} << (seat % WORD_BITS); }
+    void reset(std::size_t seat) { _words[seat / WORD_BITS] &= ~(Word{1} << (seat % WORD_BITS)); }
+
+    /**
+     * @brief Add the seats in [@a first, @a last) to the set.
+     */
+    void set(std::size_t first, std::size_t last);
+
+    /**
+     * @brief Complement the set within the seats of the showing.
+     */
+    SeatSet& flip();
+
+    /**
+     * @brief The number of seats in the set.
+     */
+    std::size_t count() const;
+    bool any() const;
+    bool none() const { return !any(); }
+    bool intersects(const SeatSet& other) const;
+
+    /**
+     * @brief The first seat in the set at or after @a from, or size() if there is none.
+     */
+    std::size_t findNext(std::size_t from) const;
+
+    SeatSet& operator|=(const SeatSet& other);
+    SeatSet& operator&=(const SeatSet& other);
+
+    /**
+     * @brief Remove the seats in @a other from the set.
+     */
+    SeatSet& subtract(const SeatSet& other);
+
+    bool operator==(const SeatSet& other) const { return _size == other._size && _words == other._words; }
+    bool operator!=(const SeatSet& other) const { return !(*this == other); }
+
+    /**
+     * @brief The words of the set, including the zero padding up to the end of the cache line.
+     */
+    const Word* data() const { return _words.data(); }
+    Word* data() { return _words.data(); }
+    std::size_t words() const { return _words.size(); }
+
+private:
+    std::size_t _size = 0;
+    std::vector<Word, CacheAlignedAllocator<Word>> _words;
+};
 
 /**
  * @brief The interface class for finding movies and booking seats in the showing theaters.
@@ -47,55 +234,545 @@ constexpr SeatMask ALL_SEATS = (1 << MAX_SEATS) - 1;
 class Service
 {
 public:
-    using NameList = std::list<std::string>;
+    /**
+     * @brief A read-only view of a sorted list of names.
+     *
+     * The names are owned by the edition of the catalog they were listed from, which the list
+     * keeps alive, so it stays valid when the catalog changes and is returned without copying
+     * or allocating anything. It refers to the names by their offsets in the edition's pool of
+     * names, and to a subset of them by their ids.
+     */
+    class NameList
+    {
+    public:
+        using value_type = std::string_view;
+        using size_type = std::size_t;
+
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = std::string_view;
+
+            const_iterator() = default;
+            const_iterator(const NameList& list, std::size_t i)
+                : _pool(list._pool), _offsets(list._offsets), _ids(list._ids), _i(i) {}
+
+            std::string_view operator*() const { return name(_pool, _offsets, _ids, _i); }
+            const_iterator& operator++() { ++_i; return *this; }
+            const_iterator operator++(int) { auto it = *this; ++_i; return it; }
+            bool operator==(const const_iterator& other) const { return _i == other._i; }
+            bool operator!=(const const_iterator& other) const { return _i != other._i; }
+
+        private:
+            const char* _pool = nullptr;
+            const std::uint64_t* _offsets = nullptr;
+            const std::uint32_t* _ids = nullptr;
+            std::size_t _i = 0;
+        };
+        using iterator = const_iterator;
+
+        NameList() = default;
+        /**
+         * @brief The names with the ids @a ids, or the first @a size names if @a ids is null.
+         * @param pool the characters of all names.
+         * @param offsets the offset of name i in @a pool is offsets[i], it ends at offsets[i + 1].
+         * @param owner what keeps the names alive.
+         */
+        NameList(const char* pool, const std::uint64_t* offsets, const std::uint32_t* ids, std::size_t size,
+                 std::shared_ptr<const void> owner = nullptr)
+            : _pool(pool), _offsets(offsets), _ids(ids), _size(size), _owner(std::move(owner)) {}
+
+        const_iterator begin() const { return {*this, 0}; }
+        const_iterator end() const { return {*this, _size}; }
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        std::string_view operator[](std::size_t i) const { return name(_pool, _offsets, _ids, i); }
+
+    private:
+        static std::string_view name(const char* pool, const std::uint64_t* offsets,
+                                     const std::uint32_t* ids, std::size_t i)
+        {
+            std::size_t id = ids ? ids[i] : i;
+            return {pool + offsets[id], std::size_t(offsets[id + 1] - offsets[id])};
+        }
+
+        const char* _pool = nullptr;
+        const std::uint64_t* _offsets = nullptr;
+        const std::uint32_t* _ids = nullptr;
+        std::size_t _size = 0;
+        std::shared_ptr<const void> _owner;
+    };
+
+    /**
+     * @brief A showing of a movie in a theater at a time, as listed by movieShowtimes() and
+     *        theaterShowtimes().
+     *
+     * The names are views of the edition of the catalog the showing was listed from, which the
+     * ShowtimeList keeps alive.
+     */
+    struct Showtime
+    {
+        ShowingId showing;
+        StartTime start;
+        std::string_view movie;
+        std::string_view theater;
+    };
+
+    /**
+     * @brief The showtimes in a range of start times, by start time.
+     */
+    class ShowtimeList
+    {
+    public:
+        using value_type = Showtime;
+        using const_iterator = std::vector<Showtime>::const_iterator;
+        using iterator = const_iterator;
+
+        ShowtimeList() = default;
+        ShowtimeList(std::vector<Showtime> showtimes, std::shared_ptr<const void> owner)
+            : _showtimes(std::move(showtimes)), _owner(std::move(owner)) {}
+
+        const_iterator begin() const { return _showtimes.begin(); }
+        const_iterator end() const { return _showtimes.end(); }
+        std::size_t size() const { return _showtimes.size(); }
+        bool empty() const { return _showtimes.empty(); }
+        const Showtime& operator[](std::size_t i) const { return _showtimes[i]; }
+
+    private:
+        std::vector<Showtime> _showtimes;
+        std::shared_ptr<const void> _owner;
+    };
+
+    /**
+     * @brief The seats to book in one showing, as part of a batch.
+     */
+    struct Booking
+    {
+        std::string movie;
+        std::string theater;
+        SeatSet seats;
+        /// the start of the showing, if the movie is shown in the theater more than once
+        std::optional<StartTime> start = std::nullopt;
+    };
+    /**
+     * @brief A showing to add to or remove from the catalog.
+     */
+    struct CatalogEntry
+    {
+        std::string movie;
+        std::string theater;
+        std::size_t seats = MAX_SEATS;
+        std::size_t seats_per_row = SEATS_PER_ROW;
+        StartTime start = 0;
+    };
+
+    /**
+     * @brief Options of the service instance.
+     */
+    struct Options
+    {
+        /// the booking log to replay on startup and to append bookings to; bookings are only
+        /// kept in memory if empty
+        std::string log_path;
+        /// how long the first of concurrent bookings waits for others to share its fsync with
+        std::chrono::microseconds group_commit_window{0};
+        /// the snapshot to start from instead of the catalog, if it exists, and to
+        /// checkpoint the catalog and the seats to; no snapshots if empty
+        std::string snapshot_path;
+        /// how often to checkpoint the seats, if they have changed
+        std::chrono::milliseconds checkpoint_interval{std::chrono::seconds(10)};
+        /// the catalog file, CSV or JSON lines, to start from when there is no snapshot yet;
+        /// the built-in catalog if empty
+        std::string catalog_path;
+        /// how many threads load and index the catalog, all cores if 0
+        std::size_t load_threads = 0;
+        /// how many shards to split the showings into, each with a thread pinned to its share
+        /// of the cores, which keeps its seats on their memory and runs their bookings; 1 to
+        /// book on the calling thread
+        std::size_t shards = 1;
+    };
+
+    virtual ~Service() = default;
+
+    /**
+     * @brief Set the options of the service instance, which has no effect once it is created.
+     */
+    static void configure(const Options& options);
+
     /**
      * @brief Get the service instance.
+     * @throw std::system_error if the booking log, the snapshot or the catalog file cannot be
+     * opened or read.
+     * @throw std::invalid_argument if the snapshot is not one this build can read, or the
+     * catalog file is not a catalog.
      */
     static Service& instance();
 
+    /**
+     * @brief Create a service of its own with @a options, apart from the instance, which is
+     * not checkpointed.
+     * @throw std::system_error if the booking log, the snapshot or the catalog file cannot be
+     * opened or read.
+     * @throw std::invalid_argument if the snapshot is not one this build can read, or the
+     * catalog file is not a catalog.
+     */
+    static std::unique_ptr<Service> create(const Options& options);
+
     /**
      * @brief List all movies that are showing.
-     * @return a NameList which contains all the movies that are showing in some theaters.
+     * @return a NameList which contains all the movies that are showing in some theaters, sorted.
      */
     virtual NameList movies() const = 0;
 
     /**
      * @brief List all movies that are showing in the specified theater.
      * @param theater the name of the theater.
-     * @return a NameList which contains all the movies that are showing in the specified theater.
+     * @return a NameList which contains all the movies that are showing in the specified theater,
+     *         sorted.
      */
     virtual NameList movies(const std::string& theater) const = 0;
 
     /**
      * @brief List all theaters that are known by this service.
-     * @return a NameList which contains all theaters that are known by this service.
+     * @return a NameList which contains all theaters that are known by this service, sorted.
      */
     virtual NameList theaters() const = 0;
 
     /**
      * @brief List all theaters that are showing in the specified movie.
      * @param movie the name of the movie.
-     * @return a NameList which contains all the theaters that are showing the specified movie.
+     * @return a NameList which contains all the theaters that are showing the specified movie,
+     *         sorted.
      */
     virtual NameList theaters(const std::string& movie) const = 0;
 
+    /**
+     * @brief Search the movies by name, as the name is typed.
+     *
+     * A movie matches if a word of its name starts with the query, ignoring ASCII case, or
+     * would with a typo or two: one for queries of 4 bytes or more, two for 8 bytes or more,
+     * where two letters the wrong way round are one typo. The words of all names are indexed
+     * when the catalog is, so a search takes a binary search and, for the typos, a walk of the
+     * words that start like the query.
+     * @param query what has been typed so far.
+     * @param limit the most movies to list.
+     * @return up to @a limit movies, those that match as typed first, then by number of typos.
+     */
+    virtual NameList searchMovies(const std::string& query, std::size_t limit) const = 0;
+
+    /**
+     * @brief Search the theaters by name, as the name is typed.
+     * @see searchMovies()
+     */
+    virtual NameList searchTheaters(const std::string& query, std::size_t limit) const = 0;
+
+    /**
+     * @brief Resolve the id of a movie.
+     * @param movie the name of the movie.
+     * @return the id of the movie, which stays the same until the catalog changes, see
+     *         catalogVersion().
+     * @throw std::invalid_argument if the movie is not found.
+     */
+    virtual MovieId movieId(const std::string& movie) const = 0;
+
+    /**
+     * @brief Resolve the id of a theater.
+     * @param theater the name of the theater.
+     * @return the id of the theater, which stays the same until the catalog changes, see
+     *         catalogVersion().
+     * @throw std::invalid_argument if the theater is not found.
+     */
+    virtual TheaterId theaterId(const std::string& theater) const = 0;
+
+    /**
+     * @brief Resolve the showing of a movie in a theater, for the calls that take a ShowingId.
+     *
+     * Resolving by ids is an array lookup; the calls that take names resolve the showing on every
+     * call, so resolve it once when the same showing is used repeatedly.
+     * @param movie the id of the movie.
+     * @param theater the id of the theater.
+     * @return the id of the showing, which stays the same for as long as it is in the catalog,
+     *         and is never used for another showing.
+     * @throw std::invalid_argument if the movie is not showing in the theater.
+     */
+    virtual ShowingId showing(MovieId movie, TheaterId theater) const = 0;
+
+    /**
+     * @brief Resolve the showing of a movie in a theater by their names.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @return the id of the showing, see showing(MovieId, TheaterId).
+     * @throw std::invalid_argument if the movie is not showing in the theater.
+     */
+    virtual ShowingId showing(const std::string& movie, const std::string& theater) const = 0;
+
+    /**
+     * @brief Resolve the showing of a movie in a theater at a time.
+     *
+     * A movie may be shown in a theater several times, each a showing of its own with its own
+     * seats. The calls that take a movie and a theater only, and showing(MovieId, TheaterId),
+     * resolve the one that starts first.
+     * @param movie the id of the movie.
+     * @param theater the id of the theater.
+     * @param start the start of the showing, 0 for a showing without a time.
+     * @return the id of the showing, see showing(MovieId, TheaterId).
+     * @throw std::invalid_argument if the movie is not showing in the theater at @a start.
+     */
+    virtual ShowingId showing(MovieId movie, TheaterId theater, StartTime start) const = 0;
+    /**
+     * @brief Resolve the showing of a movie in a theater at a time, by their names.
+     * @see showing(MovieId, TheaterId, StartTime) const
+     */
+    virtual ShowingId showing(const std::string& movie, const std::string& theater, StartTime start) const = 0;
+
+    /**
+     * @brief Get the start of a showing.
+     * @param showing the id of the showing.
+     * @return the start time, 0 for a showing without a time.
+     * @throw std::invalid_argument if the showing is not found.
+     */
+    virtual StartTime start(ShowingId showing) const = 0;
+
+    /**
+     * @brief List the showings of a movie, in all theaters, that start within a range of times.
+     *
+     * The showings of every movie are indexed by their start, so this takes a binary search and
+     * the showings in the range, however many the movie has outside of it.
+     * @param movie the name of the movie.
+     * @param from the earliest start to list.
+     * @param to the start to list the showings before.
+     * @return the showings that start in [@a from, @a to), by start time.
+     * @throw std::invalid_argument if the movie is not found.
+     */
+    virtual ShowtimeList movieShowtimes(const std::string& movie, StartTime from, StartTime to) const = 0;
+
+    /**
+     * @brief List the showings in a theater, of all movies, that start within a range of times.
+     * @param theater the name of the theater.
+     * @see movieShowtimes()
+     * @throw std::invalid_argument if the theater is not found.
+     */
+    virtual ShowtimeList theaterShowtimes(const std::string& theater, StartTime from, StartTime to) const = 0;
+
+    /**
+     * @brief Get the version of the catalog, which changes whenever showings come or go.
+     *
+     * Together with version(ShowingId), this tells whether anything rendered from the service
+     * earlier is still up to date.
+     */
+    virtual std::uint64_t catalogVersion() const = 0;
+
+    /**
+     * @brief Get the version of the seats of a showing, which changes with every booking.
+     *
+     * Seats read after the version are at least as new as the version.
+     * @param showing the id of the showing.
+     * @throw std::invalid_argument if the showing is not found.
+     */
+    virtual std::uint64_t version(ShowingId showing) const = 0;
+
+    /**
+     * @brief Wait until the seats of a showing change.
+     *
+     * Booking never waits for the callers of this method: it only wakes them up, and each of
+     * them reads the seats again on its own.
+     * @param showing the id of the showing.
+     * @param version the version of the seats the caller has seen.
+     * @param timeout how long to wait at most.
+     * @return the current version, which is still @a version if nothing has changed within
+     *         @a timeout.
+     * @throw std::invalid_argument if the showing is not found, or is removed meanwhile.
+     */
+    virtual std::uint64_t waitForChange(ShowingId showing, std::uint64_t version,
+                                        std::chrono::milliseconds timeout) const = 0;
+
+    /**
+     * @brief Get the number of seats of the specified movie that is showing in the specified theater.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @return the number of seats, booked or not.
+     */
+    virtual std::size_t seatCount(const std::string& movie, const std::string& theater) const = 0;
+    /**
+     * @brief Get the number of seats of a showing.
+     * @see seatCount(const std::string&, const std::string&) const
+     */
+    virtual std::size_t seatCount(ShowingId showing) const = 0;
+
+    /**
+     * @brief Get the number of seats in a row of the specified theater for the specified movie.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @return the width of a row, the last row may be shorter.
+     */
+    virtual std::size_t seatsPerRow(const std::string& movie, const std::string& theater) const = 0;
+    /**
+     * @brief Get the number of seats in a row of a showing.
+     * @see seatsPerRow(const std::string&, const std::string&) const
+     */
+    virtual std::size_t seatsPerRow(ShowingId showing) const = 0;
+
     /**
      * @brief Get the available seats of the specified movie that is showing in the specified theater.
      * @param movie the name of the movie.
      * @param theater the name of the theater.
      * @return a SeatMask that represent the available seats in the specified theater, with each
-     *         bit represents a seat.
+     *         bit represents a seat. Only the first 64 seats of a larger venue are covered.
      */
     virtual SeatMask availableSeats(const std::string& movie, const std::string& theater) const = 0;
+    /**
+     * @brief Get the available seats of a showing.
+     * @see availableSeats(const std::string&, const std::string&) const
+     */
+    virtual SeatMask availableSeats(ShowingId showing) const = 0;
+
+    /**
+     * @brief Get all available seats of the specified movie that is showing in the specified theater.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @return a SeatSet of seatCount() seats that contains the available ones.
+     */
+    virtual SeatSet availableSeatSet(const std::string& movie, const std::string& theater) const = 0;
+    /**
+     * @brief Get all available seats of a showing.
+     * @see availableSeatSet(const std::string&, const std::string&) const
+     */
+    virtual SeatSet availableSeatSet(ShowingId showing) const = 0;
+
+    /**
+     * @brief Count the available seats of the specified movie that is showing in the specified theater.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @return the number of seats that are not booked.
+     */
+    virtual std::size_t availableSeatCount(const std::string& movie, const std::string& theater) const = 0;
+    /**
+     * @brief Count the available seats of a showing.
+     * @see availableSeatCount(const std::string&, const std::string&) const
+     */
+    virtual std::size_t availableSeatCount(ShowingId showing) const = 0;
 
     /**
      * @brief Book seat(s) in the specified theater for the specified movie.
      * @param movie the name of the movie.
      * @param theater the name of the theater.
-     * @param seat_mask the seats to book.
-     * @return True if the seats are successfully booked, otherwise False.
+     * @param seat_mask the seats to book, limited to the first 64 seats of the theater.
+     * @return True if the seats are successfully booked, otherwise False. With a booking log,
+     *         the booking is on disk before this returns True.
+     * @throw std::system_error if the booking cannot be logged, in which case it is undone.
      */
     virtual bool book(const std::string& movie, const std::string& theater, SeatMask seat_mask) = 0;
+    /**
+     * @brief Book seat(s) of a showing.
+     * @see book(const std::string&, const std::string&, SeatMask)
+     */
+    virtual bool book(ShowingId showing, SeatMask seat_mask) = 0;
+
+    /**
+     * @brief Book any set of seats in the specified theater for the specified movie.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @param seats the seats to book, a SeatSet of seatCount() seats.
+     * @return True if all the seats are successfully booked, otherwise False and none is booked.
+     */
+    virtual bool book(const std::string& movie, const std::string& theater, const SeatSet& seats) = 0;
+    /**
+     * @brief Book any set of seats of a showing.
+     * @see book(const std::string&, const std::string&, const SeatSet&)
+     */
+    virtual bool book(ShowingId showing, const SeatSet& seats) = 0;
+
+    /**
+     * @brief Find and book the best @a count adjacent seats of a row in one go.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @param count the number of seats to book, at most seatsPerRow().
+     * @param preference which rows to try first.
+     * @return the seats that are booked, or an empty SeatSet if there is no row with @a count
+     *         adjacent seats available.
+     * @throw std::system_error if the booking cannot be logged, in which case it is undone.
+     */
+    virtual SeatSet bookBest(const std::string& movie, const std::string& theater, std::size_t count,
+                             SeatPreference preference) = 0;
+    /**
+     * @brief Find and book the best adjacent seats of a showing.
+     * @see bookBest(const std::string&, const std::string&, std::size_t, SeatPreference)
+     */
+    virtual SeatSet bookBest(ShowingId showing, std::size_t count, SeatPreference preference) = 0;
+
+    /**
+     * @brief Book seats in several showings, all or nothing.
+     * @param bookings the seats to book in each showing. A showing may appear more than once as
+     *        long as its bookings do not share seats.
+     * @return True if all the seats are successfully booked, otherwise False and none is booked.
+     * @throw std::invalid_argument if a showing is not found or its seats are invalid, in which
+     *        case nothing is booked either.
+     */
+    virtual bool bookBatch(const std::vector<Booking>& bookings) = 0;
+
+    /**
+     * @brief Hold seats in the specified theater for the specified movie for a while, e.g. for
+     *        as long as it takes to pay for them.
+     *
+     * Seats on hold are taken like booked ones, until the hold is confirmed, which books them,
+     * or released, or it expires, which makes them available again. Holds are logged like
+     * bookings, and kept along with their deadline across restarts.
+     * @param movie the name of the movie.
+     * @param theater the name of the theater.
+     * @param seat_mask the seats to hold, limited to the first 64 seats of the theater.
+     * @param ttl how long to hold the seats, to within about 100 milliseconds.
+     * @return the id of the hold, or 0 if any of the seats is not available, in which case none
+     *         is held. With a booking log, the hold is on disk before this returns.
+     * @throw std::invalid_argument if the showing is not found, the seats are invalid or @a ttl
+     *        is not positive.
+     * @throw std::system_error if the hold cannot be logged, in which case it is undone.
+     */
+    virtual HoldId hold(const std::string& movie, const std::string& theater, SeatMask seat_mask,
+                        std::chrono::milliseconds ttl) = 0;
+    /**
+     * @brief Hold any set of seats of a showing.
+     * @see hold(const std::string&, const std::string&, SeatMask, std::chrono::milliseconds)
+     */
+    virtual HoldId hold(ShowingId showing, const SeatSet& seats, std::chrono::milliseconds ttl) = 0;
+
+    /**
+     * @brief Book the seats on hold.
+     * @param hold the id of the hold.
+     * @return True if the seats are booked, False if the hold has expired, has been confirmed or
+     *         released already, or its showing is no longer in the catalog.
+     * @throw std::system_error if the confirmation cannot be logged.
+     */
+    virtual bool confirm(HoldId hold) = 0;
+
+    /**
+     * @brief Make the seats on hold available again, before the hold expires.
+     * @param hold the id of the hold.
+     * @return True if the hold is released, False if it has expired, or has been confirmed or
+     *         released already.
+     * @throw std::system_error if the release cannot be logged.
+     */
+    virtual bool release(HoldId hold) = 0;
+
+    /**
+     * @brief Remove showings from the catalog and add others, all at once.
+     *
+     * Readers go on meanwhile, without waiting, and see either the catalog before the change or
+     * after it. The showings that stay keep their ids and their seats, along with the bookings
+     * under way. This builds the catalog anew, so batch the changes that come together.
+     * @param remove the showings to remove, by movie, theater and start.
+     * @param add the showings to add, with no seat booked.
+     * @return the new catalogVersion().
+     * @throw std::invalid_argument if a showing to remove is not in the catalog, a showing to add
+     *        is, once the others are removed, or it has no seats or too many seats per row.
+     *        Nothing is changed then.
+     * @throw std::system_error if the change cannot be logged. Nothing is changed then.
+     */
+    virtual std::uint64_t updateCatalog(const std::vector<CatalogEntry>& remove,
+                                        const std::vector<CatalogEntry>& add) = 0;
 };
 
 }   // namespace bb
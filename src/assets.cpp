@@ -0,0 +1,132 @@
+#include "assets.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+#include <brotli/encode.h>
+#include <zlib.h>
+
+using namespace std;
+using namespace bb;
+
+static string_view trim(string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+static bool equalsIgnoreCase(string_view a, string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a, to tell versions of a file apart rather than to stand up to anyone
+static string contentHash(string_view content)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (unsigned char c : content) {
+        hash = (hash ^ c) * 0x100000001b3;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return string(hex, 8);
+}
+
+bool bb::acceptsEncoding(string_view accept_encoding, string_view coding)
+{
+    // the coding by name wins over *, whichever comes first
+    int wildcard = -1;
+    while (!accept_encoding.empty()) {
+        auto comma = accept_encoding.find(',');
+        auto item = accept_encoding.substr(0, comma);
+        accept_encoding.remove_prefix(comma == string_view::npos ? accept_encoding.size() : comma + 1);
+
+        auto semicolon = item.find(';');
+        auto name = trim(item.substr(0, semicolon));
+        bool accepted = true;
+        if (semicolon != string_view::npos) {
+            auto param = trim(item.substr(semicolon + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                // q=0, q=0.0, q=0.000 turn the coding down
+                auto q = param.substr(2);
+                accepted = q.find_first_not_of("0.") != string_view::npos;
+            }
+        }
+        if (equalsIgnoreCase(name, coding)) {
+            return accepted;
+        }
+        if (name == "*") {
+            wildcard = accepted;
+        }
+    }
+    return wildcard == 1;
+}
+
+string bb::gzipCompress(string_view data)
+{
+    z_stream stream{};
+    // 15 bits of window, plus 16 for a gzip header and trailer
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw runtime_error("gzipCompress: cannot start deflate");
+    }
+    string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = out.size();
+    auto result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        throw runtime_error("gzipCompress: deflate failed");
+    }
+    return out;
+}
+
+string bb::brotliCompress(string_view data)
+{
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    string out(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, data.size(),
+                               reinterpret_cast<const uint8_t*>(data.data()), &size,
+                               reinterpret_cast<uint8_t*>(out.data()))) {
+        throw runtime_error("brotliCompress: compression failed");
+    }
+    out.resize(size);
+    return out;
+}
+
+StaticAsset::StaticAsset(string_view name, string_view extension, string content_type, string content)
+    : _content_type(move(content_type)), _identity(move(content))
+{
+    _path.append("/static/").append(name).append(".").append(contentHash(_identity)).append(".").append(extension);
+    _brotli = brotliCompress(_identity);
+    _gzip = gzipCompress(_identity);
+}
+
+StaticAsset::Encoded StaticAsset::encodedFor(string_view accept_encoding) const
+{
+    if (_brotli.size() < _identity.size() && acceptsEncoding(accept_encoding, "br")) {
+        return {"br", _brotli};
+    }
+    if (_gzip.size() < _identity.size() && acceptsEncoding(accept_encoding, "gzip")) {
+        return {"gzip", _gzip};
+    }
+    return {"", _identity};
+}
@@ -0,0 +1,77 @@
+/*
+ * The stylesheet and the scripts of the pages, compressed once and kept by browsers for good
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace bb {
+
+/**
+ * @internal
+ * A file served from /static/ under a name with a hash of its content in it, such as
+ * /static/bb.3f2a9c1e.css, so that what is under a name never changes and browsers may keep it
+ * without asking again. It is compressed with brotli and gzip once, when it is made, and held in
+ * memory with its compressed copies; a request is given the smallest copy it accepts.
+ */
+class StaticAsset
+{
+public:
+    /**
+     * A copy of the file, with its Content-Encoding, empty for the file as it is.
+     */
+    struct Encoded
+    {
+        std::string_view encoding;
+        const std::string& body;
+    };
+
+    /**
+     * Make /static/@a name.HASH.@a extension of @a content, served as @a content_type.
+     */
+    StaticAsset(std::string_view name, std::string_view extension, std::string content_type, std::string content);
+
+    StaticAsset(const StaticAsset&) = delete;
+    StaticAsset& operator=(const StaticAsset&) = delete;
+
+    const std::string& path() const
+    {
+        return _path;
+    }
+
+    const std::string& contentType() const
+    {
+        return _content_type;
+    }
+
+    /**
+     * The copy to answer a request of @a accept_encoding with: brotli, then gzip, if accepted
+     * and smaller, otherwise the file as it is.
+     */
+    Encoded encodedFor(std::string_view accept_encoding) const;
+
+private:
+    std::string _path;
+    std::string _content_type;
+    std::string _identity;
+    std::string _brotli;
+    std::string _gzip;
+};
+
+/**
+ * @internal
+ * Whether an Accept-Encoding header of @a accept_encoding accepts @a coding, by name or as `*`,
+ * with a q-value other than 0.
+ */
+bool acceptsEncoding(std::string_view accept_encoding, std::string_view coding);
+
+/**
+ * @internal
+ * @a data compressed at the highest level, as gzip and as brotli.
+ * @throw std::runtime_error if the compressor fails.
+ */
+std::string gzipCompress(std::string_view data);
+std::string brotliCompress(std::string_view data);
+
+}   // namespace bb
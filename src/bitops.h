@@ -0,0 +1,238 @@
+/*
+ * Bit kernels over arrays of 64-bit words
+ *
+ * The vectorized variants are picked at compile time: AVX2 when the build targets it, SSSE3
+ * otherwise if available, and portable scalar code as the fallback. All kernels accept any
+ * number of words and any alignment.
+ */
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace bb {
+namespace bitops {
+
+using Word = std::uint64_t;
+
+inline std::size_t popcount(Word w)
+{
+    return std::bitset<64>(w).count();
+}
+
+/**
+ * @internal
+ * index of the lowest set bit, `w` must not be zero
+ */
+inline std::size_t countTrailingZeros(Word w)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, w);
+    return index;
+#else
+    return __builtin_ctzll(w);
+#endif
+}
+
+/**
+ * @internal
+ * index of the highest set bit, `w` must not be zero
+ */
+inline std::size_t highestBit(Word w)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, w);
+    return index;
+#else
+    return 63 - __builtin_clzll(w);
+#endif
+}
+
+#if defined(__AVX2__)
+
+/**
+ * @internal
+ * per-byte popcount of a vector, using a nibble lookup table (Mula et al.)
+ */
+inline __m256i popcountBytes(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(v, low_nibbles);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+}
+
+inline std::size_t popcount(const Word* words, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m256i) / sizeof(Word);
+    __m256i total = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256()));
+    }
+    std::size_t count = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1)
+                      + _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+    for (; i < n; ++i) {
+        count += popcount(words[i]);
+    }
+    return count;
+}
+
+inline bool intersects(const Word* a, const Word* b, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m256i) / sizeof(Word);
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        if (!_mm256_testz_si256(va, vb)) {
+            return true;
+        }
+    }
+    for (; i < n; ++i) {
+        if (a[i] & b[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void andNot(Word* dst, const Word* a, const Word* b, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m256i) / sizeof(Word);
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        // _mm256_andnot_si256 complements its first operand
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_andnot_si256(vb, va));
+    }
+    for (; i < n; ++i) {
+        dst[i] = a[i] & ~b[i];
+    }
+}
+
+#elif defined(__SSSE3__)
+
+/**
+ * @internal
+ * per-byte popcount of a vector, using a nibble lookup table (Mula et al.)
+ */
+inline __m128i popcountBytes(__m128i v)
+{
+    const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    const __m128i lo = _mm_and_si128(v, low_nibbles);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibbles);
+    return _mm_add_epi8(_mm_shuffle_epi8(lookup, lo), _mm_shuffle_epi8(lookup, hi));
+}
+
+inline std::size_t popcount(const Word* words, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m128i) / sizeof(Word);
+    __m128i total = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+        total = _mm_add_epi64(total, _mm_sad_epu8(popcountBytes(v), _mm_setzero_si128()));
+    }
+    std::size_t count = _mm_cvtsi128_si64(total) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+    for (; i < n; ++i) {
+        count += popcount(words[i]);
+    }
+    return count;
+}
+
+inline bool intersects(const Word* a, const Word* b, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m128i) / sizeof(Word);
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const __m128i both = _mm_and_si128(va, vb);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(both, _mm_setzero_si128())) != 0xffff) {
+            return true;
+        }
+    }
+    for (; i < n; ++i) {
+        if (a[i] & b[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void andNot(Word* dst, const Word* a, const Word* b, std::size_t n)
+{
+    constexpr std::size_t STEP = sizeof(__m128i) / sizeof(Word);
+    std::size_t i = 0;
+    for (; i + STEP <= n; i += STEP) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        // _mm_andnot_si128 complements its first operand
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_andnot_si128(vb, va));
+    }
+    for (; i < n; ++i) {
+        dst[i] = a[i] & ~b[i];
+    }
+}
+
+#else
+
+inline std::size_t popcount(const Word* words, std::size_t n)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        count += popcount(words[i]);
+    }
+    return count;
+}
+
+inline bool intersects(const Word* a, const Word* b, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        if (a[i] & b[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void andNot(Word* dst, const Word* a, const Word* b, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = a[i] & ~b[i];
+    }
+}
+
+#endif
+
+/**
+ * @internal
+ * whether any bit is set, `any(w, n)` is `intersects(w, w, n)`
+ */
+inline bool any(const Word* words, std::size_t n)
+{
+    return intersects(words, words, n);
+}
+
+}   // namespace bitops
+}   // namespace bb
@@ -0,0 +1,340 @@
+#include "catalog_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "parallel.h"
+#include "showtime.h"
+
+using namespace std;
+using namespace bb;
+
+static string readFile(const string& path)
+{
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) {
+        throw system_error(errno, generic_category(), "CatalogFile: cannot open " + path);
+    }
+    string data(size_t(in.tellg()), '\0');
+    in.seekg(0).read(data.data(), data.size());
+    if (!in) {
+        throw system_error(errno, generic_category(), "CatalogFile: cannot read " + path);
+    }
+    return data;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void skipSpace(char*& p, char* end)
+{
+    while (p != end && isSpace(*p)) {
+        ++p;
+    }
+}
+
+static size_t number(string_view s, const char* what)
+{
+    size_t n;
+    auto [last, error] = from_chars(s.data(), s.data() + s.size(), n);
+    if (s.empty() || error != errc() || last != s.data() + s.size()) {
+        throw invalid_argument(string("invalid ") + what);
+    }
+    return n;
+}
+
+/**
+ * The CSV field at @a p, which is left at the comma after it or at @a end. A quoted field is
+ * unescaped in place.
+ */
+static string_view csvField(char*& p, char* end)
+{
+    if (p == end || *p != '"') {
+        char* first = p;
+        p = find(p, end, ',');
+        return {first, size_t(p - first)};
+    }
+
+    // "" stands for a quote, and the field is never longer than its quoted form
+    char* first = ++p;
+    char* out = first;
+    for (;; ) {
+        if (p == end) {
+            throw invalid_argument("unterminated quote");
+        }
+        if (*p == '"') {
+            if (end - p > 1 && p[1] == '"') {
+                *out++ = '"';
+                p += 2;
+                continue;
+            }
+            ++p;
+            break;
+        }
+        *out++ = *p++;
+    }
+    if (p != end && *p != ',') {
+        throw invalid_argument("text after a quoted field");
+    }
+    return {first, size_t(out - first)};
+}
+
+static BookingRecord parseCsv(char* p, char* end)
+{
+    string_view fields[5];
+    size_t count = 0;
+    for (;; ++p) {
+        if (count == size(fields)) {
+            throw invalid_argument("too many fields");
+        }
+        fields[count++] = csvField(p, end);
+        if (p == end) {
+            break;
+        }
+    }
+    if (count < 2) {
+        throw invalid_argument("no theater");
+    }
+
+    BookingRecord record{fields[0], fields[1], 0};
+    if (count > 2) {
+        record.seats = number(fields[2], "seats");
+    }
+    if (count > 3) {
+        record.seats_per_row = number(fields[3], "seats_per_row");
+    }
+    if (count > 4) {
+        record.start = parseStartTime(fields[4]);
+    }
+    return record;
+}
+
+static void putUtf8(char*& out, uint32_t c)
+{
+    if (c < 0x80) {
+        *out++ = char(c);
+    } else if (c < 0x800) {
+        *out++ = char(0xc0 | c >> 6);
+        *out++ = char(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+        *out++ = char(0xe0 | c >> 12);
+        *out++ = char(0x80 | (c >> 6 & 0x3f));
+        *out++ = char(0x80 | (c & 0x3f));
+    } else {
+        *out++ = char(0xf0 | c >> 18);
+        *out++ = char(0x80 | (c >> 12 & 0x3f));
+        *out++ = char(0x80 | (c >> 6 & 0x3f));
+        *out++ = char(0x80 | (c & 0x3f));
+    }
+}
+
+static uint32_t hex4(char*& p, char* end)
+{
+    if (end - p < 4) {
+        throw invalid_argument("invalid escape");
+    }
+    uint32_t c;
+    auto [last, error] = from_chars(p, p + 4, c, 16);
+    if (error != errc() || last != p + 4) {
+        throw invalid_argument("invalid escape");
+    }
+    p += 4;
+    return c;
+}
+
+/**
+ * The JSON string at @a p, unescaped in place, which is never longer than its escaped form.
+ */
+static string_view jsonString(char*& p, char* end)
+{
+    if (p == end || *p != '"') {
+        throw invalid_argument("string expected");
+    }
+    char* first = ++p;
+    char* out = first;
+    for (;; ) {
+        if (p == end) {
+            throw invalid_argument("unterminated string");
+        }
+        char c = *p++;
+        if (c == '"') {
+            break;
+        }
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+        if (p == end) {
+            throw invalid_argument("unterminated string");
+        }
+        switch (c = *p++) {
+        case '"': case '\\': case '/': *out++ = c; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u': {
+            uint32_t code = hex4(p, end);
+            if (code >= 0xd800 && code < 0xdc00 && end - p >= 2 && p[0] == '\\' && p[1] == 'u') {
+                // a surrogate pair
+                p += 2;
+                uint32_t low = hex4(p, end);
+                if (low < 0xdc00 || low >= 0xe000) {
+                    throw invalid_argument("invalid escape");
+                }
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            }
+            putUtf8(out, code);
+            break;
+        }
+        default:
+            throw invalid_argument("invalid escape");
+        }
+    }
+    return {first, size_t(out - first)};
+}
+
+/**
+ * A JSON number, true, false or null at @a p, which is not checked any further.
+ */
+static string_view jsonScalar(char*& p, char* end)
+{
+    if (p != end && (*p == '{' || *p == '[')) {
+        throw invalid_argument("nested values are not supported");
+    }
+    char* first = p;
+    while (p != end && *p != ',' && *p != '}' && !isSpace(*p)) {
+        ++p;
+    }
+    return {first, size_t(p - first)};
+}
+
+static BookingRecord parseJson(char* p, char* end)
+{
+    BookingRecord record{{}, {}, 0};
+    bool movie = false, theater = false;
+    skipSpace(p, end);
+    if (p == end || *p++ != '{') {
+        throw invalid_argument("object expected");
+    }
+    skipSpace(p, end);
+    if (p != end && *p == '}') {
+        ++p;
+    } else {
+        for (;; ) {
+            skipSpace(p, end);
+            string_view key = jsonString(p, end);
+            skipSpace(p, end);
+            if (p == end || *p++ != ':') {
+                throw invalid_argument("':' expected");
+            }
+            skipSpace(p, end);
+            if (key == "movie") {
+                record.movie_name = jsonString(p, end);
+                movie = true;
+            } else if (key == "theater") {
+                record.theater_name = jsonString(p, end);
+                theater = true;
+            } else if (key == "seats") {
+                record.seats = number(jsonScalar(p, end), "seats");
+            } else if (key == "seats_per_row") {
+                record.seats_per_row = number(jsonScalar(p, end), "seats_per_row");
+            } else if (key == "start") {
+                record.start = parseStartTime(p != end && *p == '"' ? jsonString(p, end) : jsonScalar(p, end));
+            } else if (p != end && *p == '"') {
+                jsonString(p, end);
+            } else {
+                jsonScalar(p, end);
+            }
+            skipSpace(p, end);
+            if (p != end && *p == ',') {
+                ++p;
+                continue;
+            }
+            if (p == end || *p++ != '}') {
+                throw invalid_argument("',' or '}' expected");
+            }
+            break;
+        }
+    }
+    skipSpace(p, end);
+    if (p != end) {
+        throw invalid_argument("text after the object");
+    }
+    if (!movie) {
+        throw invalid_argument("no movie");
+    }
+    if (!theater) {
+        throw invalid_argument("no theater");
+    }
+    return record;
+}
+
+CatalogFile::CatalogFile(const string& path, size_t threads)
+    : _data(readFile(path))
+{
+    char* data = _data.data();
+    size_t size = _data.size();
+    auto first = find_if(data, data + size, [](char c) { return !isSpace(c); });
+    const bool json = first != data + size && *first == '{';
+    auto parseLine = json ? parseJson : parseCsv;
+
+    // every part takes the lines that start in its range of bytes
+    size_t parts = parallel::partsFor(size, threads, 1 << 20);
+    vector<vector<BookingRecord>> records(parts);
+    parallel::forParts(size, parts, [&](size_t part, size_t begin, size_t end) {
+        char* p = data + begin;
+        if (begin > 0 && data[begin - 1] != '\n') {
+            p = find(p, data + size, '\n');
+            p += p != data + size;
+        }
+        records[part].reserve(count(p, data + end, '\n') + 1);
+        while (p < data + end) {
+            char* eol = find(p, data + size, '\n');
+            char* last = eol;
+            if (last != p && last[-1] == '\r') {
+                --last;
+            }
+            try {
+                if (all_of(p, last, isSpace)) {
+                    // a blank line
+                } else if (!json && p == data && string_view(p, last - p).rfind("movie,theater", 0) == 0) {
+                    // the CSV header
+                } else {
+                    auto record = parseLine(p, last);
+                    if (record.movie_name.empty() || record.theater_name.empty()) {
+                        throw invalid_argument("empty name");
+                    }
+                    records[part].push_back(record);
+                }
+            } catch (invalid_argument& e) {
+                throw invalid_argument("CatalogFile: line " + to_string(count(data, p, '\n') + 1) + ": " + e.what());
+            }
+            p = eol + (eol != data + size);
+        }
+    });
+
+    if (parts == 1) {
+        _records = move(records[0]);
+        return;
+    }
+    size_t total = 0;
+    for (auto& part : records) {
+        total += part.size();
+    }
+    _records.reserve(total);
+    for (auto& part : records) {
+        _records.insert(_records.end(), part.begin(), part.end());
+        vector<BookingRecord>().swap(part);
+    }
+}
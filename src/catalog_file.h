@@ -0,0 +1,73 @@
+/*
+ * The showings of the catalog, as they are given to the service on startup
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * A showing to build the catalog from. The names only need to live until the catalog is built.
+ */
+struct BookingRecord
+{
+    std::string_view movie_name;
+    std::string_view theater_name;
+    SeatMask booked_mask;
+    std::size_t seats = MAX_SEATS;
+    std::size_t seats_per_row = SEATS_PER_ROW;
+    StartTime start = 0;
+};
+
+/**
+ * @internal
+ * The showings of a catalog file, one per line, either as CSV:
+ *
+ *     movie,theater,seats,seats_per_row,start
+ *     "Garfield Movie, The",Landmark Cinemas,480,24,2024-06-21T18:30
+ *     Back to Black,Galaxy Cinemas
+ *
+ * where a first line that starts with `movie,theater` is a header and names with commas or
+ * quotes are quoted, or as JSON lines:
+ *
+ *     {"movie": "Garfield Movie, The", "theater": "Landmark Cinemas", "seats": 480, "seats_per_row": 24, "start": "2024-06-21T18:30"}
+ *
+ * which is what the file is taken for if it starts with `{`. The seats, seats per row and start
+ * are optional in both, and no seat is booked: bookings come from the booking log. A start is a
+ * date and time in UTC or seconds since the epoch, and a movie is shown in a theater once per
+ * start. Names cannot span lines.
+ *
+ * The file is read whole, then its lines are split over the cores and parsed in place: escaped
+ * names are unescaped where they are, and the records view the names in the file's buffer.
+ */
+class CatalogFile
+{
+public:
+    /**
+     * Read and parse the catalog file at @a path with @a threads threads, all cores if 0.
+     * @throw std::system_error if the file cannot be read.
+     * @throw std::invalid_argument if a line is not a showing, with its line number.
+     */
+    explicit CatalogFile(const std::string& path, std::size_t threads = 0);
+
+    CatalogFile(const CatalogFile&) = delete;
+    CatalogFile& operator=(const CatalogFile&) = delete;
+
+    const std::vector<BookingRecord>& records() const
+    {
+        return _records;
+    }
+
+private:
+    std::string _data;
+    std::vector<BookingRecord> _records;
+};
+
+}   // namespace bb
@@ -0,0 +1,74 @@
+/*
+ * Thin wrappers of the file calls the booking log and the snapshots need
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace bb {
+namespace file {
+
+#if defined(_WIN32)
+inline int open(const char* path, bool append) { return ::_open(path, _O_RDWR | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC), 0644); }
+inline long read(int fd, void* buf, std::size_t size) { return ::_read(fd, buf, unsigned(size)); }
+inline long write(int fd, const void* buf, std::size_t size) { return ::_write(fd, buf, unsigned(size)); }
+inline int sync(int fd) { return ::_commit(fd); }
+inline int truncate(int fd, std::size_t size) { return ::_chsize_s(fd, size); }
+inline long long seek(int fd, std::size_t offset) { return ::_lseeki64(fd, offset, SEEK_SET); }
+inline int close(int fd) { return ::_close(fd); }
+#else
+inline int open(const char* path, bool append) { return ::open(path, O_RDWR | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644); }
+inline long read(int fd, void* buf, std::size_t size) { return ::read(fd, buf, size); }
+inline long write(int fd, const void* buf, std::size_t size) { return ::write(fd, buf, size); }
+inline int sync(int fd) { return ::fsync(fd); }
+inline int truncate(int fd, std::size_t size) { return ::ftruncate(fd, size); }
+inline long long seek(int fd, std::size_t offset) { return ::lseek(fd, offset, SEEK_SET); }
+inline int close(int fd) { return ::close(fd); }
+#endif
+
+/**
+ * @internal
+ * write all of @a size bytes, or return the errno of the call that failed
+ */
+inline int writeAll(int fd, const void* buf, std::size_t size)
+{
+    for (std::size_t written = 0; written < size; ) {
+        long n = write(fd, static_cast<const char*>(buf) + written, size - written);
+        if (n < 0) {
+            return errno;
+        }
+        written += n;
+    }
+    return 0;
+}
+
+/**
+ * @internal
+ * read the whole file from the current position to the end
+ */
+inline std::string readAll(int fd)
+{
+    std::string data;
+    char chunk[1 << 16];
+    for (long n; (n = read(fd, chunk, sizeof(chunk))) != 0; ) {
+        if (n < 0) {
+            throw std::system_error(errno, std::generic_category(), "readAll: cannot read");
+        }
+        data.append(chunk, n);
+    }
+    return data;
+}
+
+}   // namespace file
+}   // namespace bb
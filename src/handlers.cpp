@@ -1,23 +1,35 @@
 #include "handlers.h"
 
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <exception>
 #include <functional>
-#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <system_error>
+#include <vector>
 
 #include <httplib/httplib.h>
 
+#include "assets.h"
 #include "html.h"
+#include "idempotency.h"
+#include "json.h"
+#include "metrics.h"
+#include "page_cache.h"
 #include "service.h"
+#include "showtime.h"
+#include "stream_slots.h"
 
 using namespace std;
 
 namespace bb {
 
-static constexpr const char * COMMON_HEADER = R"(<html>
-<head>
-<style>
-body {
+static constexpr const char * STYLESHEET = R"(body {
     margin: 0px;
 }
 
@@ -50,6 +62,9 @@ div.container {
 .header li {
     padding: 10px;
 }
+.header li.search {
+    margin-left: auto;
+}
 .header a {
     color: inherit;
     background-color: inherit;
@@ -138,18 +153,78 @@ div.container {
     color: #ff6060;
     background-color: #ffe0e0;
 }
-</style>
-<script>
-    function setStatus(ok, message) {
+)";
+
+static constexpr const char * SCRIPT = R"(    function setStatus(ok, message) {
         const status = document.getElementById('status');
         status.className = ok ? 'success' : 'fail';
         status.innerHTML = '<pre>' + message + '</pre>';
     }
 
-    function addSeatMap(movie, theater, availableSeats) {
+    // seats are numbered from 1 and sent as comma separated ranges, e.g. "1-5,9,12-20"
+    function parseSeatRanges(ranges) {
+        const seats = new Set();
+        for (const range of ranges.split(',').filter(r => r)) {
+            const [first, last] = range.split('-').map(Number);
+            for (let i = first; i <= (last || first); i++) {
+                seats.add(i);
+            }
+        }
+        return seats;
+    }
+
+    function toSeatRanges(seats) {
+        const ranges = [];
+        for (let i = 0; i < seats.length; ) {
+            let j = i;
+            while (j + 1 < seats.length && seats[j + 1] === seats[j] + 1) {
+                j++;
+            }
+            ranges.push(i === j ? `${seats[i]}` : `${seats[i]}-${seats[j]}`);
+            i = j + 1;
+        }
+        return ranges.join(',');
+    }
+
+    // suggest movies and theaters as their names are typed, and go to the one picked
+    function addSearch() {
+        const input = document.getElementById('searchInput');
+        const found = document.getElementById('searchFound');
+        let pages = new Map();
+        input.addEventListener('input', function() {
+            const page = pages.get(input.value);
+            if (page) {
+                window.location = page;
+                return;
+            }
+            if (!input.value) {
+                return;
+            }
+            fetch(`/search?q=${encodeURIComponent(input.value)}`)
+            .then(response => response.json())
+            .then(data => {
+                pages = new Map();
+                found.replaceChildren();
+                for (const [key, names] of [['movie', data.movies], ['theater', data.theaters]]) {
+                    for (const name of names) {
+                        pages.set(name, `/${key}?name=${encodeURIComponent(name)}`);
+                        const option = document.createElement('option');
+                        option.value = name;
+                        found.appendChild(option);
+                    }
+                }
+            });
+        });
+    }
+
+    function addSeatMap(movie, theater, start, seatCount, seatsPerRow, availableSeats) {
+        const showing = `movie=${encodeURIComponent(movie)}&theater=${encodeURIComponent(theater)}` +
+                        (start ? `&start=${start}` : '');
         const seatMap = document.querySelector('.seat-map');
+        seatMap.style.gridTemplateColumns = `repeat(${seatsPerRow}, 1fr)`;
+        const available = parseSeatRanges(availableSeats);
 
-        for (let i = 1; i <= 20; i++) {
+        for (let i = 1; i <= seatCount; i++) {
             const seatId = `seat${i}`;
             const seatDiv = document.createElement('div');
             seatDiv.classList.add('seat');
@@ -159,7 +234,7 @@ div.container {
             seatCheckbox.name = 'seats';
             seatCheckbox.value = seatId;
 
-            if (!((1 << (i - 1)) & availableSeats)) {
+            if (!available.has(i)) {
                 seatCheckbox.checked = true;
                 seatCheckbox.disabled = true;
             }
@@ -173,13 +248,42 @@ div.container {
             seatMap.appendChild(seatDiv);
         }
 
+        function showAvailable(availableSeats) {
+            const available = parseSeatRanges(availableSeats);
+            for (let i = 1; i <= seatCount; i++) {
+                const seatCheckbox = document.getElementById(`seat${i}`);
+                if (!available.has(i)) {
+                    seatCheckbox.checked = true;
+                    seatCheckbox.disabled = true;
+                } else if (seatCheckbox.disabled) {
+                    seatCheckbox.checked = false;
+                    seatCheckbox.disabled = false;
+                }
+            }
+        }
+
+        // keep the seat map current while the page is open, by polling if the server streams too many
+        const stream = new EventSource(`/seats/stream?${showing}`);
+        stream.addEventListener('seats', event => showAvailable(JSON.parse(event.data).available));
+        stream.addEventListener('error', function() {
+            if (stream.readyState !== EventSource.CLOSED) {
+                return;
+            }
+            setInterval(function() {
+                fetch(`/api/v1/seats?${showing}`)
+                .then(response => response.ok ? response.json() : null)
+                .then(seats => seats && showAvailable(seats.available))
+                .catch(() => {});
+            }, 10000);
+        });
+
         const seatForm = document.getElementById('seatForm');
         seatForm.addEventListener('submit', function(event) {
             event.preventDefault();
             const selectedSeats = Array.from(seatForm.querySelectorAll('input[type="checkbox"]:checked:not(:disabled)'))
                                         .map(checkbox => parseInt(checkbox.value.substr(4)));
-            let seatMask = selectedSeats.reduce((acc, bitPosition) => acc | (1 << (bitPosition - 1)), 0);
-            fetch(`/book?movie=${movie}&theater=${theater}&seatMask=${seatMask}`, {method: 'POST'})
+            const seats = toSeatRanges(selectedSeats);
+            fetch(`/book?${showing}&seats=${seats}`, {method: 'POST'})
             .then(response => {
                 if (response.ok) {
                     setStatus(true, "Seat(s) booked successfully.");
@@ -193,15 +297,45 @@ div.container {
                 setStatus(false, error.message);
             });
         });
+
+        document.getElementById('bestButton').addEventListener('click', function() {
+            const count = document.getElementById('bestCount').value;
+            fetch(`/book/best?${showing}&count=${count}`, {method: 'POST'})
+            .then(response => response.json().then(data => {
+                if (!response.ok) {
+                    throw new Error(data.error + ': ' + data.message);
+                }
+                for (const seat of parseSeatRanges(data.seats)) {
+                    const seatCheckbox = document.getElementById(`seat${seat}`);
+                    seatCheckbox.checked = true;
+                    seatCheckbox.disabled = true;
+                }
+                setStatus(true, `Seat(s) ${data.seats} booked successfully.`);
+            }))
+            .catch(error => {
+                setStatus(false, error.message);
+            });
+        });
     }
-</script>
-</head>
-<body>
+)";
+
+// compressed once, on startup, and served from /static/ for good
+static const StaticAsset stylesheet("bb", "css", "text/css", STYLESHEET);
+static const StaticAsset script("bb", "js", "text/javascript", SCRIPT);
+
+// what is the same on every page, without the stylesheet and the scripts a browser keeps
+static const string COMMON_HEADER = "<html>\n<head>\n"
+    "<link rel=\"stylesheet\" href=\"" + stylesheet.path() + "\">\n"
+    "<script src=\"" + script.path() + "\"></script>\n"
+    "</head>\n" R"(<body>
     <ul class="header">
         <li id="movie"><a href="/movie">Movies</a></li>
         <li id="theater"><a href="/theater">Theaters</a></li>
         <li id="doc"><a href="/doc/index.html" target="_blank">Documentation</a></li>
+        <li class="search"><input type="search" id="searchInput" list="searchFound" placeholder="Search">
+            <datalist id="searchFound"></datalist></li>
     </ul>
+    <script>addSearch();</script>
     <div id="status"></div>
 <div class="container">
 )";
@@ -212,6 +346,8 @@ static constexpr const char * COMMON_TAIL = R"(
             <div class="seat-map">
             </div>
             <button type="submit" class="book-button">Book</button>
+            <input type="number" id="bestCount" min="1" value="2">
+            <button type="button" id="bestButton" class="book-button">Book best seats</button>
         </form>
     </div>
 </div>
@@ -220,61 +356,392 @@ static constexpr const char * COMMON_TAIL = R"(
 </body></html>
 )";
 
+/*
+ * The buffer JSON responses are written into, which is the thread's and only grows, so writing a
+ * response allocates nothing once it has grown to the size of one.
+ */
+static string& jsonBuffer()
+{
+    thread_local string out;
+    out.clear();
+    return out;
+}
+
 static void errorResponse(httplib::Response &res, int code, const string& error, const string& message)
 {
-    ostringstream out;
-    out << "{" << endl
-        << "  \"error\": \"" << error << "\"," << endl
-        << "  \"message\": \"" << message << "\"" << endl
-        << "}";
+    auto& out = jsonBuffer();
+    json::Writer(out).beginObject().member("error", error).member("message", message).endObject();
     res.status = code;
-    res.set_content(out.str(), "text/json");
+    res.set_content(out, "application/json");
 }
 
-static string selectTab(const string& tab_id)
+/*
+ * The start the @a i th "start" parameter asks for, if there is one, as seconds since the epoch
+ * or a time like 2024-06-21T18:30 in UTC. Throws invalid_argument if it is not a time.
+ */
+static optional<StartTime> startParam(const httplib::Request &req, size_t i = 0)
+{
+    if (req.get_param_value_count("start") <= i) {
+        return nullopt;
+    }
+    return parseStartTime(req.get_param_value("start", i));
+}
+
+/*
+ * The @a i th value of the parameter @a name, which has to be a decimal number that fits a Number
+ * entirely, rather than only begin with one, as for stoul().
+ */
+template<typename Number>
+static Number numberParam(const httplib::Request &req, const char* name, size_t i = 0)
+{
+    auto value = req.get_param_value(name, i);
+    Number number{};
+    auto [end, ec] = from_chars(value.data(), value.data() + value.size(), number);
+    if (ec != errc() || end != value.data() + value.size()) {
+        throw invalid_argument(string("numberParam: ") + name + " is not a number in range");
+    }
+    return number;
+}
+
+/*
+ * The showing of @a movie in @a theater at @a start, or the one that starts first.
+ */
+static ShowingId showingAt(const string& movie, const string& theater, const optional<StartTime>& start)
+{
+    auto& service = Service::instance();
+    return start ? service.showing(movie, theater, *start) : service.showing(movie, theater);
+}
+
+static ShowingId showingOf(const httplib::Request &req, const string& movie, const string& theater)
+{
+    return showingAt(movie, theater, startParam(req));
+}
+
+/*
+ * The times a page asks for: the start of the showing to show the seats of, and the range of
+ * starts to list the showtimes in, "from" and "to", open at the end that is not given.
+ */
+struct PageTimes
+{
+    optional<StartTime> start;
+    StartTime from = numeric_limits<StartTime>::min();
+    StartTime to = numeric_limits<StartTime>::max();
+    bool listed;
+
+    // throws invalid_argument if a time is not one
+    explicit PageTimes(const httplib::Request &req)
+        : start(startParam(req)), listed(req.has_param("from") || req.has_param("to"))
+    {
+        if (req.has_param("from")) {
+            from = parseStartTime(req.get_param_value("from"));
+        }
+        if (req.has_param("to")) {
+            to = parseStartTime(req.get_param_value("to"));
+        }
+    }
+
+    /*
+     * What they add to the key of a page, with a seat map or without. A page that lists showtimes
+     * is not cached, as a client may ask for any range of them, and so has no key.
+     */
+    optional<string> key(bool seat_map) const
+    {
+        if (listed) {
+            return nullopt;
+        }
+        // a start that is not a showing's gets no seat map, nor a page to cache
+        return seat_map && start ? "&start=" + to_string(*start) : "";
+    }
+};
+
+static PageCache page_cache;
+
+/*
+ * The ETag of a page listing the catalog and, with a seat map, the seats of a showing. The
+ * versions start over when the process restarts, so they are prefixed by its start time.
+ * Throws invalid_argument if the showing is not found.
+ */
+static string pageETag(bool seat_map, const string& movie, const string& theater, const optional<StartTime>& start)
+{
+    static const auto started = chrono::system_clock::now().time_since_epoch().count();
+    auto& service = Service::instance();
+    string etag = '"' + to_string(started) + '.' + to_string(service.catalogVersion());
+    if (seat_map) {
+        etag += '.' + to_string(service.version(showingAt(movie, theater, start)));
+    }
+    return etag + '"';
+}
+
+static void setPageHeaders(httplib::Response &res, const string& etag)
+{
+    res.set_header("ETag", etag);
+    // let the browser keep the page, but ask every time whether it is still current
+    res.set_header("Cache-Control", "no-cache");
+}
+
+/*
+ * Answer with the page rendered earlier if nothing it shows has changed since: 304 if the
+ * browser has it already, otherwise the cached copy.
+ */
+static bool sendCachedPage(const httplib::Request &req, httplib::Response &res,
+                           const string& key, const string& etag)
+{
+    if (req.get_header_value("If-None-Match") == etag) {
+        setPageHeaders(res, etag);
+        res.status = 304;
+        return true;
+    }
+    if (key.empty()) {
+        return false;
+    }
+    if (auto page = page_cache.find(key, etag)) {
+        setPageHeaders(res, etag);
+        // sent straight out of the cache, which the provider keeps the page in until it is sent
+        res.set_content_provider(page->size(), "text/html",
+                                 [page](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(page->data() + offset, length);
+        });
+        return true;
+    }
+    return false;
+}
+
+/*
+ * The buffer to render a chunk of a page into, one per server thread and reused for every chunk
+ * it renders.
+ */
+static html::Buffer& pageBuffer()
+{
+    thread_local html::Buffer out;
+    out.clear();
+    return out;
+}
+
+/*
+ * A page that is sent as it is rendered, a chunk at a time. What does not grow with the catalog
+ * is rendered up front, in between the lists of names, which are only rendered as the chunks are
+ * sent, from the catalog edition they were listed from. So the first chunk goes out before the
+ * lists are rendered, and a request holds one chunk of its page rather than all of it.
+ *
+ * A page of up to MAX_CACHED_PAGE bytes is also copied as it is sent, and cached once it is sent
+ * whole, unless it has no key; larger ones are rendered for every request.
+ */
+class PageStream
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr size_t MAX_CACHED_PAGE = 64 * 1024;
+
+    /*
+     * A page to cache under @a key for @a etag, unless either is empty, whose request is timed by
+     * @a timer until it is sent.
+     */
+    PageStream(unique_ptr<Metrics::Timer> timer, string key, string etag)
+        : _timer(move(timer)), _key(move(key)), _etag(move(etag)), _caching(!_key.empty() && !_etag.empty()) {}
+
+    const string& etag() const
+    {
+        return _etag;
+    }
+
+    template<typename T>
+    PageStream& operator<<(const T& value)
+    {
+        if (_sections.empty() || _sections.back().listed) {
+            _sections.emplace_back();
+        }
+        html::emit(_sections.back().html, value);
+        return *this;
+    }
+
+    /*
+     * Follow with the @a names as items linking to @a href followed by the name, the @a selected
+     * one selected.
+     */
+    PageStream& list(Service::NameList names, string href, string selected)
+    {
+        if (_sections.empty() || _sections.back().listed) {
+            _sections.emplace_back();
+        }
+        auto& section = _sections.back();
+        section.names = move(names);
+        section.href = move(href);
+        section.selected = move(selected);
+        section.listed = true;
+        return *this;
+    }
+
+    /*
+     * Render the next chunk into @a sink, and tell it when the page is done.
+     */
+    bool write(httplib::DataSink& sink)
+    {
+        auto& out = pageBuffer();
+        while (_section < _sections.size() && out.size() < CHUNK_SIZE) {
+            auto& section = _sections[_section];
+            if (_item == 0 && !_started) {
+                out << section.html;
+                _started = true;
+            } else if (_item < section.names.size()) {
+                auto name = section.names[_item++];
+                out << html::li(name == section.selected, html::a(html::echo(section.href, name), name));
+            } else {
+                ++_section;
+                _item = 0;
+                _started = false;
+            }
+        }
+        if (out.size() > 0) {
+            if (!sink.write(out.str().data(), out.size())) {
+                return false;
+            }
+            keep(out.str());
+        }
+        if (_section == _sections.size()) {
+            sink.done();
+            if (_caching) {
+                _caching = false;
+                page_cache.store(_key, _etag, make_shared<const string>(move(_copy)));
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Section
+    {
+        string html;
+        Service::NameList names;
+        string href;
+        string selected;
+        bool listed = false;
+    };
+
+    unique_ptr<Metrics::Timer> _timer;
+    string _key;
+    string _etag;
+    vector<Section> _sections;
+    size_t _section = 0;
+    size_t _item = 0;
+    bool _started = false;
+    bool _caching;
+    string _copy;
+
+    void keep(const string& chunk)
+    {
+        if (!_caching) {
+            return;
+        }
+        if (_copy.size() + chunk.size() > MAX_CACHED_PAGE) {
+            _caching = false;
+            string().swap(_copy);
+            return;
+        }
+        _copy += chunk;
+    }
+};
+
+static void sendPage(httplib::Response &res, shared_ptr<PageStream> page)
+{
+    if (!page->etag().empty()) {
+        setPageHeaders(res, page->etag());
+    }
+    res.set_chunked_content_provider("text/html", [page](size_t, httplib::DataSink& sink) {
+        return page->write(sink);
+    });
+}
+
+static void selectTab(PageStream& out, const char* tab_id)
 {
-    ostringstream out;
     out << html::tag("script", html::echo(
         "let tab = document.getElementById(\"", tab_id, "\");",
         "tab.classList.add('selected');"
     ));
-    return out.str();
 }
 
-static string showSeatForm(const string& movie, const string& theater, SeatMask available_seats)
+static void showSeatForm(PageStream& out, const string& movie, const string& theater, StartTime start,
+                         size_t seats_per_row, const SeatSet& available_seats)
 {
-    ostringstream out;
-    out << html::li(false, html::echo(hex, available_seats));
+    if (start != 0) {
+        out << html::tag("h1", html::echo("Book your seat(s) at ", formatStartTime(start), ':'));
+    } else {
+        out << html::tag("h1", "Book your seat(s):");
+    }
+    out << html::li(false, html::echo(available_seats.count(), " of ", available_seats.size(), " seats available"));
     out << html::tag("script", html::echo(R"(
          document.addEventListener('DOMContentLoaded', function() {
             document.querySelector('.form-container').style.display = 'block';)",
-        "   addSeatMap(\"", movie, "\", \"", theater, "\", ", dec, available_seats, ");"
+        "   addSeatMap(\"", movie, "\", \"", theater, "\", ", start, ", ", available_seats.size(), ", ",
+        seats_per_row, ", \"", available_seats.toRanges(), "\");"
         "});"
         ));
-    return out.str();
 }
 
-void getMovie(const httplib::Request &req, httplib::Response &res)
+/*
+ * List the @a showtimes as items linking to their seat maps, at @a href followed by the name of
+ * the movie, or of the theater if @a by_theater, and the start.
+ */
+static void showShowtimes(PageStream& out, const Service::ShowtimeList& showtimes, const string& href,
+                          bool by_theater)
 {
-    ostringstream out;
+    out << html::tag("h1", "Showtimes:");
+    for (auto& showtime : showtimes) {
+        auto name = by_theater ? showtime.theater : showtime.movie;
+        out << html::li(false, html::a(html::echo(href, name, "&start=", showtime.start),
+                                       html::echo(formatStartTime(showtime.start), ' ', name)));
+    }
+}
 
+void getMovie(const httplib::Request &req, httplib::Response &res)
+{
+    auto timer = make_unique<Metrics::Timer>(Metrics::GET_MOVIE);
     auto selected_movie{req.get_param_value("name")};
     auto selected_theater{req.get_param_value("theater")};
 
-    // show all movies that are showing
-    out << COMMON_HEADER << selectTab("movie");
-    for (auto movie : Service::instance().movies()) {
-        out << html::li(movie == selected_movie, html::a(html::echo("/movie?name=", movie), movie));
+    // a page is cached by the parameters it depends on, and only once it rendered successfully
+    bool seat_map = req.has_param("name") && req.has_param("theater");
+    optional<PageTimes> times;
+    try {
+        times.emplace(req);
+    } catch (invalid_argument e) {
+        errorResponse(res, 400, "BadRequest", e.what());
+        return;
+    }
+    string key;
+    if (auto times_key = times->key(seat_map)) {
+        key = "/movie?";
+        if (req.has_param("name")) {
+            key += "name=" + selected_movie + (seat_map ? "&theater=" + selected_theater : "") + *times_key;
+        }
+    }
+    string etag;
+    try {
+        etag = pageETag(seat_map, selected_movie, selected_theater, times->start);
+    } catch (invalid_argument e) {
+        // not a showing, the page is rendered as not found below
     }
+    if (!etag.empty() && sendCachedPage(req, res, key, etag)) {
+        return;
+    }
+
+    auto page = make_shared<PageStream>(move(timer), key, etag);
+    auto& out = *page;
+
+    // show all movies that are showing
+    out << COMMON_HEADER;
+    selectTab(out, "movie");
+    out.list(Service::instance().movies(), "/movie?name=", selected_movie);
 
     if (req.has_param("name")) {
         // show the list of theaters that are showing the movie
         try {
             out << html::tag("h1", html::echo("Theaters that are showing ",
                     html::tag("span", selected_movie)));
-            for (auto theater : Service::instance().theaters(selected_movie)) {
-                out << html::li(theater == selected_theater,
-                        html::a(html::echo("/movie?name=", selected_movie, "&theater=", theater), theater));
+            out.list(Service::instance().theaters(selected_movie),
+                     "/movie?name=" + selected_movie + "&theater=", selected_theater);
+            if (times->listed) {
+                showShowtimes(out, Service::instance().movieShowtimes(selected_movie, times->from, times->to),
+                              "/movie?name=" + selected_movie + "&theater=", true);
             }
         } catch (invalid_argument e) {
             ostringstream message;
@@ -286,9 +753,12 @@ void getMovie(const httplib::Request &req, httplib::Response &res)
         if (req.has_param("theater")) {
             // show seat map
             try {
-                auto available_seats = Service::instance().availableSeats(selected_movie, selected_theater);
-                out << html::tag("h1", "Book your seat(s):")
-                    << showSeatForm(selected_movie, selected_theater, available_seats);
+                auto& service = Service::instance();
+                auto showing = showingAt(selected_movie, selected_theater, times->start);
+                auto seats_per_row = service.seatsPerRow(showing);
+                auto available_seats = service.availableSeatSet(showing);
+                showSeatForm(out, selected_movie, selected_theater, service.start(showing), seats_per_row,
+                             available_seats);
             } catch (invalid_argument e) {
                 ostringstream message;
                 message << "The movie '" << selected_movie << "' is not showing in '"
@@ -300,31 +770,59 @@ void getMovie(const httplib::Request &req, httplib::Response &res)
     }
 
     out << COMMON_TAIL;
-    res.set_content(out.str(), "text/html");
+    sendPage(res, move(page));
 }
 
 void getTheater(const httplib::Request &req, httplib::Response &res)
 {
-    ostringstream out;
-
+    auto timer = make_unique<Metrics::Timer>(Metrics::GET_THEATER);
     auto selected_theater{req.get_param_value("name")};
     auto selected_movie{req.get_param_value("movie")};
 
-    // show all theaters
-    out << COMMON_HEADER << selectTab("theater");
-    for (auto theater : Service::instance().theaters()) {
-        out << html::li(theater == selected_theater,
-                html::a(html::echo("/theater?name=", theater), theater));
+    // a page is cached by the parameters it depends on, and only once it rendered successfully
+    bool seat_map = req.has_param("name") && req.has_param("movie");
+    optional<PageTimes> times;
+    try {
+        times.emplace(req);
+    } catch (invalid_argument e) {
+        errorResponse(res, 400, "BadRequest", e.what());
+        return;
+    }
+    string key;
+    if (auto times_key = times->key(seat_map)) {
+        key = "/theater?";
+        if (req.has_param("name")) {
+            key += "name=" + selected_theater + (seat_map ? "&movie=" + selected_movie : "") + *times_key;
+        }
+    }
+    string etag;
+    try {
+        etag = pageETag(seat_map, selected_movie, selected_theater, times->start);
+    } catch (invalid_argument e) {
+        // not a showing, the page is rendered as not found below
+    }
+    if (!etag.empty() && sendCachedPage(req, res, key, etag)) {
+        return;
     }
 
+    auto page = make_shared<PageStream>(move(timer), key, etag);
+    auto& out = *page;
+
+    // show all theaters
+    out << COMMON_HEADER;
+    selectTab(out, "theater");
+    out.list(Service::instance().theaters(), "/theater?name=", selected_theater);
+
     if (req.has_param("name")) {
         // show the list of movies that are showing in current theater
         try {
             out << html::tag("h1", html::echo("Movies that are showing in ",
                     html::tag("span", selected_theater), ':'));
-            for (auto movie : Service::instance().movies(selected_theater)) {
-                out << html::li(movie == selected_movie,
-                        html::a(html::echo("/theater?name=", selected_theater, "&movie=", movie), movie));
+            out.list(Service::instance().movies(selected_theater),
+                     "/theater?name=" + selected_theater + "&movie=", selected_movie);
+            if (times->listed) {
+                showShowtimes(out, Service::instance().theaterShowtimes(selected_theater, times->from, times->to),
+                              "/theater?name=" + selected_theater + "&movie=", false);
             }
         } catch (invalid_argument e) {
             ostringstream message;
@@ -336,9 +834,12 @@ void getTheater(const httplib::Request &req, httplib::Response &res)
         if (req.has_param("movie")) {
             // show seat map
             try {
-                auto available_seats = Service::instance().availableSeats(selected_movie, selected_theater);
-                out << html::tag("h1", "Book your seat(s):")
-                    << showSeatForm(selected_movie, selected_theater, available_seats);
+                auto& service = Service::instance();
+                auto showing = showingAt(selected_movie, selected_theater, times->start);
+                auto seats_per_row = service.seatsPerRow(showing);
+                auto available_seats = service.availableSeatSet(showing);
+                showSeatForm(out, selected_movie, selected_theater, service.start(showing), seats_per_row,
+                             available_seats);
             } catch (invalid_argument e) {
                 ostringstream message;
                 message << "The theater '" << selected_theater << "' is not showing the movie '"
@@ -350,16 +851,134 @@ void getTheater(const httplib::Request &req, httplib::Response &res)
     }
 
     out << COMMON_TAIL;
-    res.set_content(out.str(), "text/html");
+    sendPage(res, move(page));
 }
 
+void getStatic(const httplib::Request &req, httplib::Response &res)
+{
+    const StaticAsset* asset = nullptr;
+    for (auto* a : {&stylesheet, &script}) {
+        if (req.path == a->path()) {
+            asset = a;
+        }
+    }
+    if (!asset) {
+        errorResponse(res, 404, "PageNotFound", "There is no " + req.path);
+        return;
+    }
+
+    auto encoded = asset->encodedFor(req.get_header_value("Accept-Encoding"));
+    if (!encoded.encoding.empty()) {
+        res.set_header("Content-Encoding", string(encoded.encoding));
+    }
+    res.set_header("Vary", "Accept-Encoding");
+    // the name changes with the content, so what is under it is good for as long as a browser keeps it
+    res.set_header("Cache-Control", "public, max-age=31536000, immutable");
+    res.set_content(encoded.body, asset->contentType());
+}
+
+// the keys of the requests answered lately, for a day, or until as many newer ones came
+static IdempotencyCache idempotency_cache(1 << 16, chrono::hours(24));
+
+/*
+ * Carries out the request of the handler it is made in once, however many times it is sent
+ * with the same Idempotency-Key: the first one claims the key, and its response is kept
+ * when the handler returns. A retry is answered with that response, with 409 while the first
+ * one is still being carried out, and with 422 if it is another request under the same key.
+ * Requests without a key are carried out every time.
+ */
+class IdempotentRequest
+{
+public:
+    IdempotentRequest(const httplib::Request &req, httplib::Response &res)
+        : _res(res), _key(req.get_header_value("Idempotency-Key"))
+    {
+        if (!req.has_header("Idempotency-Key")) {
+            return;
+        }
+        if (_key.empty() || _key.size() > MAX_KEY_SIZE) {
+            errorResponse(res, 400, "BadRequest", "The Idempotency-Key is empty or longer than "
+                          + to_string(MAX_KEY_SIZE) + " bytes");
+            _answered = true;
+            return;
+        }
+        // what the request asks for, which a retry asks for again
+        string request = req.path;
+        for (auto& [name, value] : req.params) {
+            request += '\n' + name + '=' + value;
+        }
+        IdempotencyCache::Response response;
+        switch (idempotency_cache.claim(_key, request, response)) {
+        case IdempotencyCache::CLAIMED:
+            _claimed = true;
+            return;
+        case IdempotencyCache::DONE:
+            res.status = response.status;
+            if (!response.content_type.empty()) {
+                res.set_content(move(response.body), response.content_type);
+            }
+            res.set_header("Idempotent-Replayed", "true");
+            break;
+        case IdempotencyCache::IN_PROGRESS:
+            errorResponse(res, 409, "RequestInProgress", "A request with this Idempotency-Key is being carried out");
+            break;
+        case IdempotencyCache::MISMATCH:
+            errorResponse(res, 422, "IdempotencyKeyReused", "The Idempotency-Key was sent with another request");
+            break;
+        }
+        _answered = true;
+    }
+
+    ~IdempotentRequest()
+    {
+        if (!_claimed) {
+            return;
+        }
+        // a request that failed with an exception may not have been carried out, so it is again
+        if (uncaught_exceptions() != _exceptions) {
+            idempotency_cache.release(_key);
+        } else {
+            idempotency_cache.finish(_key, {_res.status, _res.get_header_value("Content-Type"), _res.body});
+        }
+    }
+
+    // whether the request is answered already, and not to be carried out
+    bool answered() const
+    {
+        return _answered;
+    }
+
+private:
+    static constexpr size_t MAX_KEY_SIZE = 255;
+
+    httplib::Response& _res;
+    string _key;
+    bool _claimed = false;
+    bool _answered = false;
+    int _exceptions = uncaught_exceptions();
+};
+
 void postBook(const httplib::Request &req, httplib::Response &res)
 {
+    const Metrics::Timer timer(Metrics::POST_BOOK);
+    const IdempotentRequest once(req, res);
+    if (once.answered()) {
+        return;
+    }
     auto movie = req.get_param_value("movie");
     auto theater = req.get_param_value("theater");
-    auto seatMask = stoul(req.get_param_value("seatMask"));
     try {
-        if (!Service::instance().book(movie, theater, seatMask)) {
+        auto& service = Service::instance();
+        auto showing = showingOf(req, movie, theater);
+        bool booked;
+        if (req.has_param("seats")) {
+            // seat ranges like "1-5,9", for venues of any size
+            auto seats = SeatSet::fromRanges(req.get_param_value("seats"), service.seatCount(showing));
+            booked = service.book(showing, seats);
+        } else {
+            booked = service.book(showing, numberParam<SeatMask>(req, "seatMask"));
+        }
+        if (!booked) {
             errorResponse(res, 409, "SeatAlreadyBooked", "The seat(s) you are booking are not available");
         }
     } catch(invalid_argument e) {
@@ -367,4 +986,523 @@ void postBook(const httplib::Request &req, httplib::Response &res)
     }
 }
 
+static SeatPreference seatPreference(const string& name)
+{
+    if (name.empty() || name == "center") {
+        return SeatPreference::CENTER;
+    } else if (name == "front") {
+        return SeatPreference::FRONT;
+    } else if (name == "back") {
+        return SeatPreference::BACK;
+    }
+    throw invalid_argument("seatPreference: unknown preference");
+}
+
+void postBookBest(const httplib::Request &req, httplib::Response &res)
+{
+    const IdempotentRequest once(req, res);
+    if (once.answered()) {
+        return;
+    }
+    auto movie = req.get_param_value("movie");
+    auto theater = req.get_param_value("theater");
+    try {
+        auto count = numberParam<size_t>(req, "count");
+        auto seats = Service::instance().bookBest(showingOf(req, movie, theater), count,
+                seatPreference(req.get_param_value("preference")));
+        if (seats.none()) {
+            errorResponse(res, 409, "SeatAlreadyBooked", "There are not enough adjacent seats available");
+            return;
+        }
+        auto& out = jsonBuffer();
+        json::Writer(out).beginObject().member("seats", seats.toRanges()).endObject();
+        res.set_content(out, "application/json");
+    } catch(invalid_argument e) {
+        errorResponse(res, 500, "InternalServerError", e.what());
+    }
+}
+
+/*
+ * The bookings come as repeated movie/theater/seats triples, either in the query string or in an
+ * application/x-www-form-urlencoded body, e.g.
+ *   movie=Back+to+Black&theater=Galaxy+Cinemas&seats=1-4&movie=Back+to+Black&theater=Cinema+Paradiso&seats=5
+ * with a start for every booking, or for none, to book showings that are not the first ones.
+ */
+void postBookBatch(const httplib::Request &req, httplib::Response &res)
+{
+    const IdempotentRequest once(req, res);
+    if (once.answered()) {
+        return;
+    }
+    auto count = req.get_param_value_count("movie");
+    if (req.get_param_value_count("theater") != count || req.get_param_value_count("seats") != count) {
+        errorResponse(res, 400, "BadRequest", "Every booking needs a movie, a theater and seats");
+        return;
+    }
+    auto starts = req.get_param_value_count("start");
+    if (starts != 0 && starts != count) {
+        errorResponse(res, 400, "BadRequest", "A start goes with every booking or none");
+        return;
+    }
+    try {
+        auto& service = Service::instance();
+        vector<Service::Booking> bookings;
+        bookings.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            auto movie = req.get_param_value("movie", i);
+            auto theater = req.get_param_value("theater", i);
+            auto start = startParam(req, i);
+            auto seats = SeatSet::fromRanges(req.get_param_value("seats", i),
+                                             service.seatCount(showingAt(movie, theater, start)));
+            bookings.push_back({move(movie), move(theater), move(seats), start});
+        }
+        if (!service.bookBatch(bookings)) {
+            errorResponse(res, 409, "SeatAlreadyBooked", "The seat(s) you are booking are not available");
+        }
+    } catch(invalid_argument e) {
+        errorResponse(res, 500, "InternalServerError", e.what());
+    }
+}
+
+/*
+ * Seats are held for "ttl" seconds, from 1 to 900 and 120 unless given, e.g.
+ *   movie=Back+to+Black&theater=Galaxy+Cinemas&seats=1-4&ttl=300
+ * and the hold id comes back as a string, as it may not fit in a JavaScript number.
+ */
+void postHold(const httplib::Request &req, httplib::Response &res)
+{
+    static constexpr chrono::seconds DEFAULT_TTL{120};
+    static constexpr chrono::seconds MAX_TTL{900};
+
+    const IdempotentRequest once(req, res);
+    if (once.answered()) {
+        return;
+    }
+    auto ttl = DEFAULT_TTL;
+    try {
+        if (req.has_param("ttl")) {
+            ttl = chrono::seconds(numberParam<uint32_t>(req, "ttl"));
+        }
+    } catch (invalid_argument e) {
+        ttl = {};
+    }
+    if (ttl < chrono::seconds(1) || ttl > MAX_TTL) {
+        errorResponse(res, 400, "BadRequest", "The ttl is from 1 to 900 seconds");
+        return;
+    }
+    auto movie = req.get_param_value("movie");
+    auto theater = req.get_param_value("theater");
+    try {
+        auto& service = Service::instance();
+        auto showing = showingOf(req, movie, theater);
+        auto seats = SeatSet::fromRanges(req.get_param_value("seats"), service.seatCount(showing));
+        auto hold = service.hold(showing, seats, ttl);
+        if (hold == 0) {
+            errorResponse(res, 409, "SeatAlreadyBooked", "The seat(s) you are holding are not available");
+            return;
+        }
+        auto& out = jsonBuffer();
+        json::Writer(out).beginObject().member("hold", to_string(hold)).endObject();
+        res.set_content(out, "application/json");
+    } catch(invalid_argument e) {
+        errorResponse(res, 500, "InternalServerError", e.what());
+    }
+}
+
+static void endHold(const httplib::Request &req, httplib::Response &res, bool confirm)
+{
+    try {
+        auto hold = numberParam<HoldId>(req, "hold");
+        auto& service = Service::instance();
+        if (!(confirm ? service.confirm(hold) : service.release(hold))) {
+            errorResponse(res, 410, "HoldExpired", "The hold has expired or ended already");
+        }
+    } catch(invalid_argument e) {
+        errorResponse(res, 500, "InternalServerError", e.what());
+    }
+}
+
+void postHoldConfirm(const httplib::Request &req, httplib::Response &res)
+{
+    endHold(req, res, true);
+}
+
+void postHoldRelease(const httplib::Request &req, httplib::Response &res)
+{
+    endHold(req, res, false);
+}
+
+/*
+ * Server-Sent Events with the available seats of a showing, sent when the stream starts and again
+ * whenever a booking changes them, e.g.
+ *   id: 7
+ *   event: seats
+ *   data: {"version": 7, "available": "1-4,9"}
+ * A browser that reconnects sends the last id it got as Last-Event-ID, and is only sent the seats
+ * again if they have changed since. If the showing is taken off the catalog, the stream ends
+ * with an event "removed".
+ *
+ * Each open stream keeps one server worker waiting, so only so many are open at once, and each
+ * ends after a while for the browser to reconnect, which lets the others have a turn. A stream
+ * that finds no slot is answered 503, and the page polls /api/v1/seats instead.
+ */
+static StreamSlots seat_streams(StreamSlots::forWorkers(8));
+
+void setMaxSeatStreams(size_t streams)
+{
+    seat_streams.setLimit(streams);
+}
+
+void getSeatStream(const httplib::Request &req, httplib::Response &res)
+{
+    static constexpr chrono::seconds KEEP_ALIVE{15};
+    static constexpr chrono::minutes LIFETIME{2};
+
+    auto movie = req.get_param_value("movie");
+    auto theater = req.get_param_value("theater");
+    ShowingId showing;
+    try {
+        showing = showingOf(req, movie, theater);
+    } catch (invalid_argument e) {
+        ostringstream message;
+        message << "The movie '" << movie << "' is not showing in '" << theater << "': " << e.what();
+        errorResponse(res, 404, "PageNotFound", message.str());
+        return;
+    }
+
+    // versions count up from 0, so this one is never current
+    uint64_t sent = ~uint64_t{0};
+    if (req.has_header("Last-Event-ID")) {
+        auto last = req.get_header_value("Last-Event-ID");
+        from_chars(last.data(), last.data() + last.size(), sent);
+    }
+
+    auto slot = seat_streams.take();
+    if (!slot) {
+        res.set_header("Retry-After", "60");
+        errorResponse(res, 503, "TooManyStreams", "Too many seat maps are streamed, poll /api/v1/seats instead");
+        return;
+    }
+
+    auto ends = chrono::steady_clock::now() + LIFETIME;
+    res.set_header("Cache-Control", "no-cache");
+    res.set_chunked_content_provider("text/event-stream",
+                                     [showing, sent, ends, slot](size_t, httplib::DataSink& sink) mutable {
+        auto& service = Service::instance();
+        auto left = chrono::duration_cast<chrono::milliseconds>(ends - chrono::steady_clock::now());
+        if (left <= chrono::milliseconds(0)) {
+            // the browser reconnects, and is sent the seats if they changed meanwhile
+            sink.done();
+            return true;
+        }
+        uint64_t version;
+        SeatSet available;
+        try {
+            version = service.version(showing);
+            if (version == sent) {
+                version = service.waitForChange(showing, sent, min<chrono::milliseconds>(KEEP_ALIVE, left));
+            }
+            if (version != sent) {
+                available = service.availableSeatSet(showing);
+            }
+        } catch (invalid_argument e) {
+            // the showing was taken off the catalog, tell the browser and end the stream
+            string event = "event: removed\ndata: {}\n\n";
+            sink.write(event.data(), event.size());
+            sink.done();
+            return true;
+        }
+        string event;
+        if (version == sent) {
+            // a comment keeps proxies from closing an idle stream, and finds out if the browser is gone
+            event = ": keep-alive\n\n";
+        } else {
+            event = "id: " + to_string(version) + "\nevent: seats\n"
+                    "data: {\"version\": " + to_string(version) + ", \"available\": \"" + available.toRanges() + "\"}\n\n";
+            sent = version;
+        }
+        return sink.write(event.data(), event.size());
+    });
+}
+
+/*
+ * The JSON API, for clients other than browsers:
+ *   GET /api/v1/movies[?theater=T]    {"movies": ["Back to Black", ...]}
+ *   GET /api/v1/theaters[?movie=M]    {"theaters": ["Cinema Paradiso", ...]}
+ *   GET /api/v1/seats?movie=M&theater=T[&start=S]
+ *       {"movie": M, "theater": T, "start": S, "seats": 480, "seatsPerRow": 24, "version": 3, "available": "11-480"}
+ *   POST /api/v1/book?movie=M&theater=T[&start=S]&seats=1-4    {"booked": "1-4"}
+ *   GET /search?q=Q[&limit=N]    {"movies": ["Back to Black", ...], "theaters": [...]}
+ * where a start picks the showing of the movie in the theater that starts then, rather than the first,
+ * and a search lists up to N movies and N theaters, 10 unless given, with a word that starts with Q.
+ * Unknown movies, theaters and showings are answered with 404, taken seats with 409.
+ */
+static void sendNames(httplib::Response &res, const char* key, const Service::NameList& names)
+{
+    auto& out = jsonBuffer();
+    json::Writer json(out);
+    json.beginObject().key(key).beginArray();
+    for (auto name : names) {
+        json.value(name);
+    }
+    json.endArray().endObject();
+    res.set_content(out, "application/json");
+}
+
+void getApiMovies(const httplib::Request &req, httplib::Response &res)
+{
+    try {
+        auto& service = Service::instance();
+        sendNames(res, "movies", req.has_param("theater") ? service.movies(req.get_param_value("theater"))
+                                                          : service.movies());
+    } catch (invalid_argument e) {
+        errorResponse(res, 404, "PageNotFound", e.what());
+    }
+}
+
+void getApiTheaters(const httplib::Request &req, httplib::Response &res)
+{
+    try {
+        auto& service = Service::instance();
+        sendNames(res, "theaters", req.has_param("movie") ? service.theaters(req.get_param_value("movie"))
+                                                          : service.theaters());
+    } catch (invalid_argument e) {
+        errorResponse(res, 404, "PageNotFound", e.what());
+    }
+}
+
+void getApiSeats(const httplib::Request &req, httplib::Response &res)
+{
+    auto movie = req.get_param_value("movie");
+    auto theater = req.get_param_value("theater");
+    try {
+        auto& service = Service::instance();
+        auto showing = showingOf(req, movie, theater);
+        // the version first, so the seats are at least as new as it says
+        auto version = service.version(showing);
+        auto& out = jsonBuffer();
+        json::Writer(out).beginObject()
+            .member("movie", movie)
+            .member("theater", theater)
+            .member("start", service.start(showing))
+            .member("seats", service.seatCount(showing))
+            .member("seatsPerRow", service.seatsPerRow(showing))
+            .member("version", version)
+            .member("available", service.availableSeatSet(showing).toRanges())
+            .endObject();
+        res.set_content(out, "application/json");
+    } catch (invalid_argument e) {
+        errorResponse(res, 404, "PageNotFound", e.what());
+    }
+}
+
+// the most names a search lists of each, so a query is answered in as little time as any
+static constexpr size_t MAX_SEARCH_LIMIT = 100;
+// and the longest query, in bytes, as typos are looked for in time and memory that grow with it
+static constexpr size_t MAX_SEARCH_QUERY = 64;
+
+void getSearch(const httplib::Request &req, httplib::Response &res)
+{
+    auto query = req.get_param_value("q");
+    size_t limit = 10;
+    if (query.empty()) {
+        errorResponse(res, 400, "BadRequest", "getSearch: no query");
+        return;
+    }
+    if (query.size() > MAX_SEARCH_QUERY) {
+        errorResponse(res, 400, "BadRequest", "getSearch: the query is longer than " + to_string(MAX_SEARCH_QUERY) + " bytes");
+        return;
+    }
+    if (req.has_param("limit")) {
+        auto value = req.get_param_value("limit");
+        auto [last, error] = from_chars(value.data(), value.data() + value.size(), limit);
+        if (error != errc() || last != value.data() + value.size() || limit == 0 || limit > MAX_SEARCH_LIMIT) {
+            errorResponse(res, 400, "BadRequest", "getSearch: limit is not from 1 to " + to_string(MAX_SEARCH_LIMIT));
+            return;
+        }
+    }
+    auto& service = Service::instance();
+    auto movies = service.searchMovies(query, limit);
+    auto theaters = service.searchTheaters(query, limit);
+    auto& out = jsonBuffer();
+    json::Writer json(out);
+    json.beginObject().key("movies").beginArray();
+    for (auto name : movies) {
+        json.value(name);
+    }
+    json.endArray().key("theaters").beginArray();
+    for (auto name : theaters) {
+        json.value(name);
+    }
+    json.endArray().endObject();
+    res.set_content(out, "application/json");
+}
+
+void postApiBook(const httplib::Request &req, httplib::Response &res)
+{
+    const IdempotentRequest once(req, res);
+    if (once.answered()) {
+        return;
+    }
+    auto movie = req.get_param_value("movie");
+    auto theater = req.get_param_value("theater");
+    auto& service = Service::instance();
+    ShowingId showing;
+    try {
+        showing = showingOf(req, movie, theater);
+    } catch (invalid_argument e) {
+        errorResponse(res, 404, "PageNotFound", e.what());
+        return;
+    }
+    try {
+        auto seats = SeatSet::fromRanges(req.get_param_value("seats"), service.seatCount(showing));
+        if (!service.book(showing, seats)) {
+            errorResponse(res, 409, "SeatAlreadyBooked", "The seat(s) you are booking are not available");
+            return;
+        }
+        auto& out = jsonBuffer();
+        json::Writer(out).beginObject().member("booked", seats.toRanges()).endObject();
+        res.set_content(out, "application/json");
+    } catch (invalid_argument e) {
+        errorResponse(res, 400, "BadRequest", e.what());
+    }
+}
+
+/*
+ * The metrics in the Prometheus text format, e.g.
+ *   bb_bookings_total{result="booked"} 120
+ *   bb_request_duration_seconds_bucket{route="/movie",le="0.000012"} 80
+ *   bb_showing_bookings{showing="7"} 96
+ * where a showing is the id Service::showing() gives. A batch counts once per showing it books,
+ * and a hold once it is confirmed.
+ */
+void getMetrics(const httplib::Request &, httplib::Response &res)
+{
+    static const char* const ROUTES[] = {"/movie", "/theater", "/book"};
+
+    auto sums = Metrics::sums();
+    ostringstream out;
+    out << "# HELP bb_bookings_total Booking attempts, by whether they booked the seats.\n"
+        << "# TYPE bb_bookings_total counter\n"
+        << "bb_bookings_total{result=\"booked\"} " << sums.booked << "\n"
+        << "bb_bookings_total{result=\"conflict\"} " << sums.conflicts << "\n"
+        << "# HELP bb_request_duration_seconds How long requests took to handle.\n"
+        << "# TYPE bb_request_duration_seconds histogram\n";
+    for (size_t r = 0; r < Metrics::ROUTES; ++r) {
+        auto& latency = sums.latencies[r];
+        uint64_t count = 0;
+        for (size_t i = 0; i < Metrics::BUCKETS; ++i) {
+            count += latency.buckets[i];
+            out << "bb_request_duration_seconds_bucket{route=\"" << ROUTES[r] << "\",le=\"";
+            if (i + 1 < Metrics::BUCKETS) {
+                out << Metrics::bound(i) / 1e6;
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << count << "\n";
+        }
+        out << "bb_request_duration_seconds_sum{route=\"" << ROUTES[r] << "\"} " << latency.sum_us / 1e6 << "\n"
+            << "bb_request_duration_seconds_count{route=\"" << ROUTES[r] << "\"} " << latency.count << "\n";
+    }
+    out << "# HELP bb_showing_bookings About how many booking attempts the showings booked the most had.\n"
+        << "# TYPE bb_showing_bookings gauge\n";
+    for (auto& [showing, count] : sums.hot) {
+        out << "bb_showing_bookings{showing=\"" << showing << "\"} " << count << "\n";
+    }
+    res.set_content(out.str(), "text/plain; version=0.0.4");
+}
+
+static string admin_token;
+
+void setAdminToken(const string& token)
+{
+    admin_token = token;
+}
+
+/*
+ * Whether the request carries the admin token as "Authorization: Bearer TOKEN", compared in
+ * constant time so that the response time gives nothing away. Answers 401 if it does not.
+ */
+static bool authorized(const httplib::Request &req, httplib::Response &res)
+{
+    static constexpr const char * BEARER = "Bearer ";
+    auto header = req.get_header_value("Authorization");
+    bool matches = !admin_token.empty() && header.size() == strlen(BEARER) + admin_token.size()
+                   && header.compare(0, strlen(BEARER), BEARER) == 0;
+    unsigned char differ = 0;
+    for (size_t i = 0; matches && i < admin_token.size(); ++i) {
+        differ |= header[strlen(BEARER) + i] ^ admin_token[i];
+    }
+    if (!matches || differ != 0) {
+        res.set_header("WWW-Authenticate", "Bearer");
+        errorResponse(res, 401, "Unauthorized", "This takes the admin token");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * The showings come as repeated movie/theater pairs, in the query string or in a form body, each
+ * with an optional start, and optional seats and seats_per_row when adding, given for all of them
+ * or for none.
+ */
+static vector<Service::CatalogEntry> catalogEntries(const httplib::Request &req, bool adding)
+{
+    auto count = req.get_param_value_count("movie");
+    if (count == 0 || req.get_param_value_count("theater") != count) {
+        throw invalid_argument("catalogEntries: every showing needs a movie and a theater");
+    }
+    auto seats = adding ? req.get_param_value_count("seats") : 0;
+    auto seats_per_row = adding ? req.get_param_value_count("seats_per_row") : 0;
+    auto starts = req.get_param_value_count("start");
+    if ((seats != 0 && seats != count) || (seats_per_row != 0 && seats_per_row != count)
+        || (starts != 0 && starts != count)) {
+        throw invalid_argument("catalogEntries: start, seats and seats_per_row go with every showing or none");
+    }
+    vector<Service::CatalogEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        entries[i].movie = req.get_param_value("movie", i);
+        entries[i].theater = req.get_param_value("theater", i);
+        if (seats != 0) {
+            entries[i].seats = numberParam<size_t>(req, "seats", i);
+        }
+        if (seats_per_row != 0) {
+            entries[i].seats_per_row = numberParam<size_t>(req, "seats_per_row", i);
+        }
+        entries[i].start = startParam(req, i).value_or(0);
+    }
+    return entries;
+}
+
+static void updateCatalog(const httplib::Request &req, httplib::Response &res, bool adding)
+{
+    if (!authorized(req, res)) {
+        return;
+    }
+    try {
+        auto entries = catalogEntries(req, adding);
+        auto version = adding ? Service::instance().updateCatalog({}, entries)
+                              : Service::instance().updateCatalog(entries, {});
+        // the pages of the old catalog are never asked for again, the removed showings' least of all
+        page_cache.clear();
+        auto& out = jsonBuffer();
+        json::Writer(out).beginObject().member("catalogVersion", version).endObject();
+        res.set_content(out, "application/json");
+    } catch (invalid_argument e) {
+        errorResponse(res, 400, "BadRequest", e.what());
+    } catch (system_error e) {
+        errorResponse(res, 500, "InternalServerError", e.what());
+    }
+}
+
+void postShowings(const httplib::Request &req, httplib::Response &res)
+{
+    updateCatalog(req, res, true);
+}
+
+void deleteShowings(const httplib::Request &req, httplib::Response &res)
+{
+    updateCatalog(req, res, false);
+}
+
 }   // namespace bb
@@ -3,6 +3,9 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <string>
+
 namespace httplib {
     class Request;
     class Response;
@@ -12,6 +15,28 @@ namespace bb {
 
 void getMovie(const httplib::Request &req, httplib::Response &res);
 void getTheater(const httplib::Request &req, httplib::Response &res);
+void getStatic(const httplib::Request &req, httplib::Response &res);
 void postBook(const httplib::Request &req, httplib::Response &res);
+void postBookBest(const httplib::Request &req, httplib::Response &res);
+void postBookBatch(const httplib::Request &req, httplib::Response &res);
+void postHold(const httplib::Request &req, httplib::Response &res);
+void postHoldConfirm(const httplib::Request &req, httplib::Response &res);
+void postHoldRelease(const httplib::Request &req, httplib::Response &res);
+// the seat maps streamed at once, StreamSlots::forWorkers() the server workers
+void setMaxSeatStreams(std::size_t streams);
+void getSeatStream(const httplib::Request &req, httplib::Response &res);
+void getMetrics(const httplib::Request &req, httplib::Response &res);
+
+// the JSON API
+void getApiMovies(const httplib::Request &req, httplib::Response &res);
+void getApiTheaters(const httplib::Request &req, httplib::Response &res);
+void getApiSeats(const httplib::Request &req, httplib::Response &res);
+void postApiBook(const httplib::Request &req, httplib::Response &res);
+void getSearch(const httplib::Request &req, httplib::Response &res);
+
+// the catalog admin routes, which take the token as "Authorization: Bearer TOKEN"
+void setAdminToken(const std::string& token);
+void postShowings(const httplib::Request &req, httplib::Response &res);
+void deleteShowings(const httplib::Request &req, httplib::Response &res);
 
 }   // namespace bb
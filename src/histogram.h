@@ -0,0 +1,109 @@
+/*
+ * A latency histogram of bounded relative error, in the manner of HdrHistogram
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bb {
+
+/**
+ * @internal
+ * Counts of values, such as latencies in microseconds, in buckets that grow with the values:
+ * every power of two is split into 128 buckets, so a value is known to within 1/128 of it, and
+ * the values below 256 exactly. Recording is an increment, whatever the value, and the memory is
+ * fixed, 58 KiB, for any value up to 2^64.
+ *
+ * It is not thread-safe; every thread records into its own and they are merged at the end.
+ */
+class Histogram
+{
+    static constexpr unsigned SUB_BITS = 7;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS) * SUB_BUCKETS + SUB_BUCKETS;
+
+    std::vector<std::uint64_t> _counts = std::vector<std::uint64_t>(BUCKETS);
+    std::uint64_t _count = 0;
+    std::uint64_t _max = 0;
+
+    static unsigned shiftOf(std::uint64_t value)
+    {
+        unsigned bits = 0;
+        for (std::uint64_t v = value >> SUB_BITS; v > 1; v >>= 1) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    static std::size_t bucketOf(std::uint64_t value)
+    {
+        unsigned shift = shiftOf(value);
+        return shift * SUB_BUCKETS + (value >> shift);
+    }
+
+    /**
+     * The highest value that goes to @a bucket.
+     */
+    static std::uint64_t highestOf(std::size_t bucket)
+    {
+        if (bucket < 2 * SUB_BUCKETS) {
+            return bucket;
+        }
+        unsigned shift = bucket / SUB_BUCKETS - 1;
+        std::uint64_t first = std::uint64_t(bucket - shift * SUB_BUCKETS) << shift;
+        return first + ((std::uint64_t{1} << shift) - 1);
+    }
+
+public:
+    void record(std::uint64_t value)
+    {
+        ++_counts[bucketOf(value)];
+        ++_count;
+        _max = std::max(_max, value);
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            _counts[i] += other._counts[i];
+        }
+        _count += other._count;
+        _max = std::max(_max, other._max);
+    }
+
+    std::uint64_t count() const
+    {
+        return _count;
+    }
+
+    std::uint64_t max() const
+    {
+        return _max;
+    }
+
+    /**
+     * The value that @a percentile percent of the values are at most, to within the precision
+     * of the buckets, and never more than the largest value; 0 if there are none.
+     */
+    std::uint64_t percentile(double percentile) const
+    {
+        if (_count == 0) {
+            return 0;
+        }
+        auto rank = std::uint64_t(percentile / 100 * _count + 0.5);
+        rank = std::clamp<std::uint64_t>(rank, 1, _count);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += _counts[i];
+            if (seen >= rank) {
+                return std::min(highestOf(i), _max);
+            }
+        }
+        return _max;
+    }
+};
+
+}   // namespace bb
@@ -1,12 +1,17 @@
 /**
  * @file html.h
- * @brief IO manipulators for inserting HTML tags into an ostream.
+ * @brief Compile-time HTML builders for rendering tags into a buffer or an ostream.
  */
 
 #pragma once
 
-#include <functional>
+#include <charconv>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 /**
  * @brief The namespace for this project, a.k.a. [B]oring [B]ooking.
@@ -14,124 +19,229 @@
 namespace bb {
 
 /**
- * @brief Make the lambda form of IO manipulators work with ostream using the "<<" operator.
+ * @brief The namespace for HTML builders.
+ *
+ * A builder such as `html::li(selected, html::a(html::echo("/movie?name=", movie), movie))` is
+ * a small tree of plain structs whose shape is known at compile time. Inserting it into a
+ * Buffer appends its parts one after another, with no type erasure and no allocation once the
+ * buffer has grown to the size of a page.
+ *
+ * Strings passed as lvalues are referred to rather than copied, so a builder must be used
+ * within the full-expression that creates it, e.g. `out << html::tag("h1", title);`.
+ */
+namespace html {
+
+using ostream = std::ostream;
+
+/**
+ * @internal
+ * how a builder keeps an argument: lvalue strings by reference, everything else by value
  */
 template<typename T>
-std::ostream& operator<<(std::ostream& out, std::function<T> t)
-{
-    return t(out);
-}
+using stored_t = std::conditional_t<
+    std::is_same_v<std::decay_t<T>, std::string> && std::is_lvalue_reference_v<T>,
+    std::string_view, std::decay_t<T>>;
 
 /**
- * @brief The namespace for HTML IO manipulators.
+ * @internal
+ * the parts of a builder, appended in order
  */
-namespace html {
+template<typename... Ts>
+struct Echo
+{
+    std::tuple<Ts...> parts;
+};
 
-using ostream = std::ostream;
-using tagger = std::function<ostream&(ostream&)>;
+/**
+ * @internal
+ * an li tag that may be selected
+ */
+template<typename T>
+struct Li
+{
+    bool selected;
+    T content;
+};
 
 /**
  * @internal
- * insert all values to the output stream `out`, like the echo command
+ * whether T is one of the builders above
  */
 template<typename T>
-void do_echo_(ostream& out, T t)
+struct is_builder : std::false_type {};
+template<typename... Ts>
+struct is_builder<Echo<Ts...>> : std::true_type {};
+template<typename T>
+struct is_builder<Li<T>> : std::true_type {};
+
+/**
+ * @internal
+ * append a value to a string
+ */
+inline void emit(std::string& out, std::string_view s)
+{
+    out.append(s);
+}
+
+inline void emit(std::string& out, const char* s)
 {
-    out << t;
+    out.append(s);
+}
+
+inline void emit(std::string& out, char c)
+{
+    out.push_back(c);
+}
+
+template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+void emit(std::string& out, T value)
+{
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
 }
 
 /**
  * @internal
- * insert all values to the output stream `out`, like the echo command
+ * insert a value into an ostream
+ */
+template<typename T, typename = std::enable_if_t<!is_builder<T>::value>>
+void emit(ostream& out, const T& value)
+{
+    out << value;
+}
+
+template<typename Out, typename... Ts>
+void emit(Out& out, const Echo<Ts...>& echo)
+{
+    std::apply([&out](const auto&... parts) { (emit(out, parts), ...); }, echo.parts);
+}
+
+template<typename Out, typename T>
+void emit(Out& out, const Li<T>& li)
+{
+    emit(out, li.selected ? "<li class=\"selected\">" : "<li>");
+    emit(out, li.content);
+    emit(out, "</li>");
+}
+
+/**
+ * @brief A buffer to render a page into.
+ *
+ * Clearing a buffer keeps its capacity, so a buffer reused for every page rendered by a thread
+ * stops allocating once it has grown to the largest page.
  */
-template<typename T, typename... Tail>
-void do_echo_(ostream& out, T t, Tail... tail)
+class Buffer
+{
+public:
+    template<typename T>
+    Buffer& operator<<(const T& value)
+    {
+        emit(_data, value);
+        return *this;
+    }
+
+    void clear() { _data.clear(); }
+    void reserve(std::size_t size) { _data.reserve(size); }
+    std::size_t size() const { return _data.size(); }
+    const std::string& str() const { return _data; }
+
+private:
+    std::string _data;
+};
+
+/**
+ * @brief Insert a builder into an ostream using the "<<" operator.
+ */
+template<typename... Ts>
+ostream& operator<<(ostream& out, const Echo<Ts...>& echo)
+{
+    emit(out, echo);
+    return out;
+}
+
+template<typename T>
+ostream& operator<<(ostream& out, const Li<T>& li)
 {
-    out << t;
-    do_echo_(out, tail...);
+    emit(out, li);
+    return out;
 }
 
 /**
- * @brief an IO manipulator for echoing arbitrary arguments to an ostream.
- * @param t the first argument to append to the ostream
- * @param tail other arguments to append to the ostream
- * @return a lambda that appends all the arguments specified by @a t and @a tail
+ * @brief a builder for echoing arbitrary arguments, like the echo command.
+ * @param parts the strings, characters, numbers or builders to append
+ * @return a builder that appends all the arguments specified by @a parts
  */
-template<typename T, typename... Tail>
-tagger echo(T t, Tail... tail)
+template<typename... Ts>
+Echo<stored_t<Ts>...> echo(Ts&&... parts)
 {
-    return [=](ostream& out) -> ostream& {
-        do_echo_(out, t, tail...);
-        return out;
-    };
+    return {std::tuple<stored_t<Ts>...>(std::forward<Ts>(parts)...)};
 }
 
 /**
- * @brief an IO manipulator for echoing an HTML tag attribute to an ostream.
+ * @brief a builder for echoing an HTML tag attribute.
  * @param name name of the attribute
  * @param value value of the attribute
- * @return a lambda that appends the attribute to an ostream in the form of ' ${name}="${value}"'
+ * @return a builder that appends the attribute in the form of ' ${name}="${value}"'
  */
 template<typename T, typename U>
-tagger attr(T name, U value)
+auto attr(T&& name, U&& value)
 {
-    return echo(' ', name, "=\"", value, '"');
+    return echo(' ', std::forward<T>(name), "=\"", std::forward<U>(value), '"');
 }
 
 /**
- * @brief an IO manipulator for echoing an HTML tag to an ostream.
+ * @brief a builder for echoing an HTML tag.
  * @param name name of the HTML tag
  * @param attributes attributes of the tag
  * @param content content of the tag
- * @return a lambda that appends the HTML tag to an ostream in the form of
+ * @return a builder that appends the HTML tag in the form of
  *         '<${name}${attributes}>${content}</${name}>'
  */
 template<typename T, typename U, typename V>
-tagger tag(T name, U attributes, V content)
+auto tag(const T& name, U&& attributes, V&& content)
 {
-    return echo('<', name, attributes, '>', content, "</", name, '>');
+    return echo('<', name, std::forward<U>(attributes), '>', std::forward<V>(content), "</", name, '>');
 }
 
 /**
- * @brief an IO manipulator for echoing an HTML tag to an ostream, without attributes.
+ * @brief a builder for echoing an HTML tag, without attributes.
  * @param name name of the HTML tag
  * @param content content of the tag
- * @return a lambda that appends the HTML tag to an ostream in the form of
+ * @return a builder that appends the HTML tag in the form of
  *         '<${name}>${content}</${name}>'
  */
 template<typename T, typename U>
-tagger tag(T name, U content)
+auto tag(const T& name, U&& content)
 {
-    return tag(name, "", content);
+    return tag(name, "", std::forward<U>(content));
 }
 
 /**
- * @brief an IO manipulator for echoing an anchor tag to an ostream.
+ * @brief a builder for echoing an anchor tag.
  * @param href value of the href attribute
  * @param content content of the tag
- * @return a lambda that appends the anchor tag to an ostream in the form of
+ * @return a builder that appends the anchor tag in the form of
  *         '<a href="${href}">${content}</a>'
  */
 template<typename T, typename U>
-tagger a(T href, U content)
+auto a(T&& href, U&& content)
 {
-    return tag("a", attr("href", href), content);
+    return tag("a", attr("href", std::forward<T>(href)), std::forward<U>(content));
 }
 
 /**
- * @brief an IO manipulator for echoing an li tag to an ostream.
+ * @brief a builder for echoing an li tag.
  * @param selected whether this item is selected
  * @param content content of the tag
- * @return a lambda that appends the li tag to an ostream in the form of
- *         '<li>${content}</li>' or '<li class="selected">${content} if selected is true
+ * @return a builder that appends the li tag in the form of
+ *         '<li>${content}</li>' or '<li class="selected">${content}</li>' if selected is true
  */
 template<typename T>
-tagger li(bool selected, T content)
+Li<stored_t<T>> li(bool selected, T&& content)
 {
-    return selected ?
-        tag("li", attr("class", "selected"), content) :
-        tag("li", content);
+    return {selected, std::forward<T>(content)};
 }
 
-}   // namespace tag
+}   // namespace html
 }   // namespace bb
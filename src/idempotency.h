@@ -0,0 +1,193 @@
+/*
+ * The responses to requests that carry an Idempotency-Key, for answering their retries
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace bb {
+
+/**
+ * @internal
+ * The response to every request sent with an Idempotency-Key, so that a client that retries a
+ * request it got no answer to gets the answer of the first one, rather than having it carried
+ * out again. A key is kept with the request it came with, and a retry that is not the same
+ * request is told apart.
+ *
+ * The keys are split into lock-striped shards, each holding up to a fixed number of keys for
+ * up to a fixed time. All keys are kept equally long, so a shard expires them in the order it
+ * was given them, from a queue, and once it is full, it drops the oldest key for a new one.
+ */
+class IdempotencyCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Response
+    {
+        int status = -1;
+        std::string content_type;
+        std::string body;
+    };
+
+    enum Claim
+    {
+        CLAIMED,        // the key is new, the request is to be carried out and finish()ed
+        DONE,           // the request was carried out, this is its response
+        IN_PROGRESS,    // the request is being carried out for an earlier copy of it
+        MISMATCH,       // the key came with another request
+    };
+
+    /**
+     * Up to @a capacity keys, each kept for @a ttl after it is claimed.
+     */
+    IdempotencyCache(std::size_t capacity, Clock::duration ttl)
+        : _shard_capacity(std::max<std::size_t>(1, capacity / SHARDS)), _ttl(ttl) {}
+
+    /**
+     * Claim @a key for @a request, a description of what it asks for, unless it has been already.
+     * @return CLAIMED if it had not been, otherwise what became of the request it was claimed
+     * for, with its response in @a response if it is DONE.
+     */
+    Claim claim(const std::string& key, const std::string& request, Response& response,
+                Clock::time_point now = Clock::now())
+    {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m);
+        shard.expire(now);
+        auto [it, claimed] = shard.entries.try_emplace(key);
+        auto& entry = it->second;
+        if (claimed) {
+            entry.request = request;
+            entry.claim = ++shard.claims;
+            shard.order.push_back({now + _ttl, entry.claim, key});
+            if (shard.entries.size() > _shard_capacity) {
+                shard.drop();
+            }
+            return CLAIMED;
+        }
+        if (entry.request != request) {
+            return MISMATCH;
+        }
+        if (!entry.done) {
+            return IN_PROGRESS;
+        }
+        response = entry.response;
+        return DONE;
+    }
+
+    /**
+     * Keep @a response as the one to the request @a key was claimed for. If the key has been
+     * dropped since, the response is not kept, and a retry is carried out again.
+     */
+    void finish(const std::string& key, Response response)
+    {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end() && !it->second.done) {
+            it->second.done = true;
+            it->second.response = std::move(response);
+        }
+    }
+
+    /**
+     * Forget that @a key was claimed, for a request that could not be carried out, so that a
+     * retry is.
+     */
+    void release(const std::string& key)
+    {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end() && !it->second.done) {
+            shard.entries.erase(it);
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t keys = 0;
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.m);
+            keys += shard.entries.size();
+        }
+        return keys;
+    }
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+
+    struct Entry
+    {
+        std::string request;
+        // which claim of the key this is, as a key released can be claimed again
+        std::uint64_t claim = 0;
+        bool done = false;
+        Response response;
+    };
+
+    struct Claimed
+    {
+        Clock::time_point expires;
+        std::uint64_t claim;
+        std::string key;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex m;
+        std::unordered_map<std::string, Entry> entries;
+        // the claims by when they expire, some of them released already
+        std::deque<Claimed> order;
+        std::uint64_t claims = 0;
+
+        void expire(Clock::time_point now)
+        {
+            while (!order.empty() && order.front().expires <= now) {
+                pop();
+            }
+        }
+
+        // drop the oldest key there is
+        void drop()
+        {
+            while (!order.empty() && !pop()) {
+            }
+        }
+
+        // pop the oldest claim, and drop its key if it was not released, return whether it was
+        bool pop()
+        {
+            auto claimed = std::move(order.front());
+            order.pop_front();
+            auto it = entries.find(claimed.key);
+            if (it == entries.end() || it->second.claim != claimed.claim) {
+                return false;
+            }
+            entries.erase(it);
+            return true;
+        }
+    };
+
+    const std::size_t _shard_capacity;
+    const Clock::duration _ttl;
+    std::array<Shard, SHARDS> _shards;
+
+    Shard& shardOf(const std::string& key)
+    {
+        return _shards[std::hash<std::string>{}(key) % SHARDS];
+    }
+};
+
+}   // namespace bb
@@ -0,0 +1,184 @@
+/**
+ * @file json.h
+ * @brief A streaming JSON writer that appends into a reusable buffer.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace bb {
+
+/**
+ * @brief The namespace for writing JSON.
+ */
+namespace json {
+
+/**
+ * @brief Writes a JSON value into a string, as the calls come, with the commas and the escapes
+ * where they belong.
+ *
+ * The string is only appended to, so one that is cleared and reused for every response, such as
+ * a thread_local one, stops allocating once it has grown to the size of a response, e.g.
+ * @code
+ * thread_local std::string out;
+ * json::Writer json(out);
+ * json.beginObject().key("movies").beginArray();
+ * for (auto movie : service.movies()) {
+ *     json.value(movie);
+ * }
+ * json.endArray().endObject();
+ * @endcode
+ * Objects and arrays nest up to 64 deep. The writer does not check that keys and values take
+ * turns.
+ */
+class Writer
+{
+    std::string& _out;
+    // bit i is set while the object or array at depth i has no member yet
+    std::uint64_t _first = 0;
+    unsigned _depth = 0;
+    bool _after_key = false;
+
+    void separate()
+    {
+        if (_after_key) {
+            _after_key = false;
+        } else if (_depth > 0) {
+            std::uint64_t bit = std::uint64_t{1} << (_depth - 1);
+            if (_first & bit) {
+                _first &= ~bit;
+            } else {
+                _out += ',';
+            }
+        }
+    }
+
+    Writer& open(char c)
+    {
+        separate();
+        _out += c;
+        _first |= std::uint64_t{1} << _depth++;
+        return *this;
+    }
+
+    Writer& close(char c)
+    {
+        --_depth;
+        _out += c;
+        return *this;
+    }
+
+    void quoted(std::string_view s)
+    {
+        static constexpr char HEX[] = "0123456789abcdef";
+
+        _out += '"';
+        std::size_t plain = 0;
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            auto c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            _out.append(s.data() + plain, i - plain);
+            plain = i + 1;
+            _out += '\\';
+            switch (c) {
+            case '"': _out += '"'; break;
+            case '\\': _out += '\\'; break;
+            case '\b': _out += 'b'; break;
+            case '\f': _out += 'f'; break;
+            case '\n': _out += 'n'; break;
+            case '\r': _out += 'r'; break;
+            case '\t': _out += 't'; break;
+            default:
+                _out += "u00";
+                _out += HEX[c >> 4];
+                _out += HEX[c & 0xf];
+            }
+        }
+        _out.append(s.data() + plain, s.size() - plain);
+        _out += '"';
+    }
+
+public:
+    /**
+     * @brief Write into @a out, after what it has already.
+     */
+    explicit Writer(std::string& out) : _out(out) {}
+
+    Writer& beginObject() { return open('{'); }
+    Writer& endObject() { return close('}'); }
+    Writer& beginArray() { return open('['); }
+    Writer& endArray() { return close(']'); }
+
+    /**
+     * @brief Write the key of the next member of an object.
+     */
+    Writer& key(std::string_view name)
+    {
+        separate();
+        quoted(name);
+        _out += ':';
+        _after_key = true;
+        return *this;
+    }
+
+    Writer& value(std::string_view s)
+    {
+        separate();
+        quoted(s);
+        return *this;
+    }
+
+    Writer& value(const char* s)
+    {
+        return value(std::string_view(s));
+    }
+
+    Writer& value(const std::string& s)
+    {
+        return value(std::string_view(s));
+    }
+
+    Writer& value(bool b)
+    {
+        separate();
+        _out += b ? "true" : "false";
+        return *this;
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    Writer& value(T n)
+    {
+        separate();
+        char digits[24];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), n);
+        _out.append(digits, end);
+        return *this;
+    }
+
+    Writer& null()
+    {
+        separate();
+        _out += "null";
+        return *this;
+    }
+
+    /**
+     * @brief Write a member of an object, its key and its value.
+     */
+    template<typename T>
+    Writer& member(std::string_view name, const T& v)
+    {
+        return key(name).value(v);
+    }
+};
+
+}   // namespace json
+}   // namespace bb
@@ -0,0 +1,204 @@
+// Drive a bb server with a fixed rate of page views and bookings, and report the latencies
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <httplib/httplib.h>
+
+#include "histogram.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+
+struct Options
+{
+    string host = "localhost";
+    int port = 8080;
+    // requests a second over all connections
+    double rate = 1000;
+    size_t connections = 16;
+    chrono::seconds duration{10};
+    // the weights of the routes, in the order of ROUTES
+    vector<unsigned> mix = {6, 3, 1};
+    // the showing to look at and book, of the built-in catalog unless given
+    string movie = "Kingdom of the Planet of the Apes";
+    string theater = "Scotiabank IMAX";
+    size_t seats = 480;
+    // fail unless the 99th percentile over all requests is at most this, if not 0
+    double max_p99_ms = 0;
+};
+
+const char* const ROUTES[] = {"movie", "theater", "book"};
+constexpr size_t ROUTE_COUNT = size(ROUTES);
+
+struct Results
+{
+    Histogram latencies[ROUTE_COUNT];
+    uint64_t ok[ROUTE_COUNT] = {};
+    // bookings of seats taken already, which are answers like any other
+    uint64_t conflicts[ROUTE_COUNT] = {};
+    uint64_t errors[ROUTE_COUNT] = {};
+};
+
+Options parse(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--host=", 0) == 0) {
+            options.host = arg.substr(7);
+        } else if (arg.rfind("--port=", 0) == 0) {
+            options.port = stoi(arg.substr(7));
+        } else if (arg.rfind("--rate=", 0) == 0) {
+            options.rate = stod(arg.substr(7));
+        } else if (arg.rfind("--connections=", 0) == 0) {
+            options.connections = stoul(arg.substr(14));
+        } else if (arg.rfind("--duration=", 0) == 0) {
+            options.duration = chrono::seconds(stol(arg.substr(11)));
+        } else if (arg.rfind("--mix=", 0) == 0) {
+            // the weights of movie, theater and book, e.g. 6,3,1
+            auto mix = arg.substr(6);
+            options.mix.clear();
+            for (size_t begin = 0, end; begin <= mix.size(); begin = end + 1) {
+                end = min(mix.find(',', begin), mix.size());
+                options.mix.push_back(stoul(mix.substr(begin, end - begin)));
+            }
+        } else if (arg.rfind("--movie=", 0) == 0) {
+            options.movie = arg.substr(8);
+        } else if (arg.rfind("--theater=", 0) == 0) {
+            options.theater = arg.substr(10);
+        } else if (arg.rfind("--seats=", 0) == 0) {
+            options.seats = stoul(arg.substr(8));
+        } else if (arg.rfind("--max-p99-ms=", 0) == 0) {
+            options.max_p99_ms = stod(arg.substr(13));
+        } else {
+            throw invalid_argument("unknown option " + arg);
+        }
+    }
+    if (options.mix.size() != ROUTE_COUNT) {
+        throw invalid_argument("--mix takes a weight for each of movie, theater and book");
+    }
+    if (options.rate <= 0 || options.connections == 0 || options.seats == 0) {
+        throw invalid_argument("--rate, --connections and --seats must be positive");
+    }
+    return options;
+}
+
+/**
+ * Send requests on one connection at the times they are due, every connections / rate seconds,
+ * whether the answers to the ones before came back in time or not. The latency of a request is
+ * taken from when it was due rather than from when it was sent, so a server that stalls is
+ * charged for the requests it held up as well, instead of for only one of them.
+ */
+void drive(const Options& options, size_t connection, chrono::steady_clock::time_point start, Results& results)
+{
+    using clock = chrono::steady_clock;
+    const auto interval = chrono::duration_cast<clock::duration>(
+        chrono::duration<double>(options.connections / options.rate));
+    const auto end = start + options.duration;
+
+    httplib::Client client(options.host, options.port);
+    client.set_keep_alive(true);
+    mt19937_64 random(connection);
+    discrete_distribution<size_t> route(options.mix.begin(), options.mix.end());
+    uniform_int_distribution<size_t> seat(1, options.seats);
+
+    // the connections take turns, rather than all sending at once
+    auto due = start + interval * connection / options.connections;
+    for (; due < end; due += interval) {
+        this_thread::sleep_until(due);
+        size_t r = route(random);
+        httplib::Result res;
+        if (r == 0) {
+            res = client.Get("/movie", {{"name", options.movie}}, {});
+        } else if (r == 1) {
+            res = client.Get("/theater", {{"name", options.theater}}, {});
+        } else {
+            res = client.Post("/book", {{"movie", options.movie}, {"theater", options.theater},
+                                        {"seats", to_string(seat(random))}});
+        }
+        results.latencies[r].record(chrono::duration_cast<chrono::microseconds>(clock::now() - due).count());
+        if (!res) {
+            ++results.errors[r];
+        } else if (res->status == 409) {
+            ++results.conflicts[r];
+        } else if (res->status < 400) {
+            ++results.ok[r];
+        } else {
+            ++results.errors[r];
+        }
+    }
+}
+
+void report(const string& name, const Histogram& latencies, uint64_t ok, uint64_t conflicts, uint64_t errors)
+{
+    auto ms = [&](double percentile) { return latencies.percentile(percentile) / 1000.0; };
+    printf("%-8s %10llu %10llu %10llu %10llu %9.2f %9.2f %9.2f %9.2f\n", name.c_str(),
+           (unsigned long long)latencies.count(), (unsigned long long)ok, (unsigned long long)conflicts,
+           (unsigned long long)errors, ms(50), ms(99), ms(99.9), latencies.max() / 1000.0);
+}
+
+}   // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse(argc, argv);
+    } catch (exception& e) {
+        cerr << "bb_loadgen: " << e.what() << endl
+             << "usage: bb_loadgen [--host=localhost] [--port=8080] [--rate=1000] [--connections=16]" << endl
+             << "                  [--duration=10] [--mix=6,3,1] [--movie=NAME] [--theater=NAME]" << endl
+             << "                  [--seats=480] [--max-p99-ms=MS]" << endl;
+        return 2;
+    }
+
+    vector<Results> results(options.connections);
+    vector<thread> connections;
+    // give every connection the time to start before the first request is due
+    auto start = chrono::steady_clock::now() + chrono::milliseconds(100);
+    for (size_t c = 0; c < options.connections; ++c) {
+        connections.emplace_back(drive, cref(options), c, start, ref(results[c]));
+    }
+    for (auto& connection : connections) {
+        connection.join();
+    }
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Results total;
+    Histogram all;
+    uint64_t ok = 0, conflicts = 0, errors = 0;
+    for (auto& r : results) {
+        for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+            total.latencies[i].merge(r.latencies[i]);
+            total.ok[i] += r.ok[i];
+            total.conflicts[i] += r.conflicts[i];
+            total.errors[i] += r.errors[i];
+        }
+    }
+    printf("%-8s %10s %10s %10s %10s %9s %9s %9s %9s\n", "route", "requests", "ok", "conflicts", "errors",
+           "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+        report(ROUTES[i], total.latencies[i], total.ok[i], total.conflicts[i], total.errors[i]);
+        all.merge(total.latencies[i]);
+        ok += total.ok[i];
+        conflicts += total.conflicts[i];
+        errors += total.errors[i];
+    }
+    report("all", all, ok, conflicts, errors);
+    printf("%.0f requests/s over %.1f s, %.0f requests/s asked for\n", all.count() / elapsed, elapsed, options.rate);
+
+    if (options.max_p99_ms > 0 && all.percentile(99) / 1000.0 > options.max_p99_ms) {
+        cerr << "bb_loadgen: p99 above " << options.max_p99_ms << " ms" << endl;
+        return 1;
+    }
+    return errors == 0 ? 0 : 1;
+}
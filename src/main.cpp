@@ -1,15 +1,62 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <csignal>
+#include <functional>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <httplib/httplib.h>
 
 #include "handlers.h"
+#include "service.h"
+#include "stream_slots.h"
+#include "worker_pool.h"
 
 using namespace std;
 using namespace bb;
 
+/**
+ * The server's requests run on a WorkerPool rather than on httplib's pool, whose workers all
+ * take from one queue.
+ */
+class ServerTaskQueue : public httplib::TaskQueue
+{
+    WorkerPool _pool;
+
+public:
+    ServerTaskQueue(size_t workers, size_t max_queued, bool pin) : _pool(workers, max_queued, pin) {}
+
+    bool enqueue(function<void()> fn) override
+    {
+        return _pool.enqueue(move(fn));
+    }
+
+    void shutdown() override
+    {
+        _pool.shutdown();
+    }
+};
+
+/**
+ * The number after the "=" of the option @a arg, which has to be all of the rest of it.
+ */
+template<typename Number>
+Number number(const string& arg)
+{
+    auto begin = arg.data() + arg.find('=') + 1;
+    auto end = arg.data() + arg.size();
+    Number n{};
+    auto [last, ec] = from_chars(begin, end, n);
+    if (ec != errc() || last != end) {
+        throw invalid_argument("not a number in range: " + arg);
+    }
+    return n;
+}
+
 int main(int argc, char** argv) {
     // ignore Ctrl-C
     signal(SIGINT, [](int signum) {
@@ -19,18 +66,104 @@ int main(int argc, char** argv) {
 
     httplib::Server svr;
 
-    if (argc > 1) {
-        // mount the project doc to /doc 
-        svr.set_mount_point("/doc", argv[1]);
+    Service::Options options;
+    bool admin = false;
+    string host = "0.0.0.0";
+    int port = 8080;
+    // as many workers as httplib would start
+    size_t workers = max(8u, max(2u, thread::hardware_concurrency()) - 1);
+    size_t max_queued = 0;
+    bool pin = false;
+    string doc;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg.rfind("--log=", 0) == 0) {
+                // keep bookings across restarts
+                options.log_path = arg.substr(6);
+            } else if (arg.rfind("--group-commit-us=", 0) == 0) {
+                options.group_commit_window = chrono::microseconds(number<long>(arg));
+            } else if (arg.rfind("--snapshot=", 0) == 0) {
+                // start from the snapshot and checkpoint to it
+                options.snapshot_path = arg.substr(11);
+            } else if (arg.rfind("--checkpoint-ms=", 0) == 0) {
+                options.checkpoint_interval = chrono::milliseconds(number<long>(arg));
+            } else if (arg.rfind("--catalog=", 0) == 0) {
+                // load the showings from a CSV or JSON lines file
+                options.catalog_path = arg.substr(10);
+            } else if (arg.rfind("--load-threads=", 0) == 0) {
+                options.load_threads = number<size_t>(arg);
+            } else if (arg.rfind("--shards=", 0) == 0) {
+                // book each showing on the cores of its shard
+                options.shards = number<size_t>(arg);
+            } else if (arg.rfind("--admin-token=", 0) == 0) {
+                // let whoever has the token add and remove showings
+                setAdminToken(arg.substr(14));
+                admin = true;
+            } else if (arg.rfind("--host=", 0) == 0) {
+                host = arg.substr(7);
+            } else if (arg.rfind("--port=", 0) == 0) {
+                port = number<uint16_t>(arg);
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                workers = number<size_t>(arg);
+            } else if (arg.rfind("--max-queued=", 0) == 0) {
+                // turn connections away once this many wait for a worker
+                max_queued = number<size_t>(arg);
+            } else if (arg == "--pin-threads") {
+                pin = true;
+            } else if (arg.rfind("-", 0) == 0) {
+                throw invalid_argument("unknown option " + arg);
+            } else if (doc.empty()) {
+                // the project doc, to mount to /doc
+                doc = arg;
+            } else {
+                throw invalid_argument("only one doc directory is mounted, not " + arg);
+            }
+        }
+    } catch (exception& e) {
+        cerr << "bb: " << e.what() << endl
+             << "usage: bb [--catalog=FILE] [--log=FILE] [--group-commit-us=US] [--snapshot=FILE]" << endl
+             << "          [--checkpoint-ms=MS] [--load-threads=N] [--shards=N] [--admin-token=TOKEN]" << endl
+             << "          [--host=0.0.0.0] [--port=8080] [--threads=N] [--max-queued=N] [--pin-threads]" << endl
+             << "          [DOC_DIR]" << endl;
+        return 2;
     }
+    if (!doc.empty() && !svr.set_mount_point("/doc", doc)) {
+        cerr << "bb: no directory " << doc << endl;
+        return 2;
+    }
+    Service::configure(options);
+    // load the catalog or open the snapshot, and replay the booking log, before serving anything
+    Service::instance();
 
     svr.Get("/", getMovie);
     svr.Get("/movie", getMovie);
     svr.Get("/theater", getTheater);
+    svr.Get(R"(/static/[^/]+)", getStatic);
     svr.Post("/book", postBook);
+    svr.Post("/book/best", postBookBest);
+    svr.Post("/book/batch", postBookBatch);
+    svr.Post("/hold", postHold);
+    svr.Post("/hold/confirm", postHoldConfirm);
+    svr.Post("/hold/release", postHoldRelease);
+    svr.Get("/seats/stream", getSeatStream);
+    svr.Get("/metrics", getMetrics);
+    svr.Get("/api/v1/movies", getApiMovies);
+    svr.Get("/api/v1/theaters", getApiTheaters);
+    svr.Get("/api/v1/seats", getApiSeats);
+    svr.Post("/api/v1/book", postApiBook);
+    svr.Get("/search", getSearch);
+    if (admin) {
+        svr.Post("/admin/showings", postShowings);
+        svr.Delete("/admin/showings", deleteShowings);
+    }
+
+    // a worker is kept by every seat map streamed, so they are left most of the workers
+    setMaxSeatStreams(StreamSlots::forWorkers(workers));
+    svr.new_task_queue = [=] { return new ServerTaskQueue(workers, max_queued, pin); };
 
-    cout << "Navigate to http://localhost:8080" << endl;
-    svr.listen("0.0.0.0", 8080);
+    cout << "Navigate to http://localhost:" << port << endl;
+    svr.listen(host, port);
 
     return 0;
 }
@@ -0,0 +1,260 @@
+/*
+ * Counters and latency histograms that cost a request nanoseconds, summed up when scraped
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * The metrics of the process. Every thread counts into a slot of its own, on cache lines no other
+ * thread writes, with plain loads and stores rather than atomic increments; a scrape sums the
+ * slots up. Slots are handed on to the next thread when their thread exits, counts and all, so
+ * the sums only ever grow.
+ *
+ * Latencies go into log-linear buckets of two per power of two microseconds, up to 2^24 µs.
+ * Booking attempts are also counted per showing, in a small table per thread where a showing
+ * takes a slot over from another one only by outnumbering it, so the showings booked the most
+ * stay in while the rest come and go; their counts are estimates, that err low.
+ */
+class Metrics
+{
+public:
+    enum Route
+    {
+        GET_MOVIE,
+        GET_THEATER,
+        POST_BOOK,
+        ROUTES
+    };
+
+    // the bucket of i is for latencies up to bound(i) microseconds, the last one for all above
+    static constexpr std::size_t BUCKETS = 49;
+    static constexpr std::size_t HOT_SLOTS = 256;
+
+    /**
+     * The sums over all threads.
+     */
+    struct Sums
+    {
+        std::uint64_t booked = 0;
+        std::uint64_t conflicts = 0;
+        struct Latency
+        {
+            std::uint64_t buckets[BUCKETS] = {};
+            std::uint64_t count = 0;
+            std::uint64_t sum_us = 0;
+        } latencies[ROUTES];
+        // the showings booked the most, the most first, and about how often
+        std::vector<std::pair<ShowingId, std::uint64_t>> hot;
+    };
+
+    /**
+     * @internal
+     * Times the handling of a request to @a route from its construction to its destruction.
+     */
+    class Timer
+    {
+        Route _route;
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+    public:
+        explicit Timer(Route route) : _route(route) {}
+
+        ~Timer()
+        {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+            Metrics::latency(_route, us.count());
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+private:
+    using Count = std::atomic<std::uint64_t>;
+
+    struct Latency
+    {
+        Count buckets[BUCKETS] = {};
+        Count sum_us{0};
+    };
+
+    struct HotSlot
+    {
+        // the showing plus 1, 0 if none
+        Count key{0};
+        Count count{0};
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        Count booked{0};
+        Count conflicts{0};
+        Latency latencies[ROUTES];
+        HotSlot hot[HOT_SLOTS];
+        std::atomic<bool> taken{true};
+        Slot* next = nullptr;
+    };
+
+    struct Local
+    {
+        Slot* slot = claim();
+
+        ~Local()
+        {
+            slot->taken.store(false, std::memory_order_release);
+        }
+    };
+
+    // slots are never freed, only reused
+    inline static std::atomic<Slot*> _slots{nullptr};
+
+    static Slot* claim()
+    {
+        for (Slot* slot = _slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            bool taken = false;
+            if (!slot->taken.load(std::memory_order_relaxed)
+                && slot->taken.compare_exchange_strong(taken, true, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        Slot* slot = new Slot;
+        slot->next = _slots.load(std::memory_order_relaxed);
+        while (!_slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+        return slot;
+    }
+
+    static Slot& local()
+    {
+        thread_local Local local;
+        return *local.slot;
+    }
+
+    // only the slot's thread writes, so there is no need for a locked increment
+    static void add(Count& count, std::uint64_t n)
+    {
+        count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void set(Count& count, std::uint64_t n)
+    {
+        count.store(n, std::memory_order_relaxed);
+    }
+
+    static std::uint64_t get(const Count& count)
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    static unsigned log2(std::uint64_t v)
+    {
+        unsigned bits = 0;
+        while (v >>= 1) {
+            ++bits;
+        }
+        return bits;
+    }
+
+public:
+    /**
+     * The upper bound of bucket @a i, in microseconds: 1, 2, 3, 4, 6, 8, 12, 16 and so on.
+     */
+    static constexpr std::uint64_t bound(std::size_t i)
+    {
+        if (i < 2) {
+            return i + 1;
+        }
+        unsigned m = i / 2;
+        return i % 2 == 0 ? std::uint64_t{3} << (m - 1) : std::uint64_t{1} << (m + 1);
+    }
+
+    static std::size_t bucketOf(std::uint64_t us)
+    {
+        if (us <= 2) {
+            return us == 0 ? 0 : us - 1;
+        }
+        // 2^m < us <= 2^(m+1), which is split at 3 * 2^(m-1)
+        unsigned m = log2(us - 1);
+        std::size_t i = 2 * m + (us > (std::uint64_t{3} << (m - 1)));
+        return std::min(i, BUCKETS - 1);
+    }
+
+    static void latency(Route route, std::uint64_t us)
+    {
+        auto& l = local().latencies[route];
+        add(l.buckets[bucketOf(us)], 1);
+        add(l.sum_us, us);
+    }
+
+    /**
+     * Count a booking attempt of @a showing, which @a booked or did not.
+     */
+    static void booking(ShowingId showing, bool booked)
+    {
+        auto& slot = local();
+        add(booked ? slot.booked : slot.conflicts, 1);
+
+        std::uint64_t key = std::uint64_t{showing} + 1;
+        auto& hot = slot.hot[(key * 0x9e3779b97f4a7c15) >> 56 & (HOT_SLOTS - 1)];
+        if (get(hot.key) == key) {
+            add(hot.count, 1);
+        } else if (get(hot.count) <= 1) {
+            // the showing in the slot ran out of counts, the new one takes over
+            set(hot.key, key);
+            set(hot.count, 1);
+        } else {
+            set(hot.count, get(hot.count) - 1);
+        }
+    }
+
+    /**
+     * Sum the counts of all threads up, with the @a hot showings booked the most.
+     */
+    static Sums sums(std::size_t hot = 10)
+    {
+        Sums sums;
+        std::unordered_map<ShowingId, std::uint64_t> showings;
+        for (Slot* slot = _slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            sums.booked += get(slot->booked);
+            sums.conflicts += get(slot->conflicts);
+            for (std::size_t r = 0; r < ROUTES; ++r) {
+                auto& l = slot->latencies[r];
+                for (std::size_t i = 0; i < BUCKETS; ++i) {
+                    auto n = get(l.buckets[i]);
+                    sums.latencies[r].buckets[i] += n;
+                    sums.latencies[r].count += n;
+                }
+                sums.latencies[r].sum_us += get(l.sum_us);
+            }
+            for (auto& h : slot->hot) {
+                // the key and the count may be of different showings for a moment, which only
+                // makes the estimate a little worse
+                auto key = get(h.key);
+                if (key != 0) {
+                    showings[ShowingId(key - 1)] += get(h.count);
+                }
+            }
+        }
+        sums.hot.assign(showings.begin(), showings.end());
+        auto end = sums.hot.begin() + std::min(hot, sums.hot.size());
+        std::partial_sort(sums.hot.begin(), end, sums.hot.end(), [](auto& a, auto& b) { return a.second > b.second; });
+        sums.hot.erase(end, sums.hot.end());
+        return sums;
+    }
+};
+
+}   // namespace bb
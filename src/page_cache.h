@@ -0,0 +1,140 @@
+/*
+ * A cache of rendered pages, validated by ETag
+ */
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace bb {
+
+/**
+ * @internal
+ * Rendered pages keyed by route and parameters. Each page is stored with the ETag of the
+ * service state it was rendered from, and is only served while the caller's current ETag
+ * still matches, so a bumped version invalidates it without the cache being told.
+ *
+ * The map is split into lock-striped shards, so concurrent lookups of different pages do not
+ * share a lock, and lookups of the same page only take it shared. Each shard keeps up to its
+ * share of a number of bytes of pages, and drops pages it holds to make room for a new one,
+ * whichever come first in its map, so a cache kept by pages that are asked for often refills.
+ */
+class PageCache
+{
+public:
+    using Page = std::shared_ptr<const std::string>;
+
+    static constexpr std::size_t DEFAULT_CAPACITY = 32 * 1024 * 1024;
+
+    /**
+     * Up to about @a capacity bytes of pages, keys included.
+     */
+    explicit PageCache(std::size_t capacity = DEFAULT_CAPACITY) : _shard_capacity(capacity / SHARDS) {}
+
+    /**
+     * the page stored under @a key if it was rendered for @a etag, otherwise nullptr
+     */
+    Page find(const std::string& key, const std::string& etag) const
+    {
+        auto& shard = shardOf(key);
+        std::shared_lock<std::shared_mutex> lock(shard.m);
+        auto it = shard.pages.find(key);
+        if (it == shard.pages.end() || it->second.etag != etag) {
+            return nullptr;
+        }
+        return it->second.page;
+    }
+
+    /**
+     * store @a page under @a key, replacing a page rendered for an older ETag
+     */
+    void store(const std::string& key, const std::string& etag, Page page)
+    {
+        auto bytes = key.size() + etag.size() + page->size();
+        if (bytes > _shard_capacity) {
+            return;
+        }
+        auto& shard = shardOf(key);
+        std::unique_lock<std::shared_mutex> lock(shard.m);
+        auto it = shard.pages.find(key);
+        if (it != shard.pages.end()) {
+            shard.bytes -= it->second.bytes;
+            shard.pages.erase(it);
+        }
+        while (shard.bytes + bytes > _shard_capacity) {
+            shard.bytes -= shard.pages.begin()->second.bytes;
+            shard.pages.erase(shard.pages.begin());
+        }
+        shard.pages.emplace(key, Entry{etag, std::move(page), bytes});
+        shard.bytes += bytes;
+    }
+
+    /**
+     * drop all pages, such as when the showings they list have changed
+     */
+    void clear()
+    {
+        for (auto& shard : _shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.m);
+            shard.pages.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    std::size_t bytes() const
+    {
+        std::size_t bytes = 0;
+        for (auto& shard : _shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.m);
+            bytes += shard.bytes;
+        }
+        return bytes;
+    }
+
+    std::size_t size() const
+    {
+        std::size_t pages = 0;
+        for (auto& shard : _shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.m);
+            pages += shard.pages.size();
+        }
+        return pages;
+    }
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+
+    struct Entry
+    {
+        std::string etag;
+        Page page;
+        std::size_t bytes;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex m;
+        std::unordered_map<std::string, Entry> pages;
+        std::size_t bytes = 0;
+    };
+
+    const std::size_t _shard_capacity;
+    std::array<Shard, SHARDS> _shards;
+
+    Shard& shardOf(const std::string& key)
+    {
+        return _shards[std::hash<std::string>{}(key) % SHARDS];
+    }
+
+    const Shard& shardOf(const std::string& key) const
+    {
+        return _shards[std::hash<std::string>{}(key) % SHARDS];
+    }
+};
+
+}   // namespace bb
@@ -0,0 +1,100 @@
+/*
+ * Splitting work over the cores
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace bb {
+namespace parallel {
+
+/**
+ * @internal
+ * Pin the calling thread, the @a index th of @a count threads, to its share of the cores the
+ * process may run on. Consecutive cores are usually on the same node, so each thread takes a run
+ * of them. If it cannot be pinned, it runs anywhere, which is only slower.
+ */
+inline void pinThread(std::size_t index, std::size_t count)
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::size_t first = cpus.size() * index / count;
+    std::size_t last = std::max(first + 1, cpus.size() * (index + 1) / count);
+    for (std::size_t i = first; i < last; ++i) {
+        CPU_SET(cpus[i % cpus.size()], &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+    (void)count;
+#endif
+}
+
+/**
+ * @internal
+ * The number of parts to split @a n items into for @a threads threads, all cores if 0, so that
+ * every part is worth a thread of its own.
+ */
+inline std::size_t partsFor(std::size_t n, std::size_t threads, std::size_t min_part = 1 << 14)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return std::max<std::size_t>(1, std::min(threads, n / min_part));
+}
+
+/**
+ * @internal
+ * Split [0, @a n) into @a parts contiguous ranges and call @a f(part, begin, end) for each of
+ * them, on a thread of its own but for the first, which runs on the caller's. The ranges are in
+ * order, so what the parts produce can be put together in that order. The first exception of a
+ * part is rethrown once all of them are done.
+ */
+template<typename F>
+void forParts(std::size_t n, std::size_t parts, F&& f)
+{
+    std::vector<std::exception_ptr> errors(parts);
+    auto run = [&](std::size_t part) {
+        try {
+            f(part, n * part / parts, n * (part + 1) / parts);
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t part = 1; part < parts; ++part) {
+        threads.emplace_back(run, part);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+}   // namespace parallel
+}   // namespace bb
@@ -0,0 +1,124 @@
+/*
+ * Read-copy-update, for data that is read all the time and replaced once in a while
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * Epoch-based read-copy-update. A reader marks where it uses shared data with a Reader, which
+ * takes no lock and writes only to a slot of its own thread. A writer publishes a new copy of
+ * the data, calls synchronize() to wait until no reader can still be using the old copy, then
+ * frees it. Readers never wait for writers; writers wait for the readers that were already
+ * reading when the new copy was published, and only for them.
+ *
+ * Every thread that reads gets a slot, which it gives back when it exits for the next thread to
+ * reuse. A slot holds the epoch its thread started reading in, or 0 when the thread is not
+ * reading. synchronize() starts a new epoch and waits for every slot that is still in an earlier
+ * one, so a reader that only shows up in its slot after the scan passed it has loaded the epoch
+ * before it was bumped, but will load the data after the new copy was published. The data may
+ * be loaded with acquire only: a fence after the slot is written keeps those loads from moving
+ * ahead of it, where the writer's scan could miss a reader already holding the old copy.
+ *
+ * There is one domain for the whole process, and readers may nest.
+ */
+class Rcu
+{
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        std::atomic<std::uint64_t> epoch{0};
+        std::atomic<bool> taken{true};
+        Slot* next = nullptr;
+    };
+
+    struct Local
+    {
+        Slot* slot = claim();
+        std::size_t depth = 0;
+
+        ~Local()
+        {
+            slot->taken.store(false, std::memory_order_release);
+        }
+    };
+
+    inline static std::atomic<std::uint64_t> _epoch{1};
+    // slots are never freed, only reused
+    inline static std::atomic<Slot*> _slots{nullptr};
+
+    static Slot* claim()
+    {
+        for (Slot* slot = _slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            bool taken = false;
+            if (!slot->taken.load(std::memory_order_relaxed)
+                && slot->taken.compare_exchange_strong(taken, true, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        Slot* slot = new Slot;
+        slot->next = _slots.load(std::memory_order_relaxed);
+        while (!_slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+        return slot;
+    }
+
+    static Local& local()
+    {
+        thread_local Local local;
+        return local;
+    }
+
+public:
+    /**
+     * @internal
+     * While it lives, whatever its thread has loaded from the shared data stays valid.
+     */
+    class Reader
+    {
+        Local& _local = local();
+
+    public:
+        Reader()
+        {
+            if (_local.depth++ == 0) {
+                _local.slot->epoch.store(_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~Reader()
+        {
+            if (--_local.depth == 0) {
+                _local.slot->epoch.store(0, std::memory_order_release);
+            }
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+    };
+
+    /**
+     * Wait until every reader that may have loaded the data published before this call is done.
+     * Never call it inside a Reader of the same thread, which would wait for itself.
+     */
+    static void synchronize()
+    {
+        std::uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        for (Slot* slot = _slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            for (std::uint64_t e; (e = slot->epoch.load(std::memory_order_seq_cst)) != 0 && e < epoch; ) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+}   // namespace bb
@@ -0,0 +1,220 @@
+#include "search.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "parallel.h"
+
+using namespace std;
+using namespace bb;
+
+static unsigned char fold(char c)
+{
+    unsigned char u = c;
+    return u >= 'A' && u <= 'Z' ? u - 'A' + 'a' : u;
+}
+
+// letters and digits, and every byte of UTF-8 sequences, which are left as they are
+static bool isWordByte(char c)
+{
+    unsigned char u = c;
+    return (u >= '0' && u <= '9') || (u >= 'A' && u <= 'Z') || (u >= 'a' && u <= 'z') || u >= 0x80;
+}
+
+static bool isWordStart(string_view name, size_t i)
+{
+    return i == 0 || (isWordByte(name[i]) && !isWordByte(name[i - 1]));
+}
+
+static int compareFolded(string_view a, string_view b)
+{
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (fold(a[i]) != fold(b[i])) {
+            return fold(a[i]) < fold(b[i]) ? -1 : 1;
+        }
+    }
+    return a.size() == b.size() ? 0 : a.size() < b.size() ? -1 : 1;
+}
+
+static bool startsWithFolded(string_view s, string_view prefix)
+{
+    return s.size() >= prefix.size() && compareFolded(s.substr(0, prefix.size()), prefix) == 0;
+}
+
+size_t NameIndex::wordsIn(string_view name)
+{
+    // the name itself, even if it does not start with a word
+    size_t words = 1;
+    for (size_t i = 1; i < name.size(); ++i) {
+        words += isWordStart(name, i);
+    }
+    return words;
+}
+
+void NameIndex::build(const char* pool, const uint64_t* offsets, size_t names, Entry* entries, size_t threads)
+{
+    auto name = [&](size_t id) {
+        return string_view(pool + offsets[id], offsets[id + 1] - offsets[id]);
+    };
+
+    // every part of the names writes its entries after those of the parts before it
+    size_t parts = parallel::partsFor(names, threads);
+    vector<size_t> part_entries(parts + 1);
+    parallel::forParts(names, parts, [&](size_t part, size_t begin, size_t end) {
+        for (size_t id = begin; id < end; ++id) {
+            part_entries[part + 1] += wordsIn(name(id));
+        }
+    });
+    for (size_t part = 0; part < parts; ++part) {
+        part_entries[part + 1] += part_entries[part];
+    }
+    parallel::forParts(names, parts, [&](size_t part, size_t begin, size_t end) {
+        auto out = entries + part_entries[part];
+        for (size_t id = begin; id < end; ++id) {
+            auto s = name(id);
+            *out++ = Entry(id) << 32;
+            for (size_t i = 1; i < s.size(); ++i) {
+                if (isWordStart(s, i)) {
+                    *out++ = Entry(id) << 32 | i;
+                }
+            }
+        }
+    });
+
+    // sorted a part on each thread, then merged
+    const size_t count = part_entries[parts];
+    auto before = [&](Entry a, Entry b) {
+        auto order = compareFolded(name(a >> 32).substr(uint32_t(a)), name(b >> 32).substr(uint32_t(b)));
+        return order != 0 ? order < 0 : a < b;
+    };
+    parts = parallel::partsFor(count, threads);
+    vector<pair<size_t, size_t>> sorted(parts);
+    parallel::forParts(count, parts, [&](size_t part, size_t begin, size_t end) {
+        sort(entries + begin, entries + end, before);
+        sorted[part] = {begin, end};
+    });
+    for (size_t part = 1; part < parts; ++part) {
+        inplace_merge(entries, entries + sorted[part].first, entries + sorted[part].second, before);
+    }
+}
+
+string_view NameIndex::suffix(Entry entry) const
+{
+    auto id = entry >> 32;
+    return string_view(_pool + _offsets[id], _offsets[id + 1] - _offsets[id]).substr(uint32_t(entry));
+}
+
+size_t NameIndex::endOfPrefix(size_t first, string_view prefix) const
+{
+    auto starts = [&](Entry entry) {
+        return startsWithFolded(suffix(entry), prefix);
+    };
+    // most prefixes are shared by a few entries, so the end is looked for close by first
+    size_t last = first;
+    for (size_t step = 1; last < _count && starts(_entries[last]); step *= 2) {
+        first = last + 1;
+        last = min(_count, first + step);
+    }
+    return partition_point(_entries + first, _entries + last, starts) - _entries;
+}
+
+vector<uint32_t> NameIndex::search(string_view query, size_t limit, size_t max_edits) const
+{
+    vector<uint32_t> ids;
+    string folded(query.size(), '\0');
+    transform(query.begin(), query.end(), folded.begin(), fold);
+
+    auto first = lower_bound(_entries, _entries + _count, folded, [&](Entry entry, const string& q) {
+        return compareFolded(suffix(entry), q) < 0;
+    }) - _entries;
+    auto last = endOfPrefix(first, folded);
+    for (size_t i = first; i < last && ids.size() < limit; ++i) {
+        uint32_t id = _entries[i] >> 32;
+        if (find(ids.begin(), ids.end(), id) == ids.end()) {
+            ids.push_back(id);
+        }
+    }
+    for (size_t edits = 1; edits <= max_edits && ids.size() < limit; ++edits) {
+        fuzzy(folded, edits, limit, ids);
+    }
+    return ids;
+}
+
+/*
+ * The edit distances of the query to the prefixes of an entry are rows of the Levenshtein table,
+ * one per character of the entry, with two letters the wrong way round counted as one edit, and
+ * the rows of a prefix are the same for every entry that shares it. So the entries are walked in
+ * order, as a trie would be, reusing the rows of the prefix an entry shares with the one before it. Once a prefix is @a edits away from the query,
+ * all entries that share it match; once no row can get back within @a edits, none of them do.
+ * Either way, they are skipped with a binary search rather than walked.
+ */
+void NameIndex::fuzzy(string_view query, size_t edits, size_t limit, vector<uint32_t>& ids) const
+{
+    const size_t m = query.size();
+    // the rows are added as the walk goes deeper, which it rarely does much past the best match
+    vector<size_t> rows(m + 1);
+    auto row = [&](size_t depth) { return rows.data() + depth * (m + 1); };
+    for (size_t j = 0; j <= m; ++j) {
+        row(0)[j] = j;
+    }
+
+    string_view previous;
+    // the rows are those of previous up to this depth
+    size_t valid = 0;
+    for (size_t i = 0; i < _count && ids.size() < limit; ) {
+        auto s = suffix(_entries[i]);
+        size_t depth = 0;
+        size_t common = min({valid, s.size(), previous.size()});
+        while (depth < common && fold(s[depth]) == fold(previous[depth])) {
+            ++depth;
+        }
+        bool matched = false;
+        bool pruned = false;
+        for (;;) {
+            auto r = row(depth);
+            if (r[m] <= edits) {
+                matched = true;
+                break;
+            }
+            if (*min_element(r, r + m + 1) > edits) {
+                pruned = true;
+                break;
+            }
+            if (depth == s.size()) {
+                break;
+            }
+            if (rows.size() < (depth + 2) * (m + 1)) {
+                rows.resize((depth + 2) * (m + 1));
+                r = row(depth);
+            }
+            auto next = row(depth + 1);
+            auto c = fold(s[depth]);
+            next[0] = depth + 1;
+            for (size_t j = 1; j <= m; ++j) {
+                unsigned char q = query[j - 1];
+                next[j] = min({r[j] + 1, next[j - 1] + 1, r[j - 1] + (q != c)});
+                // two letters the wrong way round are one typo
+                if (depth > 0 && j > 1 && q == fold(s[depth - 1]) && static_cast<unsigned char>(query[j - 2]) == c) {
+                    next[j] = min(next[j], row(depth - 1)[j - 2] + 1);
+                }
+            }
+            ++depth;
+        }
+        previous = s;
+        valid = depth;
+        if (!matched && !pruned) {
+            ++i;
+            continue;
+        }
+        auto end = endOfPrefix(i + 1, s.substr(0, depth));
+        for (; matched && i < end && ids.size() < limit; ++i) {
+            uint32_t id = _entries[i] >> 32;
+            if (find(ids.begin(), ids.end(), id) == ids.end()) {
+                ids.push_back(id);
+            }
+        }
+        i = end;
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Typeahead search of movie and theater names
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bb {
+
+/**
+ * @internal
+ * An index of the words of a list of names, for finding the names as they are typed. Every word
+ * of every name is an entry, the name's id and the offset of the word in it, and the entries are
+ * sorted by the rest of the name from the word on, ignoring ASCII case. So the names with a word
+ * that starts with a query are a range of entries, found by a binary search, and entries that
+ * share a prefix are next to each other, which lets a fuzzy search walk them like a trie.
+ *
+ * The entries are plain integers, kept in the snapshot with the names they refer to by offset.
+ */
+class NameIndex
+{
+public:
+    /**
+     * An entry: the id of a name in its upper half, the offset of a word in its lower half.
+     */
+    using Entry = std::uint64_t;
+
+    /**
+     * The index of the names in @a pool at @a offsets, name i being [offsets[i], offsets[i + 1]),
+     * with the @a count entries that build() sorted.
+     */
+    NameIndex(const char* pool, const std::uint64_t* offsets, const Entry* entries, std::size_t count)
+        : _pool(pool), _offsets(offsets), _entries(entries), _count(count) {}
+
+    /**
+     * The number of words in @a name, that is, of entries it takes.
+     */
+    static std::size_t wordsIn(std::string_view name);
+
+    /**
+     * Write the entries of the @a names names in @a pool at @a offsets to @a entries, which has
+     * room for all of them, and sort them, on @a threads threads, all cores if 0.
+     */
+    static void build(const char* pool, const std::uint64_t* offsets, std::size_t names, Entry* entries,
+                      std::size_t threads = 0);
+
+    /**
+     * The ids of up to @a limit names with a word that starts with @a query, or is up to
+     * @a max_edits insertions, deletions, substitutions or swaps of two letters next to each
+     * other away from a word that does, ignoring ASCII case. The names that match as typed come first, then those one edit away, and so
+     * on; within each, they are in the order of the words that match.
+     */
+    std::vector<std::uint32_t> search(std::string_view query, std::size_t limit, std::size_t max_edits) const;
+
+    /**
+     * The pool and the offsets of the names, which the ids search() finds refer to.
+     */
+    std::pair<const char*, const std::uint64_t*> names() const
+    {
+        return {_pool, _offsets};
+    }
+
+private:
+    const char* _pool;
+    const std::uint64_t* _offsets;
+    const Entry* _entries;
+    std::size_t _count;
+
+    std::string_view suffix(Entry entry) const;
+    /**
+     * The first entry from @a first that does not start with @a prefix, which the entries from
+     * @a first to it do.
+     */
+    std::size_t endOfPrefix(std::size_t first, std::string_view prefix) const;
+    void fuzzy(std::string_view query, std::size_t edits, std::size_t limit, std::vector<std::uint32_t>& ids) const;
+};
+
+}   // namespace bb
@@ -0,0 +1,200 @@
+#include "service.h"
+
+#include <charconv>
+#include <stdexcept>
+
+#include "bitops.h"
+
+using namespace std;
+using namespace bb;
+
+static size_t wordsFor(size_t seats)
+{
+    // whole cache lines, so the kernels never see a partial vector
+    constexpr size_t LINE_BITS = SeatSet::WORD_BITS * SeatSet::WORDS_PER_LINE;
+    return (seats + LINE_BITS - 1) / LINE_BITS * SeatSet::WORDS_PER_LINE;
+}
+
+/**
+ * @internal
+ * the first seat at or after `from` whose bit is set in `words ^ invert`, or `seats` if none
+ */
+static size_t findNextBit(const SeatSet::Word* words, size_t seats, size_t from, SeatSet::Word invert)
+{
+    using Word = SeatSet::Word;
+    if (from >= seats) {
+        return seats;
+    }
+    size_t i = from / SeatSet::WORD_BITS;
+    size_t used = (seats + SeatSet::WORD_BITS - 1) / SeatSet::WORD_BITS;
+    Word w = (words[i] ^ invert) & (~Word{0} << (from % SeatSet::WORD_BITS));
+    while (w == 0) {
+        if (++i == used) {
+            return seats;
+        }
+        w = words[i] ^ invert;
+    }
+    return min(i * SeatSet::WORD_BITS + bitops::countTrailingZeros(w), seats);
+}
+
+static void checkSameSize(const SeatSet& a, const SeatSet& b)
+{
+    if (a.size() != b.size()) {
+        throw invalid_argument("SeatSet: seat count mismatch");
+    }
+}
+
+SeatSet::SeatSet(size_t seats) : _size(seats), _words(wordsFor(seats), 0)
+{
+}
+
+SeatSet SeatSet::fromMask(SeatMask mask, size_t seats)
+{
+    if (seats < WORD_BITS && (mask >> seats) != 0) {
+        throw invalid_argument("fromMask: seat out of range");
+    }
+    SeatSet set(seats);
+    if (!set._words.empty()) {
+        set._words[0] = mask;
+    } else if (mask != 0) {
+        throw invalid_argument("fromMask: seat out of range");
+    }
+    return set;
+}
+
+SeatSet SeatSet::fromRanges(string_view ranges, size_t seats)
+{
+    SeatSet set(seats);
+    const char* p = ranges.data();
+    const char* end = p + ranges.size();
+
+    auto parseSeat = [&]() {
+        size_t seat = 0;
+        auto [next, ec] = from_chars(p, end, seat);
+        if (ec != errc() || seat == 0 || seat > seats) {
+            throw invalid_argument("fromRanges: invalid seat number");
+        }
+        p = next;
+        return seat;
+    };
+
+    while (p != end) {
+        size_t first = parseSeat();
+        size_t last = first;
+        if (p != end && *p == '-') {
+            ++p;
+            last = parseSeat();
+            if (last < first) {
+                throw invalid_argument("fromRanges: invalid seat range");
+            }
+        }
+        set.set(first - 1, last);
+        if (p != end) {
+            if (*p != ',' || ++p == end) {
+                throw invalid_argument("fromRanges: invalid separator");
+            }
+        }
+    }
+    return set;
+}
+
+string SeatSet::toRanges() const
+{
+    string out;
+    for (size_t first = findNext(0); first < _size; ) {
+        // the run ends at the first seat that is not in the set
+        size_t last = findNextBit(_words.data(), _size, first, ~Word{0});
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += to_string(first + 1);
+        if (last - first > 1) {
+            out += '-';
+            out += to_string(last);
+        }
+        first = findNext(last);
+    }
+    return out;
+}
+
+void SeatSet::set(size_t first, size_t last)
+{
+    if (first >= last) {
+        return;
+    }
+    size_t first_word = first / WORD_BITS;
+    size_t last_word = (last - 1) / WORD_BITS;
+    Word head = ~Word{0} << (first % WORD_BITS);
+    Word tail = ~Word{0} >> (WORD_BITS - 1 - (last - 1) % WORD_BITS);
+    if (first_word == last_word) {
+        _words[first_word] |= head & tail;
+        return;
+    }
+    _words[first_word] |= head;
+    for (size_t i = first_word + 1; i < last_word; ++i) {
+        _words[i] = ~Word{0};
+    }
+    _words[last_word] |= tail;
+}
+
+SeatSet& SeatSet::flip()
+{
+    for (auto& w : _words) {
+        w = ~w;
+    }
+    // keep the bits beyond the last seat clear
+    size_t used = (_size + WORD_BITS - 1) / WORD_BITS;
+    for (size_t i = used; i < _words.size(); ++i) {
+        _words[i] = 0;
+    }
+    if (_size % WORD_BITS) {
+        _words[used - 1] &= (Word{1} << (_size % WORD_BITS)) - 1;
+    }
+    return *this;
+}
+
+size_t SeatSet::count() const
+{
+    return bitops::popcount(_words.data(), _words.size());
+}
+
+bool SeatSet::any() const
+{
+    return bitops::any(_words.data(), _words.size());
+}
+
+bool SeatSet::intersects(const SeatSet& other) const
+{
+    checkSameSize(*this, other);
+    return bitops::intersects(_words.data(), other._words.data(), _words.size());
+}
+
+size_t SeatSet::findNext(size_t from) const
+{
+    return findNextBit(_words.data(), _size, from, 0);
+}
+
+SeatSet& SeatSet::operator|=(const SeatSet& other)
+{
+    checkSameSize(*this, other);
+    for (size_t i = 0; i < _words.size(); ++i) {
+        _words[i] |= other._words[i];
+    }
+    return *this;
+}
+
+SeatSet& SeatSet::operator&=(const SeatSet& other)
+{
+    checkSameSize(*this, other);
+    for (size_t i = 0; i < _words.size(); ++i) {
+        _words[i] &= other._words[i];
+    }
+    return *this;
+}
+
+SeatSet& SeatSet::subtract(const SeatSet& other)
+{
+    checkSameSize(*this, other);
+    bitops::andNot(_words.data(), _words.data(), other._words.data(), _words.size());
+    return *this;
+}
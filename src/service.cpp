@@ -1,22 +1,40 @@
 #include "service.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <vector>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bitops.h"
+#include "catalog_file.h"
+#include "parallel.h"
+#include "rcu.h"
+#include "metrics.h"
+#include "search.h"
+#include "shards.h"
+#include "snapshot.h"
+#include "timer_wheel.h"
+#include "wal.h"
 
 using namespace std;
 using namespace bb;
 
-struct BookingRecord
-{
-    string movie_name;
-    string theater_name;
-    SeatMask booked_mask;
-};
-
 static BookingRecord booking_table[] = {
     {"Kingdom of the Planet of the Apes", "Landmark Cinemas", ALL_SEATS},
     {"Kingdom of the Planet of the Apes", "Galaxy Cinemas", 0},
@@ -27,148 +45,2582 @@ static BookingRecord booking_table[] = {
     {"Garfield Movie, The", "Cinema Paradiso", 0xc01a},
     {"Back to Black", "Galaxy Cinemas", 0},
     {"Back to Black", "Cinema Paradiso", 0},
+    {"Kingdom of the Planet of the Apes", "Scotiabank IMAX", 0x3ff, 480, 24},
 };
 
-class ServiceImpl : public Service
+/**
+ * @internal
+ * Wakes up the threads waiting for a record to change. Waiters are spread over lock-striped
+ * shards by the address of what they wait on, and a change only takes the lock of its shard,
+ * for a moment, when someone in that shard is waiting. It never waits for the waiters to run:
+ * they read the new state themselves after waking up.
+ *
+ * It also remembers whether anything has changed at all, for the checkpoints.
+ */
+class ChangeNotifier
 {
-    class GuardedRecord
+    static constexpr size_t SHARDS = 16;
+
+    struct alignas(CACHE_LINE_SIZE) Shard
     {
-        BookingRecord& _record;
-        mutex _m;
+        mutex m;
+        condition_variable changed;
+        atomic<size_t> waiters{0};
+    };
+
+    array<Shard, SHARDS> _shards;
+    // whether anything has changed since takeChanged(), on a line of its own
+    alignas(CACHE_LINE_SIZE) atomic<bool> _changed{false};
+
+    Shard& shardOf(const void* key)
+    {
+        return _shards[reinterpret_cast<uintptr_t>(key) / CACHE_LINE_SIZE % SHARDS];
+    }
 
-        mutex& getMutex()
+public:
+    /**
+     * Wake up the waiters on @a key. Call it after the change is visible.
+     */
+    void notify(const void* key)
+    {
+        // only written once between checkpoints, so bookings do not fight over the line
+        if (!_changed.load(memory_order_relaxed)) {
+            _changed.store(true, memory_order_relaxed);
+        }
+        auto& shard = shardOf(key);
+        // pairs with the fence in wait(): either the waiter sees the change or this sees the waiter
+        atomic_thread_fence(memory_order_seq_cst);
+        if (shard.waiters.load(memory_order_relaxed) == 0) {
+            return;
+        }
         {
-            // NOTE: use a static mutex if per-record mutex is deemed too expensive
-            return _m;
+            // a waiter holds the lock from checking for the change until it sleeps, so it cannot miss it
+            const lock_guard<mutex> lock(shard.m);
         }
+        shard.changed.notify_all();
+    }
 
-    public:
-        explicit GuardedRecord(BookingRecord& record) : _record(record) {}
+    /**
+     * Whether anything has changed since the last call, and start over.
+     */
+    bool takeChanged()
+    {
+        return _changed.exchange(false, memory_order_acq_rel);
+    }
+
+    void markChanged()
+    {
+        _changed.store(true, memory_order_relaxed);
+    }
 
-        SeatMask availableSeats() const
+    /**
+     * Wait on @a key until @a changed returns true or @a timeout passes.
+     */
+    template<typename Predicate>
+    bool wait(const void* key, chrono::milliseconds timeout, Predicate changed)
+    {
+        auto& shard = shardOf(key);
+        shard.waiters.fetch_add(1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        bool result;
         {
-            return (~_record.booked_mask) & ALL_SEATS;
+            unique_lock<mutex> lock(shard.m);
+            result = shard.changed.wait_for(lock, timeout, changed);
         }
+        shard.waiters.fetch_sub(1, memory_order_relaxed);
+        return result;
+    }
+};
 
-        bool book(SeatMask seat_mask)
-        {
-            if (seat_mask == 0 || (seat_mask & ALL_SEATS) != seat_mask) {
-                throw invalid_argument("book: invalid seat_mask");
+/**
+ * @internal
+ * Spin locks, striped by the cache line a record starts on, that the bookings spanning more than
+ * one word take, so that of those claiming seats of the same record one at a time goes, and one
+ * always wins. A booking of a single word claims it with one compare-and-swap and takes no lock.
+ * A batch takes the stripes of all its records, in the order of the stripes, so that batches and
+ * bookings that share records never wait for each other in a circle.
+ *
+ * The locks live apart from the seats, which a snapshot saves as they are.
+ */
+class BookingLocks
+{
+public:
+    static constexpr size_t STRIPES = 1024;
+
+    static size_t stripeOf(const void* record)
+    {
+        return reinterpret_cast<uintptr_t>(record) / CACHE_LINE_SIZE % STRIPES;
+    }
+
+    static void lock(size_t stripe)
+    {
+        auto& locked = _stripes[stripe].locked;
+        // the locks are held for a few compare-and-swaps, or a few of those per record of a batch
+        for (size_t spins = 0; locked.exchange(true, memory_order_acquire); ++spins) {
+            while (locked.load(memory_order_relaxed)) {
+                if (++spins >= 64) {
+                    this_thread::yield();
+                }
             }
+        }
+    }
+
+    static void unlock(size_t stripe)
+    {
+        _stripes[stripe].locked.store(false, memory_order_release);
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Stripe
+    {
+        atomic<bool> locked{false};
+    };
+
+    static array<Stripe, STRIPES> _stripes;
+};
+
+array<BookingLocks::Stripe, BookingLocks::STRIPES> BookingLocks::_stripes;
+
+/**
+ * @internal
+ * The seat state of a showing. The booked seats are kept in atomic 64-bit words, so reads are
+ * wait-free and bookings are claimed word by word with compare-and-swap retry loops instead of
+ * a lock. The words are not owned by the record, so the records of many showings can share one
+ * cache-line aligned arena. Every change to the seats also bumps a version, which is kept in the
+ * word in front of the seats, on the cache line the booking writes anyway, and wakes up whoever
+ * waits for the record to change.
+ */
+class GuardedRecord
+{
+public:
+    using Word = SeatSet::Word;
+    using Words = vector<atomic<Word>, CacheAlignedAllocator<atomic<Word>>>;
+
+private:
+    atomic<Word>* _version;
+    atomic<Word>* _booked;
+    size_t _words;
+    size_t _seats;
+    size_t _seats_per_row;
+    ChangeNotifier* _changes;
+
+    void changed()
+    {
+        _version->fetch_add(1, memory_order_release);
+        if (_changes) {
+            _changes->notify(_version);
+        }
+    }
 
-            const lock_guard<mutex> lock(getMutex());
+    // the lock of the record, for as long as a booking of many words claims seats
+    class Locked
+    {
+        size_t _stripe;
+
+    public:
+        explicit Locked(const GuardedRecord& rec) : _stripe(BookingLocks::stripeOf(rec._version))
+        {
+            BookingLocks::lock(_stripe);
+        }
+
+        ~Locked()
+        {
+            BookingLocks::unlock(_stripe);
+        }
+    };
 
-            if (_record.booked_mask & seat_mask) {
+    /**
+     * Claim @a want in word @a i, unless any of its seats is taken already.
+     */
+    bool claim(size_t i, Word want)
+    {
+        Word booked = _booked[i].load(memory_order_relaxed);
+        do {
+            if (booked & want) {
                 // not all seats are available
                 return false;
             }
+            // on failure `booked` is reloaded with the latest word and the check is redone
+        } while (!_booked[i].compare_exchange_weak(booked, booked | want,
+                    memory_order_acq_rel, memory_order_relaxed));
+        return true;
+    }
+
+    /**
+     * Claim the seats of @a want word by word, or give back the words claimed on the first
+     * conflict and claim none.
+     */
+    bool claimAll(const Word* want)
+    {
+        for (size_t i = 0; i < _words; ++i) {
+            if (want[i] && !claim(i, want[i])) {
+                for (size_t j = 0; j < i; ++j) {
+                    _booked[j].fetch_and(~want[j], memory_order_release);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
 
-            _record.booked_mask |= seat_mask;
+    Word seatsInWord(size_t i) const
+    {
+        size_t rest = _seats - i * SeatSet::WORD_BITS;
+        return rest >= SeatSet::WORD_BITS ? ~Word{0} : (Word{1} << rest) - 1;
+    }
 
-            return true;
+    /**
+     * The booked bits of the @a width seats starting at @a first, which span at most two words.
+     */
+    Word bookedBits(size_t first, size_t width) const
+    {
+        size_t i = first / SeatSet::WORD_BITS;
+        size_t offset = first % SeatSet::WORD_BITS;
+        Word bits = _booked[i].load(memory_order_acquire) >> offset;
+        if (offset + width > SeatSet::WORD_BITS) {
+            bits |= _booked[i + 1].load(memory_order_acquire) << (SeatSet::WORD_BITS - offset);
         }
-    };
+        return width == SeatSet::WORD_BITS ? bits : bits & ((Word{1} << width) - 1);
+    }
+
+    /**
+     * Bit i of the result is set iff bits i to i + @a count - 1 of @a free are all set. The runs
+     * are folded by doubling shifts, so this takes log2(count) steps rather than count.
+     */
+    static Word runStarts(Word free, size_t count)
+    {
+        for (size_t covered = 1; covered < count; ) {
+            size_t step = min(covered, count - covered);
+            free &= free >> step;
+            covered += step;
+        }
+        return free;
+    }
+
+    /**
+     * The set bit of @a starts closest to @a target, @a starts must not be zero.
+     */
+    static size_t closestBit(Word starts, size_t target)
+    {
+        Word above = starts >> target;
+        Word below = starts & ((Word{1} << target) - 1);
+        if (!below) {
+            return target + bitops::countTrailingZeros(above);
+        }
+        size_t low = bitops::highestBit(below);
+        if (!above) {
+            return low;
+        }
+        size_t high = target + bitops::countTrailingZeros(above);
+        return high - target <= target - low ? high : low;
+    }
 
-    using TheaterMap = unordered_map<string, GuardedRecord*>;
-    using MovieMap = unordered_map<string, TheaterMap>;
-    MovieMap _movie_map;
+    /**
+     * The row to try at position @a i of the search order for @a preference.
+     */
+    static size_t rowAt(size_t i, size_t rows, SeatPreference preference)
+    {
+        switch (preference) {
+        case SeatPreference::FRONT:
+            return i;
+        case SeatPreference::BACK:
+            return rows - 1 - i;
+        default:
+            // middle row first, then alternate behind and in front of it
+            size_t middle = (rows - 1) / 2;
+            return i % 2 ? middle + (i + 1) / 2 : middle - i / 2;
+        }
+    }
 
 public:
-    template<typename Iter>
-    ServiceImpl(Iter first, Iter last)
+    /**
+     * The number of words to set aside for a showing of @a seats seats, so that the next
+     * showing in the same arena starts on a new cache line.
+     */
+    static size_t wordsFor(size_t seats)
+    {
+        size_t words = 1 + (seats + SeatSet::WORD_BITS - 1) / SeatSet::WORD_BITS;
+        return (words + SeatSet::WORDS_PER_LINE - 1) / SeatSet::WORDS_PER_LINE * SeatSet::WORDS_PER_LINE;
+    }
+
+    /**
+     * Set up the version and the seats of @a record in @a storage, which must have room for
+     * wordsFor() words. Changes are announced to @a changes, if any.
+     */
+    GuardedRecord(const BookingRecord& record, atomic<Word>* storage, ChangeNotifier* changes = nullptr)
+        : _version(storage), _booked(storage + 1),
+          _words((record.seats + SeatSet::WORD_BITS - 1) / SeatSet::WORD_BITS),
+          _seats(record.seats), _seats_per_row(record.seats_per_row), _changes(changes)
+    {
+        if (_words == 0) {
+            throw invalid_argument("GuardedRecord: a showing has no seats");
+        }
+        if (_seats_per_row == 0 || _seats_per_row > MAX_SEATS_PER_ROW) {
+            throw invalid_argument("GuardedRecord: invalid seats_per_row");
+        }
+        _version->store(0, memory_order_relaxed);
+        _booked[0].store(record.booked_mask & seatsInWord(0), memory_order_relaxed);
+        for (size_t i = 1; i < _words; ++i) {
+            _booked[i].store(0, memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Attach to the version and the seats set up earlier in @a storage.
+     */
+    GuardedRecord(atomic<Word>* storage, size_t seats, size_t seats_per_row, ChangeNotifier* changes)
+        : _version(storage), _booked(storage + 1),
+          _words((seats + SeatSet::WORD_BITS - 1) / SeatSet::WORD_BITS),
+          _seats(seats), _seats_per_row(seats_per_row), _changes(changes)
+    {
+    }
+
+    /**
+     * The number of changes to the seats so far. Read it before the seats: whatever is read
+     * afterwards is at least as new as the version.
+     */
+    uint64_t version() const
+    {
+        return _version->load(memory_order_acquire);
+    }
+
+    /**
+     * What to wait on in the ChangeNotifier for the version to change.
+     */
+    const void* changeKey() const
+    {
+        return _version;
+    }
+
+    size_t seats() const
+    {
+        return _seats;
+    }
+
+    size_t seatsPerRow() const
+    {
+        return _seats_per_row;
+    }
+
+    /**
+     * A snapshot of the booked seats. Each word is read atomically, a booking that spans words
+     * may be seen partially.
+     */
+    SeatSet bookedSeats() const
     {
-        // build index from booking records
-        for (auto it = first; it != last; ++it) {
-            _movie_map[it->movie_name][it->theater_name] = new GuardedRecord(*it);
+        SeatSet booked(_seats);
+        for (size_t i = 0; i < _words; ++i) {
+            booked.data()[i] = _booked[i].load(memory_order_acquire);
         }
+        return booked;
     }
-    ~ServiceImpl()
+
+    SeatMask availableSeats() const
+    {
+        return (~_booked[0].load(memory_order_acquire)) & seatsInWord(0);
+    }
+
+    SeatSet availableSeatSet() const
+    {
+        return bookedSeats().flip();
+    }
+
+    size_t availableSeatCount() const
+    {
+        return _seats - bookedSeats().count();
+    }
+
+    bool book(SeatMask seat_mask)
+    {
+        if (seat_mask == 0 || (seat_mask & seatsInWord(0)) != seat_mask) {
+            throw invalid_argument("book: invalid seat_mask");
+        }
+        if (!claim(0, seat_mask)) {
+            return false;
+        }
+        changed();
+        return true;
+    }
+
+    /**
+     * Claim all the seats or none. Words are claimed in ascending order and the ones claimed so
+     * far are given back on the first conflict, so a failed booking never leaves seats behind,
+     * though a concurrent reader may briefly see them as taken. Seats in one word are claimed at
+     * once; bookings spanning more words take the lock of the record, so that two of them never
+     * both fail on each other's seats, given back right after.
+     */
+    bool book(const SeatSet& seats)
     {
-        for (auto& [movie, theaters] : _movie_map) {
-            for (auto& [theater, rec] : theaters) {
-                delete rec;
+        if (seats.size() != _seats || seats.none()) {
+            throw invalid_argument("book: invalid seats");
+        }
+        const Word* want = seats.data();
+        size_t first = 0;
+        while (!want[first]) {
+            ++first;
+        }
+        size_t last = _words - 1;
+        while (!want[last]) {
+            --last;
+        }
+        if (first == last) {
+            if (!claim(first, want[first])) {
+                return false;
             }
+            changed();
+            return true;
+        }
+        const Locked locked(*this);
+        if (!claimAll(want)) {
+            return false;
         }
+        changed();
+        return true;
     }
 
-    virtual NameList movies() const
+    /**
+     * Claim the seats of every one of @a claims, which must be valid for their records, or of
+     * none. The records are locked from the other batches and the bookings of many words while
+     * the seats are checked and claimed, so a batch only fails on seats another booking has won.
+     * Bookings of a single word take no lock: should one win a seat between the check and the
+     * claim, what the batch claimed is given back, and a booking or a reader may briefly see it
+     * as taken.
+     */
+    static bool bookAll(const vector<pair<GuardedRecord, const SeatSet*>>& claims)
     {
-        NameList names;
-        transform(_movie_map.begin(), _movie_map.end(), back_inserter(names),
-            [](const auto& elem){ return elem.first; });
-        return names;
+        vector<size_t> stripes;
+        stripes.reserve(claims.size());
+        for (auto& [rec, seats] : claims) {
+            stripes.push_back(BookingLocks::stripeOf(rec._version));
+        }
+        sort(stripes.begin(), stripes.end());
+        stripes.erase(unique(stripes.begin(), stripes.end()), stripes.end());
+        for (auto stripe : stripes) {
+            BookingLocks::lock(stripe);
+        }
+        // a batch that can see it fails claims nothing
+        size_t claimed = 0;
+        bool available = all_of(claims.begin(), claims.end(), [](auto& claim) {
+            auto& [rec, seats] = claim;
+            for (size_t i = 0; i < rec._words; ++i) {
+                if (rec._booked[i].load(memory_order_acquire) & seats->data()[i]) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        for (auto [rec, seats] : claims) {
+            if (!available || !rec.claimAll(seats->data())) {
+                available = false;
+                break;
+            }
+            ++claimed;
+        }
+        for (size_t i = 0; i < claimed; ++i) {
+            auto [rec, seats] = claims[i];
+            if (available) {
+                rec.changed();
+                continue;
+            }
+            for (size_t j = 0; j < rec._words; ++j) {
+                rec._booked[j].fetch_and(~seats->data()[j], memory_order_release);
+            }
+        }
+        for (auto stripe : stripes) {
+            BookingLocks::unlock(stripe);
+        }
+        return available;
     }
 
-    virtual NameList movies(const std::string& theater) const
+    /**
+     * Find @a count adjacent available seats in a row, closest to the middle of the row, in the
+     * rows ordered by @a preference, and claim them. The search reads the booked words directly
+     * and works on whole rows with bit tricks; if another booking wins the claim, search again.
+     */
+    SeatSet bookBest(size_t count, SeatPreference preference)
     {
-        NameList names;
-        for (auto& [movie, theaters] : _movie_map) {
-            if (theaters.find(theater) != theaters.end()) {
-                names.push_back(movie);
+        if (count == 0 || count > _seats_per_row) {
+            throw invalid_argument("bookBest: invalid count");
+        }
+        size_t rows = (_seats + _seats_per_row - 1) / _seats_per_row;
+        bool retry = true;
+        while (retry) {
+            retry = false;
+            for (size_t i = 0; i < rows; ++i) {
+                size_t row = rowAt(i, rows, preference);
+                size_t first = row * _seats_per_row;
+                size_t width = min(_seats_per_row, _seats - first);
+                if (width < count) {
+                    continue;
+                }
+                Word row_seats = width == SeatSet::WORD_BITS ? ~Word{0} : (Word{1} << width) - 1;
+                Word starts = runStarts(~bookedBits(first, width) & row_seats, count);
+                if (!starts) {
+                    continue;
+                }
+                SeatSet seats(_seats);
+                size_t start = first + closestBit(starts, (width - count) / 2);
+                seats.set(start, start + count);
+                if (book(seats)) {
+                    return seats;
+                }
+                // lost the race for these seats, look again with the latest state
+                retry = true;
+                break;
             }
         }
-        if (names.empty()) {
-            throw invalid_argument("movies: theater not found");
+        return SeatSet(_seats);
+    }
+
+    /**
+     * Give back seats previously claimed by book(). The caller must own all seats in @a seat_mask.
+     */
+    void release(SeatMask seat_mask)
+    {
+        _booked[0].fetch_and(~seat_mask, memory_order_release);
+        changed();
+    }
+
+    void release(const SeatSet& seats)
+    {
+        for (size_t i = 0; i < _words; ++i) {
+            if (seats.data()[i]) {
+                _booked[i].fetch_and(~seats.data()[i], memory_order_release);
+            }
         }
-        return names;
+        changed();
     }
+};
 
-    virtual NameList theaters() const
+/**
+ * @internal
+ * The index of movies, theaters and their showings, as a view of the catalog sections of a
+ * Snapshot. Names are interned into ids that follow their sorted order, and an open addressing
+ * hash table turns a name back into its id. The showings are a table sorted by (movie, theater,
+ * start), so the showings of a movie are one contiguous slice of it, and those of a movie in a
+ * theater one slice of that. Finding a showing by ids is an array index and a binary search over
+ * the few showings of the movie, with no string hashing.
+ *
+ * Every name list a reader asks for is a ready-made slice of ids: all movies, all theaters, the
+ * theaters of each movie and, through a reverse index sorted by (theater, movie), the movies of
+ * each theater. The showings of each movie and of each theater are also listed by start, so the
+ * showings in a range of times are found by a binary search. The words of the names are indexed
+ * as well, for searching the names as they are typed.
+ */
+class Catalog
+{
+    const char* _name_pool;
+    // name i is [offsets[i], offsets[i + 1]) of the pool
+    const uint64_t* _movie_names;
+    const uint64_t* _theater_names;
+    const uint32_t* _movie_slots;
+    const uint32_t* _theater_slots;
+    size_t _movie_slot_count;
+    size_t _theater_slot_count;
+    size_t _movies;
+    size_t _theaters;
+    // the showings of movie m are [_movie_showings[m], _movie_showings[m + 1])
+    const uint32_t* _movie_showings;
+    const TheaterId* _showing_theaters;
+    const StartTime* _showing_starts;
+    size_t _showings;
+    // the same showings of every movie by start
+    const uint32_t* _movie_times;
+    // entries [_movie_entries[m], _movie_entries[m + 1]) are the theaters of movie m
+    const uint32_t* _movie_entries;
+    const TheaterId* _movie_theaters;
+    // the reverse index, entries [_theater_entries[t], _theater_entries[t + 1]) are theater t's
+    const uint32_t* _theater_entries;
+    const MovieId* _theater_movies;
+    // entries [_theater_showings[t], _theater_showings[t + 1]) are the showings of theater t, by start
+    const uint32_t* _theater_showings;
+    const uint32_t* _theater_times;
+    // the words of the names, to search them by
+    const NameIndex::Entry* _movie_words;
+    const NameIndex::Entry* _theater_words;
+    size_t _movie_word_count;
+    size_t _theater_word_count;
+
+    string_view name(const uint64_t* offsets, uint32_t id) const
+    {
+        return {_name_pool + offsets[id], size_t(offsets[id + 1] - offsets[id])};
+    }
+
+    /**
+     * The id of @a name in a hash table of ids, or @a missing if it is not there.
+     */
+    uint32_t find(string_view name, const uint64_t* offsets, const uint32_t* slots, size_t slot_count,
+                  uint32_t missing) const
     {
-        unordered_set<string> names;
-        for (auto& [movie, theaters] : _movie_map) {
-            transform(theaters.begin(), theaters.end(), inserter(names, names.begin()),
-                [](const auto& elem){ return elem.first; });
+        for (size_t slot = hash(name) & (slot_count - 1); slots[slot]; slot = (slot + 1) & (slot_count - 1)) {
+            if (this->name(offsets, slots[slot] - 1) == name) {
+                return slots[slot] - 1;
+            }
         }
-        return NameList{names.begin(), names.end()};
+        return missing;
     }
 
-    virtual NameList theaters(const string& movie) const
+    /**
+     * The showings from @a first to @a last, sorted by start, that start in [@a from, @a to).
+     */
+    pair<const uint32_t*, const uint32_t*> startingIn(const uint32_t* first, const uint32_t* last,
+                                                      StartTime from, StartTime to) const
+    {
+        auto before = [this](uint32_t showing, StartTime start) { return _showing_starts[showing] < start; };
+        first = lower_bound(first, last, from, before);
+        return {first, lower_bound(first, last, to, before)};
+    }
+
+public:
+    /**
+     * FNV-1a, which stays the same across builds, unlike std::hash.
+     */
+    static uint64_t hash(string_view name)
     {
-        auto it = _movie_map.find(movie);
-        if (it == _movie_map.end()) {
-            throw invalid_argument("theaters: movie not found");
+        uint64_t h = 0xcbf29ce484222325;
+        for (unsigned char c : name) {
+            h = (h ^ c) * 0x100000001b3;
         }
-        const auto& theater_map = it->second;
-        NameList names;
-        transform(theater_map.begin(), theater_map.end(), back_inserter(names),
-            [](const auto& elem){ return elem.first; });
-        return names;
+        return h;
     }
 
-    virtual SeatMask availableSeats(const string& movie, const string& theater) const
+    /**
+     * The size of the hash table for @a names names: a power of two, at most half full.
+     */
+    static size_t slotsFor(size_t names)
     {
-        return record(movie, theater)->availableSeats();
+        size_t slots = 1;
+        while (slots < 2 * names) {
+            slots *= 2;
+        }
+        return slots;
     }
 
-    virtual bool book(const string& movie, const string& theater, SeatMask seat_mask)
+    explicit Catalog(const Snapshot& snapshot)
+        : _name_pool(snapshot.section<char>(Snapshot::NAME_POOL)),
+          _movie_names(snapshot.section<uint64_t>(Snapshot::MOVIE_NAMES)),
+          _theater_names(snapshot.section<uint64_t>(Snapshot::THEATER_NAMES)),
+          _movie_slots(snapshot.section<uint32_t>(Snapshot::MOVIE_SLOTS)),
+          _theater_slots(snapshot.section<uint32_t>(Snapshot::THEATER_SLOTS)),
+          _movie_slot_count(snapshot.count<uint32_t>(Snapshot::MOVIE_SLOTS)),
+          _theater_slot_count(snapshot.count<uint32_t>(Snapshot::THEATER_SLOTS)),
+          _movies(snapshot.count<uint64_t>(Snapshot::MOVIE_NAMES) - 1),
+          _theaters(snapshot.count<uint64_t>(Snapshot::THEATER_NAMES) - 1),
+          _movie_showings(snapshot.section<uint32_t>(Snapshot::MOVIE_SHOWINGS)),
+          _showing_theaters(snapshot.section<TheaterId>(Snapshot::SHOWING_THEATERS)),
+          _showing_starts(snapshot.section<StartTime>(Snapshot::SHOWING_STARTS)),
+          _showings(snapshot.count<TheaterId>(Snapshot::SHOWING_THEATERS)),
+          _movie_times(snapshot.section<uint32_t>(Snapshot::MOVIE_TIMES)),
+          _movie_entries(snapshot.section<uint32_t>(Snapshot::MOVIE_ENTRIES)),
+          _movie_theaters(snapshot.section<TheaterId>(Snapshot::MOVIE_THEATERS)),
+          _theater_entries(snapshot.section<uint32_t>(Snapshot::THEATER_ENTRIES)),
+          _theater_movies(snapshot.section<MovieId>(Snapshot::THEATER_MOVIES)),
+          _theater_showings(snapshot.section<uint32_t>(Snapshot::THEATER_SHOWINGS)),
+          _theater_times(snapshot.section<uint32_t>(Snapshot::THEATER_TIMES)),
+          _movie_words(snapshot.section<NameIndex::Entry>(Snapshot::MOVIE_WORDS)),
+          _theater_words(snapshot.section<NameIndex::Entry>(Snapshot::THEATER_WORDS)),
+          _movie_word_count(snapshot.count<NameIndex::Entry>(Snapshot::MOVIE_WORDS)),
+          _theater_word_count(snapshot.count<NameIndex::Entry>(Snapshot::THEATER_WORDS))
     {
-        return record(movie, theater)->book(seat_mask);
+        if (snapshot.count<uint64_t>(Snapshot::MOVIE_NAMES) == 0 || snapshot.count<uint64_t>(Snapshot::THEATER_NAMES) == 0
+            || _movie_slot_count == 0 || _theater_slot_count == 0) {
+            throw invalid_argument("Catalog: invalid snapshot");
+        }
     }
 
-private:
-    GuardedRecord* record(const string& movie, const string& theater)
+    /**
+     * All movies, sorted, in a list that keeps @a owner alive, and so on below.
+     */
+    Service::NameList movies(shared_ptr<const void> owner = nullptr) const
+    {
+        return {_name_pool, _movie_names, nullptr, _movies, move(owner)};
+    }
+
+    Service::NameList theaters(shared_ptr<const void> owner = nullptr) const
+    {
+        return {_name_pool, _theater_names, nullptr, _theaters, move(owner)};
+    }
+
+    size_t showings() const
+    {
+        return _showings;
+    }
+
+    MovieId movieId(string_view movie) const
+    {
+        auto id = find(movie, _movie_names, _movie_slots, _movie_slot_count, _movies);
+        if (id == _movies) {
+            throw invalid_argument("movieId: movie not found");
+        }
+        return id;
+    }
+
+    TheaterId theaterId(string_view theater) const
+    {
+        auto id = find(theater, _theater_names, _theater_slots, _theater_slot_count, _theaters);
+        if (id == _theaters) {
+            throw invalid_argument("theaterId: theater not found");
+        }
+        return id;
+    }
+
+    /**
+     * The showings of @a movie, as a range of showing ids.
+     */
+    pair<ShowingId, ShowingId> showings(MovieId movie) const
+    {
+        if (movie >= _movies) {
+            throw invalid_argument("showings: movie not found");
+        }
+        return {_movie_showings[movie], _movie_showings[movie + 1]};
+    }
+
+    /**
+     * The first showing of @a movie in @a theater.
+     */
+    ShowingId showing(MovieId movie, TheaterId theater) const
+    {
+        auto [first, last] = showings(movie);
+        auto it = lower_bound(_showing_theaters + first, _showing_theaters + last, theater);
+        if (it == _showing_theaters + last || *it != theater) {
+            throw invalid_argument("showing: movie is not showing in the theater");
+        }
+        return it - _showing_theaters;
+    }
+
+    ShowingId showing(string_view movie, string_view theater) const
+    {
+        return showing(movieId(movie), theaterId(theater));
+    }
+
+    ShowingId showing(MovieId movie, TheaterId theater, StartTime start) const
+    {
+        auto first = showing(movie, theater);
+        auto last = showings(movie).second;
+        last = upper_bound(_showing_theaters + first, _showing_theaters + last, theater) - _showing_theaters;
+        auto it = lower_bound(_showing_starts + first, _showing_starts + last, start);
+        if (it == _showing_starts + last || *it != start) {
+            throw invalid_argument("showing: movie is not showing in the theater at the time");
+        }
+        return it - _showing_starts;
+    }
+
+    ShowingId showing(string_view movie, string_view theater, StartTime start) const
+    {
+        return showing(movieId(movie), theaterId(theater), start);
+    }
+
+    StartTime startOf(ShowingId showing) const
+    {
+        return _showing_starts[showing];
+    }
+
+    /**
+     * The showings of @a movie that start in [@a from, @a to), by start.
+     */
+    pair<const uint32_t*, const uint32_t*> movieTimes(MovieId movie, StartTime from, StartTime to) const
+    {
+        auto [first, last] = showings(movie);
+        return startingIn(_movie_times + first, _movie_times + last, from, to);
+    }
+
+    /**
+     * The showings in @a theater that start in [@a from, @a to), by start.
+     */
+    pair<const uint32_t*, const uint32_t*> theaterTimes(TheaterId theater, StartTime from, StartTime to) const
+    {
+        if (theater >= _theaters) {
+            throw invalid_argument("showings: theater not found");
+        }
+        return startingIn(_theater_times + _theater_showings[theater], _theater_times + _theater_showings[theater + 1],
+                          from, to);
+    }
+
+    string_view movieOf(ShowingId showing) const
+    {
+        auto it = upper_bound(_movie_showings, _movie_showings + _movies + 1, showing);
+        return name(_movie_names, it - _movie_showings - 1);
+    }
+
+    string_view theaterOf(ShowingId showing) const
     {
-        auto it_movie = _movie_map.find(movie);
-        if (it_movie == _movie_map.end()) {
-            throw invalid_argument("record: movie not found");
+        return name(_theater_names, _showing_theaters[showing]);
+    }
+
+    /**
+     * The theaters that are showing @a movie, sorted.
+     */
+    Service::NameList theatersOf(MovieId movie, shared_ptr<const void> owner = nullptr) const
+    {
+        if (movie >= _movies) {
+            throw invalid_argument("theatersOf: movie not found");
+        }
+        auto first = _movie_entries[movie];
+        return {_name_pool, _theater_names, _movie_theaters + first, _movie_entries[movie + 1] - first, move(owner)};
+    }
+
+    NameIndex movieIndex() const
+    {
+        return {_name_pool, _movie_names, _movie_words, _movie_word_count};
+    }
+
+    NameIndex theaterIndex() const
+    {
+        return {_name_pool, _theater_names, _theater_words, _theater_word_count};
+    }
+
+    /**
+     * The movies that are showing in @a theater, sorted.
+     */
+    Service::NameList moviesIn(TheaterId theater, shared_ptr<const void> owner = nullptr) const
+    {
+        auto first = _theater_entries[theater];
+        return {_name_pool, _movie_names, _theater_movies + first, _theater_entries[theater + 1] - first,
+                move(owner)};
+    }
+};
+
+/**
+ * @internal
+ * The distinct names one part of the showings has seen, in an open addressing hash table that
+ * doubles when it is half full. A name seen again costs a hash and a compare, not a place in a
+ * sort, and only the distinct names are sorted at the end.
+ */
+class NameSet
+{
+    // name i + 1, 0 if empty
+    vector<uint32_t> _slots = vector<uint32_t>(16);
+    vector<string_view> _names;
+
+    size_t slotOf(string_view name) const
+    {
+        size_t mask = _slots.size() - 1;
+        size_t slot = Catalog::hash(name) & mask;
+        while (_slots[slot] && _names[_slots[slot] - 1] != name) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+public:
+    void insert(string_view name)
+    {
+        size_t slot = slotOf(name);
+        if (_slots[slot]) {
+            return;
         }
-        auto& theater_map = it_movie->second;
-        auto it_theater = theater_map.find(theater);
-        if (it_theater == theater_map.end()) {
-            throw invalid_argument("record: theater not found");
+        _names.push_back(name);
+        _slots[slot] = _names.size();
+        if (2 * _names.size() > _slots.size()) {
+            _slots.assign(2 * _slots.size(), 0);
+            for (uint32_t i = 0; i < _names.size(); ++i) {
+                _slots[slotOf(_names[i])] = i + 1;
+            }
         }
-        return it_theater->second;
     }
 
-    const GuardedRecord* record(const string& movie, const string& theater) const
+    vector<string_view> sorted()
     {
-        return const_cast<ServiceImpl*>(this)->record(movie, theater);
+        vector<uint32_t>().swap(_slots);
+        sort(_names.begin(), _names.end());
+        return move(_names);
     }
 };
 
-Service& Service::instance()
+/**
+ * @internal
+ * Merge the sorted names every part has seen into one sorted list without duplicates.
+ */
+static vector<string_view> mergeNames(vector<NameSet>& parts)
 {
-    static ServiceImpl service{begin(booking_table), end(booking_table)};
-    return service;
+    vector<string_view> names;
+    for (auto& part : parts) {
+        auto sorted = part.sorted();
+        size_t middle = names.size();
+        names.insert(names.end(), sorted.begin(), sorted.end());
+        inplace_merge(names.begin(), names.begin() + middle, names.end());
+    }
+    names.erase(unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+/**
+ * @internal
+ * Turn how many items each part has in each of @a buckets buckets into where the first of them
+ * goes, after those of the buckets before and of the parts before in the same bucket, and set
+ * @a starts[b] to where bucket b starts, @a starts[buckets] to the total.
+ */
+static void placeParts(vector<vector<uint32_t>>& counts, uint32_t* starts, size_t buckets)
+{
+    uint32_t offset = 0;
+    for (size_t b = 0; b < buckets; ++b) {
+        starts[b] = offset;
+        for (auto& part : counts) {
+            uint32_t count = part[b];
+            part[b] = offset;
+            offset += count;
+        }
+    }
+    starts[buckets] = offset;
+}
+
+/**
+ * @internal
+ * Lay the showings from @a first to @a last out as a Snapshot: intern and index their names, and
+ * set up the seats of every showing on cache lines of their own.
+ *
+ * The showings are split into parts over @a threads threads, all cores if 0. Every part collects
+ * the names it sees, and these are merged into the ids. Then every part looks its showings up
+ * and counts them per movie, and scatters them into the room the counts of the parts before it
+ * leave in each bucket, which keeps every bucket in the order of the showings; the reverse index
+ * and the showings of every theater are bucketed by theater the same way, and the showings of
+ * every movie and theater are then sorted by start. So the snapshot is the same on any number
+ * of threads.
+ *
+ * With @a order, the snapshot is only an index, without room for the seats, and @a order is set
+ * to the position in [first, last) of every showing of the index.
+ */
+template<typename Iter>
+static Snapshot buildSnapshot(Iter first, Iter last, size_t threads = 0, vector<uint32_t>* order = nullptr)
+{
+    const size_t n = last - first;
+    if (n > numeric_limits<ShowingId>::max()) {
+        throw invalid_argument("Catalog: too many showings");
+    }
+    const size_t parts = parallel::partsFor(n, threads);
+
+    vector<NameSet> part_movies(parts);
+    vector<NameSet> part_theaters(parts);
+    vector<size_t> part_words(parts);
+    parallel::forParts(n, parts, [&](size_t part, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            part_movies[part].insert(first[i].movie_name);
+            part_theaters[part].insert(first[i].theater_name);
+            part_words[part] += GuardedRecord::wordsFor(first[i].seats);
+        }
+    });
+    const vector<string_view> movies = mergeNames(part_movies);
+    const vector<string_view> theaters = mergeNames(part_theaters);
+    size_t pool_size = 0;
+    size_t name_words[2] = {};
+    for (auto names : {&movies, &theaters}) {
+        for (auto name : *names) {
+            pool_size += name.size();
+            name_words[names == &theaters] += NameIndex::wordsIn(name);
+        }
+    }
+    size_t seat_words = accumulate(part_words.begin(), part_words.end(), size_t{0});
+
+    Snapshot::Sizes sizes{};
+    sizes[Snapshot::NAME_POOL] = pool_size;
+    sizes[Snapshot::MOVIE_NAMES] = (movies.size() + 1) * sizeof(uint64_t);
+    sizes[Snapshot::THEATER_NAMES] = (theaters.size() + 1) * sizeof(uint64_t);
+    sizes[Snapshot::MOVIE_SLOTS] = Catalog::slotsFor(movies.size()) * sizeof(uint32_t);
+    sizes[Snapshot::THEATER_SLOTS] = Catalog::slotsFor(theaters.size()) * sizeof(uint32_t);
+    sizes[Snapshot::MOVIE_WORDS] = name_words[0] * sizeof(NameIndex::Entry);
+    sizes[Snapshot::THEATER_WORDS] = name_words[1] * sizeof(NameIndex::Entry);
+    sizes[Snapshot::MOVIE_SHOWINGS] = (movies.size() + 1) * sizeof(uint32_t);
+    sizes[Snapshot::SHOWING_THEATERS] = n * sizeof(TheaterId);
+    sizes[Snapshot::SHOWING_STARTS] = n * sizeof(StartTime);
+    sizes[Snapshot::MOVIE_TIMES] = n * sizeof(uint32_t);
+    sizes[Snapshot::MOVIE_ENTRIES] = (movies.size() + 1) * sizeof(uint32_t);
+    // room for a theater per showing, of which a movie shown in a theater several times takes one
+    sizes[Snapshot::MOVIE_THEATERS] = n * sizeof(TheaterId);
+    sizes[Snapshot::THEATER_ENTRIES] = (theaters.size() + 1) * sizeof(uint32_t);
+    sizes[Snapshot::THEATER_MOVIES] = n * sizeof(MovieId);
+    sizes[Snapshot::THEATER_SHOWINGS] = (theaters.size() + 1) * sizeof(uint32_t);
+    sizes[Snapshot::THEATER_TIMES] = n * sizeof(uint32_t);
+    sizes[Snapshot::SEAT_OFFSETS] = n * sizeof(uint64_t);
+    sizes[Snapshot::SEAT_COUNTS] = n * sizeof(uint32_t);
+    sizes[Snapshot::ROW_WIDTHS] = n * sizeof(uint32_t);
+    sizes[Snapshot::SEATS] = seat_words * sizeof(uint64_t);
+    Snapshot snapshot(sizes, !order);
+
+    char* pool = snapshot.section<char>(Snapshot::NAME_POOL);
+    size_t pool_used = 0;
+    auto intern = [&](const vector<string_view>& names, Snapshot::Section offsets_section,
+                      Snapshot::Section slots_section) {
+        auto offsets = snapshot.section<uint64_t>(offsets_section);
+        auto slots = snapshot.section<uint32_t>(slots_section);
+        size_t mask = snapshot.count<uint32_t>(slots_section) - 1;
+        for (uint32_t id = 0; id < names.size(); ++id) {
+            offsets[id] = pool_used;
+            copy(names[id].begin(), names[id].end(), pool + pool_used);
+            pool_used += names[id].size();
+            size_t slot = Catalog::hash(names[id]) & mask;
+            while (slots[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = id + 1;
+        }
+        offsets[names.size()] = pool_used;
+    };
+    intern(movies, Snapshot::MOVIE_NAMES, Snapshot::MOVIE_SLOTS);
+    intern(theaters, Snapshot::THEATER_NAMES, Snapshot::THEATER_SLOTS);
+    NameIndex::build(pool, snapshot.section<uint64_t>(Snapshot::MOVIE_NAMES), movies.size(),
+                     snapshot.section<NameIndex::Entry>(Snapshot::MOVIE_WORDS), threads);
+    NameIndex::build(pool, snapshot.section<uint64_t>(Snapshot::THEATER_NAMES), theaters.size(),
+                     snapshot.section<NameIndex::Entry>(Snapshot::THEATER_WORDS), threads);
+    // the names can be looked up from here on
+    const Catalog catalog(snapshot);
+
+    struct Showing
+    {
+        MovieId movie;
+        TheaterId theater;
+        StartTime start;
+        uint32_t record;
+    };
+    vector<Showing> unsorted(n);
+    vector<vector<uint32_t>> movie_counts(parts, vector<uint32_t>(movies.size()));
+    parallel::forParts(n, parts, [&](size_t part, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            unsorted[i] = {catalog.movieId(first[i].movie_name), catalog.theaterId(first[i].theater_name),
+                           first[i].start, uint32_t(i)};
+            ++movie_counts[part][unsorted[i].movie];
+        }
+    });
+    auto movie_showings = snapshot.section<uint32_t>(Snapshot::MOVIE_SHOWINGS);
+    placeParts(movie_counts, movie_showings, movies.size());
+
+    vector<Showing> showings(n);
+    parallel::forParts(n, parts, [&](size_t part, size_t begin, size_t end) {
+        auto& next = movie_counts[part];
+        for (size_t i = begin; i < end; ++i) {
+            showings[next[unsorted[i].movie]++] = unsorted[i];
+        }
+    });
+    vector<Showing>().swap(unsorted);
+
+    // from here on a part takes the movies whose showings start in its range, whole
+    auto movieShowings = [&](size_t begin, size_t end) {
+        auto starts = movie_showings;
+        auto ends = movie_showings + movies.size() + 1;
+        return make_pair(movie_showings[lower_bound(starts, ends, begin) - starts],
+                         movie_showings[lower_bound(starts, ends, end) - starts]);
+    };
+    auto showing_theaters = snapshot.section<TheaterId>(Snapshot::SHOWING_THEATERS);
+    auto showing_starts = snapshot.section<StartTime>(Snapshot::SHOWING_STARTS);
+    auto movie_times = snapshot.section<uint32_t>(Snapshot::MOVIE_TIMES);
+    auto movie_entries = snapshot.section<uint32_t>(Snapshot::MOVIE_ENTRIES);
+    auto byStart = [&](uint32_t a, uint32_t b) {
+        return showing_starts[a] != showing_starts[b] ? showing_starts[a] < showing_starts[b] : a < b;
+    };
+    // a movie counts once per theater, however many times it is shown there, and a showing always
+    vector<vector<uint32_t>> theater_counts(parts, vector<uint32_t>(theaters.size()));
+    vector<vector<uint32_t>> time_counts(parts, vector<uint32_t>(theaters.size()));
+    parallel::forParts(n, parts, [&](size_t part, size_t begin, size_t end) {
+        auto [from, to] = movieShowings(begin, end);
+        part_words[part] = 0;
+        for (size_t i = from; i < to; ) {
+            // sort the showings of the movie by theater and start
+            auto movie = showings[i].movie;
+            auto movie_first = i;
+            auto slice = showings.begin() + i;
+            auto slice_end = showings.begin() + movie_showings[movie + 1];
+            sort(slice, slice_end, [](const Showing& a, const Showing& b) {
+                return a.theater != b.theater ? a.theater < b.theater : a.start < b.start;
+            });
+            if (adjacent_find(slice, slice_end, [](const Showing& a, const Showing& b) {
+                    return a.theater == b.theater && a.start == b.start;
+                }) != slice_end) {
+                throw invalid_argument("Catalog: duplicate showing");
+            }
+            for (; i < movie_showings[movie + 1]; ++i) {
+                showing_theaters[i] = showings[i].theater;
+                showing_starts[i] = showings[i].start;
+                movie_times[i] = i;
+                if (i == movie_first || showings[i].theater != showings[i - 1].theater) {
+                    ++theater_counts[part][showings[i].theater];
+                    ++movie_entries[movie + 1];
+                }
+                ++time_counts[part][showings[i].theater];
+                part_words[part] += GuardedRecord::wordsFor(first[showings[i].record].seats);
+            }
+            sort(movie_times + movie_first, movie_times + i, byStart);
+        }
+    });
+    for (size_t m = 0; m < movies.size(); ++m) {
+        movie_entries[m + 1] += movie_entries[m];
+    }
+    auto theater_entries = snapshot.section<uint32_t>(Snapshot::THEATER_ENTRIES);
+    placeParts(theater_counts, theater_entries, theaters.size());
+    auto theater_showings = snapshot.section<uint32_t>(Snapshot::THEATER_SHOWINGS);
+    placeParts(time_counts, theater_showings, theaters.size());
+    // where the seats of every part start
+    size_t words_before = 0;
+    for (auto& words : part_words) {
+        size_t count = words;
+        words = words_before;
+        words_before += count;
+    }
+
+    auto theater_movies = snapshot.section<MovieId>(Snapshot::THEATER_MOVIES);
+    auto movie_theaters = snapshot.section<TheaterId>(Snapshot::MOVIE_THEATERS);
+    auto theater_times = snapshot.section<uint32_t>(Snapshot::THEATER_TIMES);
+    auto seat_offsets = snapshot.section<uint64_t>(Snapshot::SEAT_OFFSETS);
+    auto seat_counts = snapshot.section<uint32_t>(Snapshot::SEAT_COUNTS);
+    auto row_widths = snapshot.section<uint32_t>(Snapshot::ROW_WIDTHS);
+    auto words = order ? nullptr : snapshot.section<atomic<SeatSet::Word>>(Snapshot::SEATS);
+    if (order) {
+        order->resize(n);
+    }
+    parallel::forParts(n, parts, [&](size_t part, size_t begin, size_t end) {
+        auto [from, to] = movieShowings(begin, end);
+        auto& next = theater_counts[part];
+        auto& next_time = time_counts[part];
+        size_t offset = part_words[part];
+        size_t next_theater = 0;
+        for (size_t i = from; i < to; ++i) {
+            auto movie = showings[i].movie;
+            auto theater = showings[i].theater;
+            if (i == movie_showings[movie]) {
+                next_theater = movie_entries[movie];
+            }
+            if (i == movie_showings[movie] || theater != showings[i - 1].theater) {
+                theater_movies[next[theater]++] = movie;
+                movie_theaters[next_theater++] = theater;
+            }
+            theater_times[next_time[theater]++] = i;
+            auto& record = first[showings[i].record];
+            seat_offsets[i] = offset;
+            seat_counts[i] = record.seats;
+            row_widths[i] = record.seats_per_row;
+            if (order) {
+                (*order)[i] = showings[i].record;
+            } else {
+                // sets up the version and the seats, and checks the shape of the showing
+                GuardedRecord(record, words + offset);
+            }
+            offset += GuardedRecord::wordsFor(record.seats);
+        }
+    });
+    parallel::forParts(theaters.size(), parts, [&](size_t, size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            sort(theater_times + theater_showings[t], theater_times + theater_showings[t + 1], byStart);
+        }
+    });
+    return snapshot;
+}
+
+/**
+ * @internal
+ * A logged booking is a list of (showing, seat ranges), each string after its length.
+ */
+static void putString(string& out, string_view s)
+{
+    uint32_t size = s.size();
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(s);
+}
+
+static string_view getString(string_view& in)
+{
+    uint32_t size;
+    if (in.size() < sizeof(size)) {
+        throw invalid_argument("getString: truncated booking");
+    }
+    memcpy(&size, in.data(), sizeof(size));
+    in.remove_prefix(sizeof(size));
+    if (in.size() < size) {
+        throw invalid_argument("getString: truncated booking");
+    }
+    auto s = in.substr(0, size);
+    in.remove_prefix(size);
+    return s;
+}
+
+/**
+ * @internal
+ * Log records other than bookings start with a length no string has, which tells what they are.
+ *
+ * A catalog change then lists the showings it removes, as "-" and the showing, and then those it
+ * adds, as "+", the showing, seats and seats per row. A hold has its id, its deadline in
+ * milliseconds since the epoch, showing and seats; its end has its id, and when it was released
+ * rather than confirmed, showing and seats as well, unless the showing was gone.
+ * Numbers are in decimal.
+ */
+static constexpr uint32_t CATALOG_CHANGE = ~uint32_t{0};
+static constexpr uint32_t HOLD = ~uint32_t{1};
+static constexpr uint32_t HOLD_CONFIRMED = ~uint32_t{2};
+static constexpr uint32_t HOLD_RELEASED = ~uint32_t{3};
+
+static string logTag(uint32_t tag)
+{
+    return string(reinterpret_cast<const char*>(&tag), sizeof(tag));
+}
+
+static size_t getNumber(string_view& in)
+{
+    auto s = getString(in);
+    size_t n;
+    auto [last, error] = from_chars(s.data(), s.data() + s.size(), n);
+    if (error != errc() || last != s.data() + s.size()) {
+        throw invalid_argument("getNumber: invalid number");
+    }
+    return n;
+}
+
+/**
+ * @internal
+ * A showing in a log record is its movie and its theater, then "@" and its start in decimal if it
+ * has one. Neither seat ranges nor numbers start with "@", so records from before showtimes read
+ * as showings without a time.
+ */
+struct LoggedShowing
+{
+    string_view movie;
+    string_view theater;
+    StartTime start = 0;
+};
+
+static void putShowing(string& out, string_view movie, string_view theater, StartTime start)
+{
+    putString(out, movie);
+    putString(out, theater);
+    if (start != 0) {
+        putString(out, "@" + to_string(start));
+    }
+}
+
+static LoggedShowing getShowing(string_view& in)
+{
+    LoggedShowing showing{getString(in), getString(in)};
+    auto rest = in;
+    if (rest.empty()) {
+        return showing;
+    }
+    auto s = getString(rest);
+    if (s.empty() || s[0] != '@') {
+        return showing;
+    }
+    auto [last, error] = from_chars(s.data() + 1, s.data() + s.size(), showing.start);
+    if (error != errc() || last != s.data() + s.size()) {
+        throw invalid_argument("getShowing: invalid start");
+    }
+    in = rest;
+    return showing;
+}
+
+/**
+ * @internal
+ * The version and the seats of a showing added after the service started, in a block of their own.
+ */
+struct SeatBlock
+{
+    atomic<SeatSet::Word>* words;
+    uint32_t seats;
+    uint32_t seats_per_row;
+
+    static atomic<SeatSet::Word>* allocate(size_t seats)
+    {
+        size_t words = GuardedRecord::wordsFor(seats);
+        auto block = static_cast<atomic<SeatSet::Word>*>(
+            ::operator new(words * sizeof(atomic<SeatSet::Word>), align_val_t(CACHE_LINE_SIZE)));
+        for (size_t i = 0; i < words; ++i) {
+            new (block + i) atomic<SeatSet::Word>(0);
+        }
+        return block;
+    }
+
+    static void free(atomic<SeatSet::Word>* words)
+    {
+        ::operator delete(words, align_val_t(CACHE_LINE_SIZE));
+    }
+};
+
+/**
+ * @internal
+ * One edition of the catalog, which readers see as a whole and which never changes once it is
+ * published. A change to the catalog builds the next edition beside it: the index is built anew,
+ * but the seats are not copied, so a booking lands on the same words whichever edition it went
+ * through.
+ *
+ * Showings keep their ids from one edition to the next. In the first edition, an id is the
+ * position of the showing in the index, and its seats are in the snapshot the service started
+ * from; later, the index maps positions to ids and back, and the showings added since the start
+ * have ids after those and seat blocks of their own.
+ */
+class Edition : public enable_shared_from_this<Edition>
+{
+    // the index of every edition but the first, which is the snapshot the service started from
+    Snapshot _owned;
+
+public:
+    static constexpr uint32_t GONE = ~uint32_t{0};
+
+    const Snapshot& index;
+    const Catalog catalog;
+    const uint64_t version;
+    // the id at every position, and the position of every id or GONE, unless ids are positions
+    vector<ShowingId> ids;
+    vector<uint32_t> positions;
+    // the seats of the showings added since the start, by id after the first edition's, or null
+    vector<SeatBlock> added;
+    // the blocks of the showings removed in the next edition, which go with this one
+    vector<atomic<SeatSet::Word>*> retired;
+
+    explicit Edition(const Snapshot& first)
+        : index(first), catalog(first), version(0)
+    {
+    }
+
+    Edition(Snapshot index, uint64_t version)
+        : _owned(move(index)), index(_owned), catalog(_owned), version(version)
+    {
+    }
+
+    ~Edition()
+    {
+        for (auto words : retired) {
+            SeatBlock::free(words);
+        }
+    }
+
+    bool has(ShowingId showing) const
+    {
+        return ids.empty() ? showing < catalog.showings() : showing < positions.size() && positions[showing] != GONE;
+    }
+
+    ShowingId idAt(uint32_t position) const
+    {
+        return ids.empty() ? position : ids[position];
+    }
+
+    /**
+     * The position of @a showing in the index, which must be in this edition.
+     */
+    uint32_t positionOf(ShowingId showing) const
+    {
+        return ids.empty() ? showing : positions[showing];
+    }
+
+    ShowingId showing(string_view movie, string_view theater) const
+    {
+        return idAt(catalog.showing(movie, theater));
+    }
+
+    ShowingId showing(string_view movie, string_view theater, StartTime start) const
+    {
+        return idAt(catalog.showing(movie, theater, start));
+    }
+
+    ShowingId showing(const LoggedShowing& showing) const
+    {
+        return this->showing(showing.movie, showing.theater, showing.start);
+    }
+
+    /**
+     * Put the showing at @a position in a log record.
+     */
+    void putShowing(string& out, uint32_t position) const
+    {
+        ::putShowing(out, catalog.movieOf(position), catalog.theaterOf(position), catalog.startOf(position));
+    }
+
+    shared_ptr<const void> owner() const
+    {
+        return shared_from_this();
+    }
+};
+
+class ServiceImpl : public Service
+{
+    // the snapshot the service started from, which keeps the seats of its showings
+    Snapshot _snapshot;
+    atomic<SeatSet::Word>* _seat_words;
+    const uint64_t* _seat_offsets;
+    const uint32_t* _seat_counts;
+    const uint32_t* _row_widths;
+    size_t _first_showings;
+    mutable ChangeNotifier _changes;
+    // the edition readers see, which _current owns; both only change under _update_m
+    atomic<const Edition*> _edition;
+    shared_ptr<Edition> _current;
+    mutable mutex _update_m;
+    unique_ptr<WriteAheadLog> _log;
+    mutex _checkpoint_m;
+    condition_variable _checkpoint_stop;
+    bool _stopping = false;
+    thread _checkpointer;
+    // the seats on hold, which only the hold, confirm and release calls and the reaper touch
+    struct Hold : TimerWheel::Timer
+    {
+        HoldId id;
+        ShowingId showing;
+        SeatSet seats;
+        // in milliseconds since the epoch, as logged
+        int64_t deadline;
+        // the log record of the hold, which checkpoints replay from as long as the hold is open
+        WriteAheadLog::Lsn lsn;
+        // confirmed or released, and waiting for that to be logged
+        bool ending = false;
+    };
+    static constexpr chrono::milliseconds HOLD_TICK{100};
+    // where the hold timers start from, once the log is replayed
+    chrono::steady_clock::time_point _started;
+    mutable mutex _holds_m;
+    unordered_map<HoldId, Hold> _holds;
+    TimerWheel _hold_timers;
+    mt19937_64 _hold_ids{random_device{}()};
+    condition_variable _reaper_stop;
+    bool _reaper_stopping = false;
+    thread _reaper;
+    // the seats of the showings the service started with, moved to their shards, if sharded
+    mutable vector<GuardedRecord::Words> _shard_seats;
+    size_t _showings_per_shard = 0;
+    // last, so that its threads are stopped first
+    unique_ptr<ShardRouter> _router;
+
+    /**
+     * The edition to read, which stays valid as long as the calling thread's Rcu::Reader lives.
+     */
+    const Edition& edition() const
+    {
+        return *_edition.load(memory_order_acquire);
+    }
+
+public:
+    /**
+     * The showings from @a first to @a last, indexed with @a threads threads, all cores if 0,
+     * with the bookings in @a log, if any, replayed on top of them. Bookings are logged before
+     * they are acknowledged.
+     */
+    template<typename Iter>
+    ServiceImpl(Iter first, Iter last, unique_ptr<WriteAheadLog> log = nullptr, size_t threads = 0)
+        : ServiceImpl(buildSnapshot(first, last, threads), move(log))
+    {
+        // never checkpointed
+        _changes.markChanged();
+    }
+
+    /**
+     * The catalog and the seats in @a snapshot, used in place, with the bookings and the catalog
+     * changes in @a log that came after the snapshot replayed on top of them.
+     */
+    explicit ServiceImpl(Snapshot snapshot, unique_ptr<WriteAheadLog> log = nullptr)
+        : _snapshot(move(snapshot)),
+          _seat_words(_snapshot.section<atomic<SeatSet::Word>>(Snapshot::SEATS)),
+          _seat_offsets(_snapshot.section<uint64_t>(Snapshot::SEAT_OFFSETS)),
+          _seat_counts(_snapshot.section<uint32_t>(Snapshot::SEAT_COUNTS)),
+          _row_widths(_snapshot.section<uint32_t>(Snapshot::ROW_WIDTHS)),
+          _first_showings(_snapshot.count<uint32_t>(Snapshot::SEAT_COUNTS)),
+          _current(make_shared<Edition>(_snapshot)),
+          _log(move(log))
+    {
+        _edition.store(_current.get(), memory_order_release);
+        if (_log) {
+            auto lsn = _snapshot.logRecords();
+            _log->replay([&](string_view record) { replay(record, ++lsn); }, _snapshot.logRecords());
+        }
+        // the holds still open run out from where they were, however long the replay took
+        const lock_guard<mutex> lock(_holds_m);
+        _started = chrono::steady_clock::now();
+        auto now = chrono::system_clock::now();
+        for (auto& [id, hold] : _holds) {
+            auto deadline = chrono::system_clock::time_point(chrono::milliseconds(hold.deadline));
+            _hold_timers.schedule(&hold, holdTicks(max(now, deadline) - now));
+        }
+        if (!_holds.empty()) {
+            startReaper();
+        }
+    }
+
+    ~ServiceImpl()
+    {
+        {
+            const lock_guard<mutex> lock(_checkpoint_m);
+            _stopping = true;
+        }
+        _checkpoint_stop.notify_all();
+        if (_checkpointer.joinable()) {
+            _checkpointer.join();
+        }
+        stopReaper();
+        // the blocks of the showings added since the start go with the last edition
+        for (auto& block : _current->added) {
+            if (block.words) {
+                _current->retired.push_back(block.words);
+            }
+        }
+    }
+
+    /**
+     * Write the catalog and the seats to the snapshot at @a path. Bookings go on meanwhile; the
+     * ones logged after the snapshot is started are replayed on top of it, and replaying one
+     * that made it into the snapshot anyway changes nothing. Catalog changes wait for the
+     * snapshot to start, so it has all of those logged before it, and none after. Holds that
+     * are still open are replayed as well, with everything logged after them.
+     *
+     * The seats copied may have been claimed by bookings that are not on disk yet, and that are
+     * given back if they never make it. Every booking appends its record in the Rcu::Reader it
+     * claims its seats in, so once the copy is done and the readers are synchronized, all of them
+     * are appended, and the snapshot only replaces the last one once they are on disk as well.
+     * Once it has, the log drops the records the snapshot covers.
+     */
+    void checkpoint(const string& path) const
+    {
+        shared_ptr<const Edition> edition;
+        uint64_t log_records;
+        {
+            const lock_guard<mutex> lock(_update_m);
+            edition = _current;
+            log_records = _log ? _log->durable() : 0;
+            // the seats on hold are taken in the snapshot, so it replays the holds still open
+            const lock_guard<mutex> holds_lock(_holds_m);
+            for (auto& [id, hold] : _holds) {
+                log_records = min(log_records, hold.lsn - 1);
+            }
+        }
+        auto written = [this] {
+            if (_log) {
+                Rcu::synchronize();
+                _log->sync(_log->appended());
+            }
+        };
+        if (edition->ids.empty() && _shard_seats.empty()) {
+            _snapshot.write(path, log_records, nullptr, written);
+        } else {
+            // the seats are all over the place, they are gathered in the order of the index
+            edition->index.write(path, log_records, [&](size_t position) {
+                return seatsOf(*edition, edition->idAt(position));
+            }, written);
+        }
+        // the snapshot replays from the records after these, the log need not keep them
+        if (_log) {
+            _log->compact(log_records);
+        }
+    }
+
+    /**
+     * Checkpoint to @a path every @a interval in the background, if the seats have changed, or
+     * if the catalog has never been saved.
+     */
+    void checkpointEvery(const string& path, chrono::milliseconds interval)
+    {
+        _checkpointer = thread([this, path, interval] {
+            unique_lock<mutex> lock(_checkpoint_m);
+            while (!_checkpoint_stop.wait_for(lock, interval, [this] { return _stopping; })) {
+                // whatever changes from here on is left for the next checkpoint
+                if (!_changes.takeChanged()) {
+                    continue;
+                }
+                lock.unlock();
+                try {
+                    checkpoint(path);
+                } catch (system_error& e) {
+                    cerr << e.what() << endl;
+                    // try again next time
+                    _changes.markChanged();
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    /**
+     * Split the showings the service started with into @a shards shards of consecutive ids, and
+     * move the seats of each to memory that the pinned thread of the shard allocates and writes
+     * first, so that the kernel places it on the memory of the shard's cores. From then on, the
+     * bookings of a showing are run by the thread of its shard. Call it before the service is
+     * used; 1 leaves everything where it is.
+     */
+    void shard(size_t shards)
+    {
+        if (shards <= 1) {
+            return;
+        }
+        // the holds replayed may expire meanwhile, their seats are released once they are copied
+        bool reaping = _reaper.joinable();
+        if (reaping) {
+            stopReaper();
+        }
+        _router = make_unique<ShardRouter>(shards);
+        _showings_per_shard = max<size_t>(1, (_first_showings + shards - 1) / shards);
+        const size_t words = _snapshot.count<atomic<SeatSet::Word>>(Snapshot::SEATS);
+        auto offset = [&](size_t showing) {
+            return showing < _first_showings ? _seat_offsets[showing] : words;
+        };
+        vector<GuardedRecord::Words> seats(shards);
+        _router->forEach([&](size_t shard) {
+            size_t first = min(_first_showings, shard * _showings_per_shard);
+            size_t last = min(_first_showings, first + _showings_per_shard);
+            GuardedRecord::Words shard_seats(offset(last) - offset(first));
+            for (size_t i = 0; i < shard_seats.size(); ++i) {
+                shard_seats[i].store(_seat_words[offset(first) + i].load(memory_order_relaxed), memory_order_relaxed);
+            }
+            seats[shard] = move(shard_seats);
+        });
+        _shard_seats = move(seats);
+        if (reaping) {
+            const lock_guard<mutex> lock(_holds_m);
+            _reaper_stopping = false;
+            startReaper();
+        }
+    }
+
+    virtual NameList movies() const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.catalog.movies(e.owner());
+    }
+
+    virtual NameList movies(const std::string& theater) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.catalog.moviesIn(e.catalog.theaterId(theater), e.owner());
+    }
+
+    virtual NameList theaters() const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.catalog.theaters(e.owner());
+    }
+
+    virtual NameList theaters(const string& movie) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.catalog.theatersOf(e.catalog.movieId(movie), e.owner());
+    }
+
+    virtual MovieId movieId(const string& movie) const
+    {
+        const Rcu::Reader reader;
+        return edition().catalog.movieId(movie);
+    }
+
+    virtual TheaterId theaterId(const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return edition().catalog.theaterId(theater);
+    }
+
+    virtual ShowingId showing(MovieId movie, TheaterId theater) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.idAt(e.catalog.showing(movie, theater));
+    }
+
+    virtual ShowingId showing(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return edition().showing(movie, theater);
+    }
+
+    virtual ShowingId showing(MovieId movie, TheaterId theater, StartTime start) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return e.idAt(e.catalog.showing(movie, theater, start));
+    }
+
+    virtual ShowingId showing(const string& movie, const string& theater, StartTime start) const
+    {
+        const Rcu::Reader reader;
+        return edition().showing(movie, theater, start);
+    }
+
+    virtual StartTime start(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        if (!e.has(showing)) {
+            throw invalid_argument("start: showing not found");
+        }
+        return e.catalog.startOf(e.positionOf(showing));
+    }
+
+    virtual ShowtimeList movieShowtimes(const string& movie, StartTime from, StartTime to) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return showtimes(e, e.catalog.movieTimes(e.catalog.movieId(movie), from, to));
+    }
+
+    virtual ShowtimeList theaterShowtimes(const string& theater, StartTime from, StartTime to) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return showtimes(e, e.catalog.theaterTimes(e.catalog.theaterId(theater), from, to));
+    }
+
+    virtual NameList searchMovies(const string& query, size_t limit) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return found(e, e.catalog.movieIndex(), query, limit);
+    }
+
+    virtual NameList searchTheaters(const string& query, size_t limit) const
+    {
+        const Rcu::Reader reader;
+        auto& e = edition();
+        return found(e, e.catalog.theaterIndex(), query, limit);
+    }
+
+    virtual uint64_t catalogVersion() const
+    {
+        const Rcu::Reader reader;
+        return edition().version;
+    }
+
+    virtual uint64_t version(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).version();
+    }
+
+    virtual uint64_t waitForChange(ShowingId showing, uint64_t version, chrono::milliseconds timeout) const
+    {
+        const void* key;
+        {
+            const Rcu::Reader reader;
+            auto rec = record(showing);
+            if (rec.version() != version) {
+                return rec.version();
+            }
+            key = rec.changeKey();
+        }
+        // no Reader while asleep, which would hold up catalog changes; removing the showing wakes it up
+        _changes.wait(key, timeout, [&] {
+            const Rcu::Reader reader;
+            return !edition().has(showing) || record(showing).version() != version;
+        });
+        const Rcu::Reader reader;
+        return record(showing).version();
+    }
+
+    virtual size_t seatCount(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return record(movie, theater).seats();
+    }
+
+    virtual size_t seatCount(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).seats();
+    }
+
+    virtual size_t seatsPerRow(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return record(movie, theater).seatsPerRow();
+    }
+
+    virtual size_t seatsPerRow(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).seatsPerRow();
+    }
+
+    virtual SeatMask availableSeats(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return record(movie, theater).availableSeats();
+    }
+
+    virtual SeatMask availableSeats(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).availableSeats();
+    }
+
+    virtual SeatSet availableSeatSet(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return record(movie, theater).availableSeatSet();
+    }
+
+    virtual SeatSet availableSeatSet(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).availableSeatSet();
+    }
+
+    virtual size_t availableSeatCount(const string& movie, const string& theater) const
+    {
+        const Rcu::Reader reader;
+        return record(movie, theater).availableSeatCount();
+    }
+
+    virtual size_t availableSeatCount(ShowingId showing) const
+    {
+        const Rcu::Reader reader;
+        return record(showing).availableSeatCount();
+    }
+
+    // the showing is looked up in a Reader of its own, for booking waits for the log outside of any
+    virtual bool book(const string& movie, const string& theater, SeatMask seat_mask)
+    {
+        return book(showing(movie, theater), seat_mask);
+    }
+
+    virtual bool book(ShowingId showing, SeatMask seat_mask)
+    {
+        vector<pair<ShowingId, SeatSet>> claims;
+        WriteAheadLog::Lsn lsn;
+        {
+            const Rcu::Reader reader;
+            // no showing has 0 seats
+            size_t seats = onShard(showing, [&](GuardedRecord rec) {
+                return rec.book(seat_mask) ? rec.seats() : 0;
+            });
+            Metrics::booking(showing, seats != 0);
+            if (seats == 0) {
+                return false;
+            }
+            claims.emplace_back(showing, SeatSet::fromMask(seat_mask, seats));
+            lsn = appendBookings(claims);
+        }
+        syncBookings(lsn, claims);
+        return true;
+    }
+
+    virtual bool book(const string& movie, const string& theater, const SeatSet& seats)
+    {
+        return book(showing(movie, theater), seats);
+    }
+
+    virtual bool book(ShowingId showing, const SeatSet& seats)
+    {
+        vector<pair<ShowingId, SeatSet>> claims;
+        WriteAheadLog::Lsn lsn;
+        {
+            const Rcu::Reader reader;
+            bool booked = onShard(showing, [&](GuardedRecord rec) { return rec.book(seats); });
+            Metrics::booking(showing, booked);
+            if (!booked) {
+                return false;
+            }
+            claims.emplace_back(showing, seats);
+            lsn = appendBookings(claims);
+        }
+        syncBookings(lsn, claims);
+        return true;
+    }
+
+    virtual SeatSet bookBest(const string& movie, const string& theater, size_t count,
+                             SeatPreference preference)
+    {
+        return bookBest(showing(movie, theater), count, preference);
+    }
+
+    virtual SeatSet bookBest(ShowingId showing, size_t count, SeatPreference preference)
+    {
+        vector<pair<ShowingId, SeatSet>> claims;
+        WriteAheadLog::Lsn lsn;
+        {
+            const Rcu::Reader reader;
+            auto seats = onShard(showing, [&](GuardedRecord rec) { return rec.bookBest(count, preference); });
+            Metrics::booking(showing, seats.any());
+            if (seats.none()) {
+                return seats;
+            }
+            claims.emplace_back(showing, move(seats));
+            lsn = appendBookings(claims);
+        }
+        syncBookings(lsn, claims);
+        return claims.front().second;
+    }
+
+    /**
+     * Unlike the other bookings, a batch is claimed on the calling thread, for it spans shards.
+     * The seats are atomic wherever they are booked from, the shards only keep them on their cores,
+     * and the batch locks its records from the other bookings while it claims them.
+     */
+    virtual bool bookBatch(const vector<Booking>& bookings)
+    {
+        if (bookings.empty()) {
+            throw invalid_argument("bookBatch: no bookings");
+        }
+
+        vector<pair<ShowingId, SeatSet>> claims;
+        bool booked;
+        WriteAheadLog::Lsn lsn = 0;
+        {
+            const Rcu::Reader reader;
+            auto& e = edition();
+
+            // resolve and validate everything before claiming any seat
+            claims.reserve(bookings.size());
+            for (auto& booking : bookings) {
+                auto showing = booking.start ? e.showing(booking.movie, booking.theater, *booking.start)
+                                             : e.showing(booking.movie, booking.theater);
+                if (booking.seats.size() != record(showing).seats() || booking.seats.none()) {
+                    throw invalid_argument("bookBatch: invalid seats");
+                }
+                claims.emplace_back(showing, booking.seats);
+            }
+
+            // one claim per record
+            sort(claims.begin(), claims.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+            auto last = claims.begin();
+            for (auto it = next(claims.begin()); it != claims.end(); ++it) {
+                if (it->first == last->first) {
+                    if (last->second.intersects(it->second)) {
+                        throw invalid_argument("bookBatch: seats booked twice");
+                    }
+                    last->second |= it->second;
+                } else if (++last != it) {
+                    *last = move(*it);
+                }
+            }
+            claims.erase(next(last), claims.end());
+
+            vector<pair<GuardedRecord, const SeatSet*>> records;
+            records.reserve(claims.size());
+            for (auto& [showing, seats] : claims) {
+                records.emplace_back(record(showing), &seats);
+            }
+            booked = GuardedRecord::bookAll(records);
+            if (booked) {
+                lsn = appendBookings(claims);
+            }
+        }
+        for (auto& claim : claims) {
+            Metrics::booking(claim.first, booked);
+        }
+        if (!booked) {
+            return false;
+        }
+        syncBookings(lsn, claims);
+        return true;
+    }
+
+    virtual uint64_t updateCatalog(const vector<CatalogEntry>& remove, const vector<CatalogEntry>& add)
+    {
+        return change(remove, add, true);
+    }
+
+    virtual HoldId hold(const string& movie, const string& theater, SeatMask seat_mask, chrono::milliseconds ttl)
+    {
+        ShowingId showing;
+        size_t seats;
+        {
+            const Rcu::Reader reader;
+            showing = edition().showing(movie, theater);
+            seats = record(showing).seats();
+        }
+        return hold(showing, SeatSet::fromMask(seat_mask, seats), ttl);
+    }
+
+    /**
+     * The seats are claimed like a booking, so the booking path knows nothing of holds; the hold
+     * itself is kept in a table and a timer wheel, under a lock of their own.
+     */
+    virtual HoldId hold(ShowingId showing, const SeatSet& seats, chrono::milliseconds ttl)
+    {
+        if (ttl.count() <= 0) {
+            throw invalid_argument("hold: invalid ttl");
+        }
+        HoldId id;
+        WriteAheadLog::Lsn lsn = 0;
+        {
+            // the hold is appended to the log in the Reader its seats are claimed in, see checkpoint()
+            const Rcu::Reader reader;
+            if (!onShard(showing, [&](GuardedRecord rec) { return rec.book(seats); })) {
+                return 0;
+            }
+            auto deadline = chrono::duration_cast<chrono::milliseconds>(
+                (chrono::system_clock::now() + ttl).time_since_epoch()).count();
+            auto& e = edition();
+            if (!e.has(showing)) {
+                // gone with its seats meanwhile
+                return 0;
+            }
+            string logged_showing;
+            e.putShowing(logged_showing, e.positionOf(showing));
+
+            const lock_guard<mutex> lock(_holds_m);
+            do {
+                id = _hold_ids();
+            } while (id == 0 || _holds.count(id));
+            if (_log) {
+                string logged = logTag(HOLD);
+                putString(logged, to_string(id));
+                putString(logged, to_string(deadline));
+                logged += logged_showing;
+                putString(logged, seats.toRanges());
+                // the hold is in the table before its record can be durable, for the checkpoints to see it
+                lsn = _log->append(logged);
+            }
+            auto& hold = _holds[id];
+            hold.id = id;
+            hold.showing = showing;
+            hold.seats = seats;
+            hold.deadline = deadline;
+            hold.lsn = lsn;
+            _hold_timers.schedule(&hold, holdTicks(chrono::steady_clock::now() - _started + ttl));
+            startReaper();
+        }
+        if (_log) {
+            try {
+                _log->sync(lsn);
+            } catch (...) {
+                unique_lock<mutex> lock(_holds_m);
+                auto it = _holds.find(id);
+                if (it != _holds.end() && !it->second.ending) {
+                    _hold_timers.cancel(&it->second);
+                    _holds.erase(it);
+                    lock.unlock();
+                    const Rcu::Reader reader;
+                    if (edition().has(showing)) {
+                        record(showing).release(seats);
+                    }
+                }
+                throw;
+            }
+        }
+        return id;
+    }
+
+    virtual bool confirm(HoldId hold)
+    {
+        unique_lock<mutex> lock(_holds_m);
+        return endHolds(lock, {hold}, true) != 0;
+    }
+
+    virtual bool release(HoldId hold)
+    {
+        unique_lock<mutex> lock(_holds_m);
+        return endHolds(lock, {hold}, false) != 0;
+    }
+
+private:
+    /**
+     * The number of hold ticks it takes for @a time to pass, rounded up.
+     */
+    template<typename Duration>
+    static uint64_t holdTicks(Duration time)
+    {
+        return (chrono::duration_cast<chrono::milliseconds>(time) + HOLD_TICK - chrono::milliseconds(1)) / HOLD_TICK;
+    }
+
+    /**
+     * Start the thread that releases the holds as they expire, unless it runs already. Call it
+     * with _holds_m locked.
+     */
+    void startReaper()
+    {
+        if (_reaper.joinable()) {
+            return;
+        }
+        _reaper = thread([this] {
+            unique_lock<mutex> lock(_holds_m);
+            while (!_reaper_stop.wait_for(lock, HOLD_TICK, [this] { return _reaper_stopping; })) {
+                vector<HoldId> expired;
+                _hold_timers.advance(holdTicks(chrono::steady_clock::now() - _started), [&](TimerWheel::Timer* timer) {
+                    expired.push_back(static_cast<Hold*>(timer)->id);
+                });
+                if (expired.empty()) {
+                    continue;
+                }
+                try {
+                    endHolds(lock, expired, false);
+                } catch (system_error& e) {
+                    cerr << e.what() << endl;
+                }
+            }
+        });
+    }
+
+    /**
+     * Stop the thread that releases the holds, and wait for it to finish what it is releasing.
+     */
+    void stopReaper()
+    {
+        {
+            const lock_guard<mutex> lock(_holds_m);
+            _reaper_stopping = true;
+        }
+        _reaper_stop.notify_all();
+        if (_reaper.joinable()) {
+            _reaper.join();
+        }
+    }
+
+    /**
+     * Confirm or release the holds @a ids that are still open, and return how many of them are.
+     * A confirmed hold whose showing is gone is released instead, and not counted, here or in
+     * the booking metrics. @a lock, on
+     * _holds_m, is let go while the seats are released and the log is synced.
+     *
+     * Every end is logged before the seats are released, so a booking of those seats is always
+     * logged after it, and the holds stay in the table until their end is on disk, so that a
+     * checkpoint meanwhile still replays them.
+     */
+    size_t endHolds(unique_lock<mutex>& lock, const vector<HoldId>& ids, bool confirm)
+    {
+        vector<pair<ShowingId, SeatSet>> released;
+        vector<HoldId> ended;
+        WriteAheadLog::Lsn lsn = 0;
+        vector<ShowingId> confirmed;
+        {
+            const Rcu::Reader reader;
+            auto& e = edition();
+            for (auto id : ids) {
+                auto it = _holds.find(id);
+                if (it == _holds.end() || it->second.ending) {
+                    continue;
+                }
+                auto& hold = it->second;
+                _hold_timers.cancel(&hold);
+                hold.ending = true;
+                ended.push_back(id);
+                bool present = e.has(hold.showing);
+                if (confirm && present) {
+                    confirmed.push_back(hold.showing);
+                } else if (present) {
+                    released.emplace_back(hold.showing, hold.seats);
+                }
+                if (_log) {
+                    string logged = logTag(confirm && present ? HOLD_CONFIRMED : HOLD_RELEASED);
+                    putString(logged, to_string(id));
+                    if (!confirm && present) {
+                        e.putShowing(logged, e.positionOf(hold.showing));
+                        putString(logged, hold.seats.toRanges());
+                    }
+                    lsn = _log->append(logged);
+                }
+            }
+        }
+        if (ended.empty()) {
+            return 0;
+        }
+
+        lock.unlock();
+        if (!released.empty()) {
+            const Rcu::Reader reader;
+            for (auto& [showing, seats] : released) {
+                if (edition().has(showing)) {
+                    record(showing).release(seats);
+                }
+            }
+        }
+        try {
+            if (_log) {
+                _log->sync(lsn);
+            }
+        } catch (...) {
+            // left in the table, as nothing logged from now on is durable
+            lock.lock();
+            throw;
+        }
+        lock.lock();
+        for (auto id : ended) {
+            _holds.erase(id);
+        }
+        // a hold counts as a booking once it is confirmed
+        for (auto showing : confirmed) {
+            Metrics::booking(showing, true);
+        }
+        return confirm ? confirmed.size() : ended.size();
+    }
+
+    /**
+     * Append the seats just claimed in @a claims to the log, if there is one, in the Rcu::Reader
+     * they were claimed in, so that once a checkpoint has synchronized, every seat it has copied
+     * has its record appended. Showings removed meanwhile are left out.
+     * @return the sequence number of the record, 0 without a log.
+     */
+    WriteAheadLog::Lsn appendBookings(const vector<pair<ShowingId, SeatSet>>& claims)
+    {
+        if (!_log) {
+            return 0;
+        }
+        string bookings;
+        auto& e = edition();
+        for (auto& [showing, seats] : claims) {
+            if (e.has(showing)) {
+                e.putShowing(bookings, e.positionOf(showing));
+                putString(bookings, seats.toRanges());
+            }
+        }
+        return _log->append(bookings);
+    }
+
+    /**
+     * Wait until the bookings appended as @a lsn are on disk, outside of any Rcu::Reader, so that
+     * catalog changes need not wait for the disk. If they cannot be logged, give the seats of
+     * @a claims back and throw.
+     */
+    void syncBookings(WriteAheadLog::Lsn lsn, const vector<pair<ShowingId, SeatSet>>& claims)
+    {
+        if (!_log) {
+            return;
+        }
+        try {
+            _log->sync(lsn);
+        } catch (...) {
+            const Rcu::Reader reader;
+            for (auto& [showing, seats] : claims) {
+                if (edition().has(showing)) {
+                    record(showing).release(seats);
+                }
+            }
+            throw;
+        }
+    }
+
+    /**
+     * Apply a logged booking, catalog change or hold again, @a lsn being the sequence number of
+     * its record. Bookings and holds of showings that are no longer in the catalog are skipped,
+     * and so are catalog changes that are made already. The holds still open at the end are
+     * left in the table.
+     */
+    void replay(string_view record, WriteAheadLog::Lsn lsn)
+    {
+        uint32_t tag = 0;
+        if (record.size() >= sizeof(tag)) {
+            memcpy(&tag, record.data(), sizeof(tag));
+        }
+        if (tag == HOLD || tag == HOLD_CONFIRMED || tag == HOLD_RELEASED) {
+            record.remove_prefix(sizeof(tag));
+            HoldId id = getNumber(record);
+            int64_t deadline = tag == HOLD ? getNumber(record) : 0;
+            const Rcu::Reader reader;
+            const lock_guard<mutex> lock(_holds_m);
+            _holds.erase(id);
+            if (record.empty()) {
+                return;
+            }
+            auto logged = getShowing(record);
+            auto ranges = getString(record);
+            try {
+                auto showing = edition().showing(logged);
+                auto rec = this->record(showing);
+                auto seats = SeatSet::fromRanges(ranges, rec.seats());
+                if (tag == HOLD_RELEASED) {
+                    rec.release(seats);
+                    return;
+                }
+                // taken already if the snapshot has it
+                rec.book(seats);
+                auto& hold = _holds[id];
+                hold.id = id;
+                hold.showing = showing;
+                hold.seats = move(seats);
+                hold.deadline = deadline;
+                hold.lsn = lsn;
+            } catch (invalid_argument&) {
+                // not showing anymore
+            }
+            return;
+        }
+        if (tag == CATALOG_CHANGE) {
+            record.remove_prefix(sizeof(tag));
+            vector<CatalogEntry> remove;
+            vector<CatalogEntry> add;
+            while (!record.empty()) {
+                bool adding = getString(record) == "+";
+                auto logged = getShowing(record);
+                CatalogEntry entry{string(logged.movie), string(logged.theater)};
+                entry.start = logged.start;
+                if (adding) {
+                    entry.seats = getNumber(record);
+                    entry.seats_per_row = getNumber(record);
+                }
+                (adding ? add : remove).push_back(move(entry));
+            }
+            change(remove, add, false);
+            return;
+        }
+
+        const Rcu::Reader reader;
+        while (!record.empty()) {
+            auto logged = getShowing(record);
+            auto ranges = getString(record);
+            try {
+                auto rec = this->record(edition().showing(logged));
+                rec.book(SeatSet::fromRanges(ranges, rec.seats()));
+            } catch (invalid_argument&) {
+                // not showing anymore
+            }
+        }
+    }
+
+    /**
+     * Publish the next edition of the catalog, without the showings in @a remove and with those
+     * in @a add. Unless @a strict, showings to remove that are gone already and showings to add
+     * that are there already are skipped, as when the change is replayed; otherwise the change is
+     * logged before it is published.
+     */
+    uint64_t change(const vector<CatalogEntry>& remove, const vector<CatalogEntry>& add, bool strict)
+    {
+        const lock_guard<mutex> lock(_update_m);
+        // only changes replace the edition, and this is the only one going on
+        const Edition& e = *_current;
+        const size_t showings = e.catalog.showings();
+
+        vector<bool> removed(showings);
+        for (auto& entry : remove) {
+            try {
+                auto position = e.catalog.showing(entry.movie, entry.theater, entry.start);
+                if (removed[position] && strict) {
+                    throw invalid_argument("updateCatalog: showing removed twice");
+                }
+                removed[position] = true;
+            } catch (invalid_argument&) {
+                if (strict) {
+                    throw;
+                }
+            }
+        }
+
+        // the showings that stay, then those added, by the positions of the ones that stay
+        vector<BookingRecord> records;
+        vector<ShowingId> ids;
+        records.reserve(showings + add.size());
+        ids.reserve(showings + add.size());
+        for (uint32_t position = 0; position < showings; ++position) {
+            if (!removed[position]) {
+                auto id = e.idAt(position);
+                auto rec = record(e, id);
+                records.push_back({e.catalog.movieOf(position), e.catalog.theaterOf(position), 0,
+                                   rec.seats(), rec.seatsPerRow(), e.catalog.startOf(position)});
+                ids.push_back(id);
+            }
+        }
+        const size_t kept = records.size();
+        ShowingId next_id = _first_showings + e.added.size();
+        for (auto& entry : add) {
+            bool there = false;
+            try {
+                auto position = e.catalog.showing(entry.movie, entry.theater, entry.start);
+                there = !removed[position];
+            } catch (invalid_argument&) {
+            }
+            if (there) {
+                if (strict) {
+                    throw invalid_argument("updateCatalog: showing exists already");
+                }
+                continue;
+            }
+            records.push_back({entry.movie, entry.theater, 0, entry.seats, entry.seats_per_row, entry.start});
+            ids.push_back(next_id++);
+        }
+        if (records.size() == showings && kept == showings) {
+            // nothing to change
+            return e.version;
+        }
+
+        // throws on duplicates and on showings without seats or too wide
+        vector<uint32_t> order;
+        auto next = make_shared<Edition>(buildSnapshot(records.begin(), records.end(), 0, &order), e.version + 1);
+        next->ids.resize(order.size());
+        next->positions.assign(next_id, Edition::GONE);
+        next->added = e.added;
+        next->added.resize(next_id - _first_showings, SeatBlock{nullptr, 0, 0});
+        vector<atomic<SeatSet::Word>*> blocks;
+        try {
+            for (uint32_t position = 0; position < order.size(); ++position) {
+                auto& rec = records[order[position]];
+                auto id = ids[order[position]];
+                next->ids[position] = id;
+                next->positions[id] = position;
+                if (order[position] >= kept) {
+                    auto words = SeatBlock::allocate(rec.seats);
+                    blocks.push_back(words);
+                    GuardedRecord(rec, words, &_changes);
+                    next->added[id - _first_showings] = {words, uint32_t(rec.seats), uint32_t(rec.seats_per_row)};
+                }
+            }
+            for (size_t position = 0; position < showings; ++position) {
+                if (removed[position] && e.idAt(position) >= _first_showings) {
+                    next->added[e.idAt(position) - _first_showings].words = nullptr;
+                }
+            }
+            if (strict && _log) {
+                _log->commit(loggedChange(e, removed, records, kept));
+            }
+        } catch (...) {
+            for (auto words : blocks) {
+                SeatBlock::free(words);
+            }
+            throw;
+        }
+
+        _edition.store(next.get(), memory_order_release);
+        auto previous = exchange(_current, next);
+        _changes.markChanged();
+        // wake up those waiting on a removed showing, then wait until nobody can be using it
+        for (size_t position = 0; position < showings; ++position) {
+            if (removed[position]) {
+                _changes.notify(seatsOf(*previous, previous->idAt(position)));
+            }
+        }
+        Rcu::synchronize();
+        for (size_t position = 0; position < showings; ++position) {
+            auto id = previous->idAt(position);
+            if (removed[position] && id >= _first_showings) {
+                previous->retired.push_back(previous->added[id - _first_showings].words);
+            }
+        }
+        // freed here, unless a NameList still has it
+        return next->version;
+    }
+
+    string loggedChange(const Edition& e, const vector<bool>& removed, const vector<BookingRecord>& records,
+                        size_t kept) const
+    {
+        string change = logTag(CATALOG_CHANGE);
+        for (uint32_t position = 0; position < removed.size(); ++position) {
+            if (removed[position]) {
+                putString(change, "-");
+                e.putShowing(change, position);
+            }
+        }
+        for (size_t i = kept; i < records.size(); ++i) {
+            putString(change, "+");
+            putShowing(change, records[i].movie_name, records[i].theater_name, records[i].start);
+            putString(change, to_string(records[i].seats));
+            putString(change, to_string(records[i].seats_per_row));
+        }
+        return change;
+    }
+
+    /**
+     * Call @a f with the record of @a showing, on the thread of its shard if the showings are
+     * sharded, and return what it returns.
+     */
+    template<typename F>
+    auto onShard(ShowingId showing, F f) -> decltype(f(declval<GuardedRecord>()))
+    {
+        auto call = [&] {
+            const Rcu::Reader reader;
+            return f(record(showing));
+        };
+        return _router ? _router->run(shardOf(showing), call) : call();
+    }
+
+    size_t shardOf(ShowingId showing) const
+    {
+        return showing < _first_showings ? showing / _showings_per_shard : showing % _router->shards();
+    }
+
+    /**
+     * The version and the seats of @a showing, which must be in @a e.
+     */
+    atomic<SeatSet::Word>* seatsOf(const Edition& e, ShowingId showing) const
+    {
+        if (showing >= _first_showings) {
+            return e.added[showing - _first_showings].words;
+        }
+        if (_shard_seats.empty()) {
+            return _seat_words + _seat_offsets[showing];
+        }
+        size_t shard = showing / _showings_per_shard;
+        return _shard_seats[shard].data() + (_seat_offsets[showing] - _seat_offsets[shard * _showings_per_shard]);
+    }
+
+    GuardedRecord record(const Edition& e, ShowingId showing) const
+    {
+        if (!e.has(showing)) {
+            throw invalid_argument("record: showing not found");
+        }
+        if (showing < _first_showings) {
+            return GuardedRecord(seatsOf(e, showing), _seat_counts[showing], _row_widths[showing], &_changes);
+        }
+        auto& block = e.added[showing - _first_showings];
+        return GuardedRecord(block.words, block.seats, block.seats_per_row, &_changes);
+    }
+
+    /**
+     * The record of @a showing in the current edition, to use within a Rcu::Reader.
+     */
+    GuardedRecord record(ShowingId showing) const
+    {
+        return record(edition(), showing);
+    }
+
+    GuardedRecord record(const string& movie, const string& theater) const
+    {
+        return record(edition().showing(movie, theater));
+    }
+
+    /**
+     * The names of @a e that @a index finds for @a query, in a list that keeps the ids along
+     * with the edition. The longer the query, the more typos it may have.
+     */
+    static NameList found(const Edition& e, const NameIndex& index, const string& query, size_t limit)
+    {
+        struct Found
+        {
+            shared_ptr<const void> edition;
+            vector<uint32_t> ids;
+        };
+        size_t max_edits = query.size() >= 8 ? 2 : query.size() >= 4 ? 1 : 0;
+        auto found = make_shared<Found>(Found{e.owner(), index.search(query, limit, max_edits)});
+        auto names = index.names();
+        return {names.first, names.second, found->ids.data(), found->ids.size(), found};
+    }
+
+    /**
+     * The showings at the positions @a range of @a e, listed with their starts and names.
+     */
+    static ShowtimeList showtimes(const Edition& e, pair<const uint32_t*, const uint32_t*> range)
+    {
+        vector<Showtime> showtimes;
+        showtimes.reserve(range.second - range.first);
+        for (auto it = range.first; it != range.second; ++it) {
+            showtimes.push_back({e.idAt(*it), e.catalog.startOf(*it), e.catalog.movieOf(*it), e.catalog.theaterOf(*it)});
+        }
+        return {move(showtimes), e.owner()};
+    }
+};
+
+static Service::Options options;
+
+void Service::configure(const Options& service_options)
+{
+    options = service_options;
+}
+
+/**
+ * @internal
+ * A service as @a options say, started from the snapshot if there is one, otherwise from the
+ * catalog file, or from the built-in catalog if there is no file either.
+ */
+static unique_ptr<ServiceImpl> createService(const Service::Options& options)
+{
+    unique_ptr<WriteAheadLog> log;
+    if (!options.log_path.empty()) {
+        log = make_unique<WriteAheadLog>(options.log_path, options.group_commit_window);
+    }
+    unique_ptr<ServiceImpl> service;
+    if (!options.snapshot_path.empty() && filesystem::exists(options.snapshot_path)) {
+        service = make_unique<ServiceImpl>(Snapshot::open(options.snapshot_path), move(log));
+    } else if (!options.catalog_path.empty()) {
+        CatalogFile catalog(options.catalog_path, options.load_threads);
+        service = make_unique<ServiceImpl>(catalog.records().begin(), catalog.records().end(), move(log),
+                                           options.load_threads);
+    } else {
+        service = make_unique<ServiceImpl>(begin(booking_table), end(booking_table), move(log));
+    }
+    service->shard(options.shards);
+    return service;
+}
+
+unique_ptr<Service> Service::create(const Options& options)
+{
+    return createService(options);
+}
+
+Service& Service::instance()
+{
+    static const unique_ptr<ServiceImpl> service = createService(options);
+    // start checkpointing once the service is up
+    static once_flag checkpointing;
+    call_once(checkpointing, [] {
+        if (!options.snapshot_path.empty()) {
+            service->checkpointEvery(options.snapshot_path, options.checkpoint_interval);
+        }
+    });
+    return *service;
 }
@@ -0,0 +1,243 @@
+/*
+ * Running work on the cores that own the data it touches
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * A thread per shard, pinned to a slice of the cores the process may run on, that runs whatever
+ * is routed to its shard. Data a shard's thread allocates and writes first is placed by the
+ * kernel on the memory of the shard's cores, and once only the shard's thread writes to it, its
+ * cache lines stay on those cores instead of moving to every core that writes to them.
+ *
+ * Callers hand work over through a lock-free queue per shard and spin until it is done; work
+ * routed from the shard's own thread runs right away. A shard's thread spins for a while when
+ * it runs out of work, then sleeps until more comes.
+ */
+class ShardRouter
+{
+    struct Task
+    {
+        std::atomic<Task*> next{nullptr};
+        void (*invoke)(void* context) = nullptr;
+        void* context = nullptr;
+        std::atomic<bool> done{false};
+    };
+
+    /**
+     * Vyukov's intrusive queue: many threads push, the shard's thread pops, and neither waits
+     * for the other.
+     */
+    struct alignas(CACHE_LINE_SIZE) Shard
+    {
+        std::atomic<Task*> head;
+        alignas(CACHE_LINE_SIZE) Task* tail;
+        Task stub;
+        // tasks pushed and not run yet, what the thread sleeps on
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> pending{0};
+        std::atomic<bool> sleeping{false};
+        std::mutex m;
+        std::condition_variable wake;
+        std::thread thread;
+
+        Shard() : head(&stub), tail(&stub) {}
+
+        void push(Task* task)
+        {
+            task->next.store(nullptr, std::memory_order_relaxed);
+            head.exchange(task, std::memory_order_acq_rel)->next.store(task, std::memory_order_release);
+        }
+
+        /**
+         * The oldest task, or null if there is none or a push is halfway.
+         */
+        Task* pop()
+        {
+            Task* task = tail;
+            Task* next = task->next.load(std::memory_order_acquire);
+            if (task == &stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                tail = task = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                tail = next;
+                return task;
+            }
+            if (task != head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            // the last task is only taken once another one follows it
+            push(&stub);
+            next = task->next.load(std::memory_order_acquire);
+            if (next) {
+                tail = next;
+                return task;
+            }
+            return nullptr;
+        }
+    };
+
+    // the router and the shard of the calling thread, if it is one of the shards' threads
+    inline static thread_local const ShardRouter* _router = nullptr;
+    inline static thread_local std::size_t _shard = 0;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<bool> _stopping{false};
+
+    void work(std::size_t shard)
+    {
+        static constexpr int SPINS = 1024;
+
+        parallel::pinThread(shard, _shards.size());
+        _router = this;
+        _shard = shard;
+        auto& s = *_shards[shard];
+        for (int idle = 0; !_stopping.load(std::memory_order_acquire); ) {
+            if (Task* task = s.pop()) {
+                task->invoke(task->context);
+                s.pending.fetch_sub(1, std::memory_order_relaxed);
+                // the task is gone once done is set, it lives on the caller's stack
+                task->done.store(true, std::memory_order_release);
+                idle = 0;
+            } else if (s.pending.load(std::memory_order_relaxed) != 0 || ++idle < SPINS) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lock(s.m);
+                s.sleeping.store(true, std::memory_order_seq_cst);
+                s.wake.wait(lock, [&] {
+                    return s.pending.load(std::memory_order_seq_cst) != 0 || _stopping.load(std::memory_order_acquire);
+                });
+                s.sleeping.store(false, std::memory_order_relaxed);
+                idle = 0;
+            }
+        }
+    }
+
+public:
+    /**
+     * Start a pinned thread for every one of @a shards shards.
+     */
+    explicit ShardRouter(std::size_t shards)
+    {
+        for (std::size_t shard = 0; shard < shards; ++shard) {
+            _shards.push_back(std::make_unique<Shard>());
+        }
+        for (std::size_t shard = 0; shard < shards; ++shard) {
+            _shards[shard]->thread = std::thread([this, shard] { work(shard); });
+        }
+    }
+
+    /**
+     * Stop the threads, once nothing is routed to them anymore.
+     */
+    ~ShardRouter()
+    {
+        _stopping.store(true, std::memory_order_release);
+        for (auto& shard : _shards) {
+            {
+                const std::lock_guard<std::mutex> lock(shard->m);
+            }
+            shard->wake.notify_one();
+            shard->thread.join();
+        }
+    }
+
+    ShardRouter(const ShardRouter&) = delete;
+    ShardRouter& operator=(const ShardRouter&) = delete;
+
+    std::size_t shards() const
+    {
+        return _shards.size();
+    }
+
+    /**
+     * Run @a f on the thread of @a shard and return what it returns, or throw what it throws.
+     */
+    template<typename F>
+    auto run(std::size_t shard, F&& f) -> decltype(f())
+    {
+        if (_router == this && _shard == shard) {
+            return f();
+        }
+
+        std::optional<decltype(f())> result;
+        std::exception_ptr error;
+        auto call = [&] {
+            try {
+                result.emplace(f());
+            } catch (...) {
+                error = std::current_exception();
+            }
+        };
+        Task task;
+        task.invoke = [](void* context) { (*static_cast<decltype(call)*>(context))(); };
+        task.context = &call;
+
+        auto& s = *_shards[shard];
+        s.push(&task);
+        s.pending.fetch_add(1, std::memory_order_seq_cst);
+        // pairs with the thread going to sleep: either it sees the task or this sees it asleep
+        if (s.sleeping.load(std::memory_order_seq_cst)) {
+            {
+                const std::lock_guard<std::mutex> lock(s.m);
+            }
+            s.wake.notify_one();
+        }
+        while (!task.done.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*result);
+    }
+
+    /**
+     * Run @a f(shard) on the thread of every shard at once, for it to set up the shard's data,
+     * and wait until all of them are done. The first exception is rethrown.
+     */
+    template<typename F>
+    void forEach(F&& f)
+    {
+        std::vector<std::exception_ptr> errors(_shards.size());
+        std::vector<std::thread> callers;
+        for (std::size_t shard = 0; shard < _shards.size(); ++shard) {
+            callers.emplace_back([&, shard] {
+                try {
+                    run(shard, [&] { f(shard); return true; });
+                } catch (...) {
+                    errors[shard] = std::current_exception();
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+};
+
+}   // namespace bb
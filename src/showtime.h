@@ -0,0 +1,93 @@
+/*
+ * The start times of showings, as they are written in catalogs and URLs
+ */
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * The days from 1970-01-01 to @a year-@a month-@a day of the proleptic Gregorian calendar.
+ */
+constexpr std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = unsigned(year - era * 400);
+    unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + std::int64_t(day_of_era) - 719468;
+}
+
+/**
+ * @internal
+ * Parse a start time, given either as seconds since the epoch, or as a date and a time of day
+ * in UTC like `2024-06-21T18:30`, with or without seconds, and with a space for the `T`.
+ * @throw std::invalid_argument if @a s is neither.
+ */
+inline StartTime parseStartTime(std::string_view s)
+{
+    auto number = [&](std::size_t at, std::size_t digits) {
+        unsigned n = 0;
+        auto [last, error] = std::from_chars(s.data() + at, s.data() + at + digits, n);
+        if (error != std::errc() || last != s.data() + at + digits) {
+            throw std::invalid_argument("parseStartTime: invalid time");
+        }
+        return n;
+    };
+
+    if (s.find_first_not_of("-0123456789") == std::string_view::npos) {
+        StartTime seconds;
+        auto [last, error] = std::from_chars(s.data(), s.data() + s.size(), seconds);
+        if (s.empty() || error != std::errc() || last != s.data() + s.size()) {
+            throw std::invalid_argument("parseStartTime: invalid time");
+        }
+        return seconds;
+    }
+    if ((s.size() != 16 && s.size() != 19) || s[4] != '-' || s[7] != '-' || (s[10] != 'T' && s[10] != ' ')
+        || s[13] != ':' || (s.size() == 19 && s[16] != ':')) {
+        throw std::invalid_argument("parseStartTime: not a time like 2024-06-21T18:30");
+    }
+    unsigned year = number(0, 4), month = number(5, 2), day = number(8, 2);
+    unsigned hour = number(11, 2), minute = number(14, 2), second = s.size() == 19 ? number(17, 2) : 0;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+        throw std::invalid_argument("parseStartTime: invalid time");
+    }
+    return daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/**
+ * @internal
+ * @a start as a date and a time of day in UTC, like `2024-06-21 18:30`.
+ */
+inline std::string formatStartTime(StartTime start)
+{
+    std::int64_t days = (start >= 0 ? start : start - 86399) / 86400;
+    std::int64_t seconds = start - days * 86400;
+    // the inverse of daysFromCivil()
+    days += 719468;
+    std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned day_of_era = unsigned(days - era * 146097);
+    unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    unsigned mp = (5 * day_of_year + 2) / 153;
+    unsigned day = day_of_year - (153 * mp + 2) / 5 + 1;
+    unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    std::int64_t year = std::int64_t(year_of_era) + era * 400 + (month <= 2);
+
+    char out[32];
+    std::snprintf(out, sizeof(out), "%04lld-%02u-%02u %02u:%02u", (long long)year, month, day,
+                  unsigned(seconds / 3600), unsigned(seconds % 3600 / 60));
+    return out;
+}
+
+}   // namespace bb
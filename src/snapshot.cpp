@@ -0,0 +1,214 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "file.h"
+#include "service.h"
+
+using namespace std;
+using namespace bb;
+
+static constexpr char MAGIC[8] = {'B', 'B', 'S', 'N', 'A', 'P', '\r', '\n'};
+
+static size_t alignUp(size_t n)
+{
+    return (n + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+Snapshot::Snapshot(const Sizes& sizes, bool seats)
+{
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.format = FORMAT;
+    header.sections = SECTIONS;
+    size_t offset = alignUp(sizeof(Header));
+    for (size_t s = 0; s < SECTIONS; ++s) {
+        header.section[s] = {offset, sizes[s]};
+        offset = alignUp(offset + sizes[s]);
+    }
+
+    // the seats come last
+    _size = seats ? offset : header.section[SEATS].offset;
+    _base = static_cast<char*>(::operator new(_size, align_val_t(CACHE_LINE_SIZE)));
+    memset(_base, 0, _size);
+    memcpy(_base, &header, sizeof(header));
+}
+
+Snapshot Snapshot::open(const string& path)
+{
+    Snapshot snapshot;
+#if defined(_WIN32)
+    // no mapping here, read the file into memory instead
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) {
+        throw system_error(errno, generic_category(), "Snapshot: cannot open " + path);
+    }
+    snapshot._size = in.tellg();
+    snapshot._base = static_cast<char*>(::operator new(snapshot._size, align_val_t(CACHE_LINE_SIZE)));
+    in.seekg(0).read(snapshot._base, snapshot._size);
+    if (!in) {
+        throw system_error(errno, generic_category(), "Snapshot: cannot read " + path);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "Snapshot: cannot open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw system_error(error, generic_category(), "Snapshot: cannot stat " + path);
+    }
+    if (st.st_size > 0) {
+        void* base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw system_error(error, generic_category(), "Snapshot: cannot map " + path);
+        }
+        snapshot._base = static_cast<char*>(base);
+        snapshot._size = st.st_size;
+        snapshot._mapped = true;
+    }
+    // the mapping stays valid without the file descriptor
+    ::close(fd);
+#endif
+
+    if (snapshot._size < sizeof(Header)) {
+        throw invalid_argument("Snapshot: not a snapshot");
+    }
+    const auto& header = snapshot.header();
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw invalid_argument("Snapshot: not a snapshot");
+    }
+    if (header.format != FORMAT || header.sections != SECTIONS) {
+        throw invalid_argument("Snapshot: unsupported format");
+    }
+    for (auto& section : header.section) {
+        if (section.offset % CACHE_LINE_SIZE || section.offset > snapshot._size
+            || section.size > snapshot._size - section.offset) {
+            throw invalid_argument("Snapshot: truncated");
+        }
+    }
+    return snapshot;
+}
+
+Snapshot::Snapshot(Snapshot&& other) noexcept
+    : _base(exchange(other._base, nullptr)), _size(exchange(other._size, 0)),
+      _mapped(exchange(other._mapped, false))
+{
+}
+
+Snapshot& Snapshot::operator=(Snapshot&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        _base = exchange(other._base, nullptr);
+        _size = exchange(other._size, 0);
+        _mapped = exchange(other._mapped, false);
+    }
+    return *this;
+}
+
+Snapshot::~Snapshot()
+{
+    release();
+}
+
+void Snapshot::release()
+{
+    if (!_base) {
+        return;
+    }
+#if !defined(_WIN32)
+    if (_mapped) {
+        munmap(_base, _size);
+        return;
+    }
+#endif
+    ::operator delete(_base, align_val_t(CACHE_LINE_SIZE));
+}
+
+void Snapshot::write(const string& path, uint64_t log_records, const SeatSource& seats,
+                     const function<void()>& written) const
+{
+    static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t), "seats are used as atomic words in place");
+
+    string temp = path + ".tmp";
+    int fd = file::open(temp.c_str(), false);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "write: cannot open " + temp);
+    }
+
+    Header header = this->header();
+    header.log_records = log_records;
+    // everything up to the seats never changes once the snapshot is built
+    size_t seats_offset = header.section[SEATS].offset;
+    int error = file::writeAll(fd, &header, sizeof(header));
+    if (!error) {
+        error = file::writeAll(fd, _base + sizeof(header), seats_offset - sizeof(header));
+    }
+
+    uint64_t chunk[4096];
+    size_t used = 0;
+    auto put = [&](const atomic<uint64_t>* words, size_t count) {
+        for (size_t i = 0; i < count && !error; ++i) {
+            chunk[used++] = words[i].load(memory_order_acquire);
+            if (used == size(chunk)) {
+                error = file::writeAll(fd, chunk, sizeof(chunk));
+                used = 0;
+            }
+        }
+    };
+    size_t total = header.section[SEATS].size / sizeof(uint64_t);
+    if (seats) {
+        // the words of every showing run up to where the next one's start
+        auto offsets = section<uint64_t>(SEAT_OFFSETS);
+        size_t showings = count<uint64_t>(SEAT_OFFSETS);
+        for (size_t i = 0; i < showings && !error; ++i) {
+            put(seats(i), (i + 1 < showings ? offsets[i + 1] : total) - offsets[i]);
+        }
+    } else {
+        put(reinterpret_cast<const atomic<uint64_t>*>(_base + seats_offset), total);
+    }
+    if (!error && used) {
+        error = file::writeAll(fd, chunk, used * sizeof(uint64_t));
+    }
+    if (!error && file::sync(fd) != 0) {
+        error = errno;
+    }
+    file::close(fd);
+    if (error) {
+        throw system_error(error, generic_category(), "write: cannot write " + temp);
+    }
+    if (written) {
+        try {
+            written();
+        } catch (...) {
+            error_code ignored;
+            filesystem::remove(temp, ignored);
+            throw;
+        }
+    }
+
+    error_code ec;
+    filesystem::rename(temp, path, ec);
+    if (ec) {
+        throw system_error(ec, "write: cannot replace " + path);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * A memory-mappable image of the catalog and the seats of all showings
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace bb {
+
+/**
+ * @internal
+ * The catalog and the seats of all showings in one block of memory, made of sections of plain
+ * integers and characters that refer to each other by index and offset, never by pointer. The
+ * block is laid out the same in memory and on disk, so opening a snapshot file maps it and uses
+ * it as is, with nothing to parse, copy or hash.
+ *
+ * A snapshot is read by the kind of machine that wrote it: integers are in host byte order.
+ * Every section starts on a cache line, so the seats can be used as atomic words in place; they
+ * are mapped copy-on-write, so bookings never write back to the file they were opened from.
+ */
+class Snapshot
+{
+public:
+    static constexpr std::uint32_t FORMAT = 3;
+
+    enum Section : std::uint32_t
+    {
+        NAME_POOL,          // char: all movie names, then all theater names
+        MOVIE_NAMES,        // uint64_t: offsets of the movie names in the pool, one past the last
+        THEATER_NAMES,      // uint64_t: offsets of the theater names in the pool, one past the last
+        MOVIE_SLOTS,        // uint32_t: open addressing hash table of movie id + 1, 0 if empty
+        THEATER_SLOTS,      // uint32_t: open addressing hash table of theater id + 1, 0 if empty
+        MOVIE_WORDS,        // uint64_t: the words of the movie names, see NameIndex
+        THEATER_WORDS,      // uint64_t: the words of the theater names, see NameIndex
+        MOVIE_SHOWINGS,     // uint32_t: the showings of movie m start at [m], one past the last
+        SHOWING_THEATERS,   // uint32_t: the theater of every showing
+        SHOWING_STARTS,     // int64_t: the start of every showing
+        MOVIE_TIMES,        // uint32_t: the showings of every movie, by start
+        MOVIE_ENTRIES,      // uint32_t: the theaters of movie m start at [m], one past the last
+        MOVIE_THEATERS,     // uint32_t: the theaters of every movie, sorted
+        THEATER_ENTRIES,    // uint32_t: the movies of theater t start at [t], one past the last
+        THEATER_MOVIES,     // uint32_t: the movies of every theater, sorted
+        THEATER_SHOWINGS,   // uint32_t: the showings of theater t start at [t], one past the last
+        THEATER_TIMES,      // uint32_t: the showings of every theater, by start
+        SEAT_OFFSETS,       // uint64_t: where the version and the seats of every showing start
+        SEAT_COUNTS,        // uint32_t: the number of seats of every showing
+        ROW_WIDTHS,         // uint32_t: the number of seats per row of every showing
+        SEATS,              // uint64_t: the versions and the booked seats of all showings
+        SECTIONS
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t format;
+        std::uint32_t sections;
+        // the booking log records already applied to the seats
+        std::uint64_t log_records;
+        struct
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+        } section[SECTIONS];
+    };
+
+    using Sizes = std::array<std::size_t, SECTIONS>;
+
+    Snapshot() = default;
+
+    /**
+     * Where the version and the seats of a showing are, by its index in the snapshot.
+     */
+    using SeatSource = std::function<const std::atomic<std::uint64_t>*(std::size_t showing)>;
+
+    /**
+     * A snapshot in memory with room for @a sizes bytes in each section, all zero. Without
+     * @a seats, there is no room for the SEATS section: the seats are kept elsewhere, and given
+     * to write().
+     */
+    explicit Snapshot(const Sizes& sizes, bool seats = true);
+
+    /**
+     * Map the snapshot file at @a path.
+     * @throw std::system_error if the file cannot be read.
+     * @throw std::invalid_argument if it is not a snapshot of this FORMAT.
+     */
+    static Snapshot open(const std::string& path);
+
+    Snapshot(Snapshot&& other) noexcept;
+    Snapshot& operator=(Snapshot&& other) noexcept;
+    ~Snapshot();
+
+    /**
+     * Write the snapshot to @a path, replacing the file only once it is completely on disk, and
+     * @a written, if given, has returned. The seats are read word by word with atomic loads, so
+     * bookings go on while it is written. They are read from @a seats if given, otherwise from
+     * the SEATS section.
+     * @throw std::system_error if the file cannot be written, or what @a written throws, in
+     *        which case the file is left as it was.
+     */
+    void write(const std::string& path, std::uint64_t log_records, const SeatSource& seats = nullptr,
+               const std::function<void()>& written = nullptr) const;
+
+    template<typename T>
+    T* section(Section s)
+    {
+        return reinterpret_cast<T*>(_base + header().section[s].offset);
+    }
+
+    template<typename T>
+    const T* section(Section s) const
+    {
+        return reinterpret_cast<const T*>(_base + header().section[s].offset);
+    }
+
+    template<typename T>
+    std::size_t count(Section s) const
+    {
+        return header().section[s].size / sizeof(T);
+    }
+
+    std::uint64_t logRecords() const
+    {
+        return header().log_records;
+    }
+
+private:
+    char* _base = nullptr;
+    std::size_t _size = 0;
+    bool _mapped = false;
+
+    const Header& header() const
+    {
+        return *reinterpret_cast<const Header*>(_base);
+    }
+
+    void release();
+};
+
+}   // namespace bb
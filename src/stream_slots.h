@@ -0,0 +1,78 @@
+/*
+ * The slots of the streams the server keeps open, so that they always leave it workers to spare
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace bb {
+
+/**
+ * @internal
+ * A count of the streams open, each of which keeps a server worker for as long as it is, up to a
+ * limit that leaves the rest of the workers to the other requests. A stream takes a slot before
+ * it starts, is refused if there is none left, and gives the slot back once the last copy of it
+ * is gone, however the stream ended.
+ */
+class StreamSlots
+{
+public:
+    class Slot
+    {
+        StreamSlots& _slots;
+
+    public:
+        explicit Slot(StreamSlots& slots) : _slots(slots) {}
+
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        ~Slot()
+        {
+            _slots._open.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    /**
+     * The most streams a server of @a workers keeps open: a quarter of the workers, and one at least.
+     */
+    static std::size_t forWorkers(std::size_t workers)
+    {
+        return std::max<std::size_t>(1, workers / 4);
+    }
+
+    explicit StreamSlots(std::size_t limit) : _limit(limit) {}
+
+    void setLimit(std::size_t limit)
+    {
+        _limit.store(limit, std::memory_order_relaxed);
+    }
+
+    /**
+     * A slot for a stream, or none if @a limit streams are open already.
+     */
+    std::shared_ptr<Slot> take()
+    {
+        auto open = _open.load(std::memory_order_relaxed);
+        do {
+            if (open >= _limit.load(std::memory_order_relaxed)) {
+                return nullptr;
+            }
+        } while (!_open.compare_exchange_weak(open, open + 1, std::memory_order_acquire));
+        return std::make_shared<Slot>(*this);
+    }
+
+    std::size_t open() const
+    {
+        return _open.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<std::size_t> _limit;
+    std::atomic<std::size_t> _open{0};
+};
+
+}   // namespace bb
@@ -0,0 +1,163 @@
+/*
+ * A hierarchical timer wheel, for deadlines that are set and cancelled far more often than met
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bb {
+
+/**
+ * @internal
+ * Timers by the tick they are due at, in four wheels of 64 slots: the first one has a slot per
+ * tick, the next one a slot per 64 ticks, and so on. A timer goes to the first wheel that
+ * reaches as far as it is due, in the slot of its tick, and when that wheel comes around to the
+ * slot, it moves down to the wheel that reaches as far as it is still due, so it is moved at
+ * most three times before it is due.
+ * Setting and cancelling a timer are O(1), and so is advancing by a tick, plus the timers that
+ * move or are due. Timers further away than the wheels reach, 2^24 ticks, wait in the last slot
+ * of the last wheel and are set again from there.
+ *
+ * A timer is a node the owner embeds in its own data, the wheel only links it in. It is not
+ * thread-safe.
+ */
+class TimerWheel
+{
+public:
+    struct Timer
+    {
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        std::uint64_t due = 0;
+
+        bool scheduled() const
+        {
+            return prev != nullptr;
+        }
+    };
+
+private:
+    static constexpr std::size_t SLOT_BITS = 6;
+    static constexpr std::size_t SLOTS = std::size_t{1} << SLOT_BITS;
+    static constexpr std::size_t WHEELS = 4;
+
+    // every slot is a circular list through a sentinel, so linking and unlinking never branch
+    Timer _slots[WHEELS][SLOTS];
+    std::uint64_t _now;
+    std::size_t _size = 0;
+
+    static void link(Timer& slot, Timer* timer)
+    {
+        timer->prev = slot.prev;
+        timer->next = &slot;
+        slot.prev->next = timer;
+        slot.prev = timer;
+    }
+
+    static void unlink(Timer* timer)
+    {
+        timer->prev->next = timer->next;
+        timer->next->prev = timer->prev;
+        timer->prev = timer->next = nullptr;
+    }
+
+    void place(Timer* timer)
+    {
+        std::uint64_t ticks = timer->due - _now;
+        std::size_t wheel = 0;
+        while (wheel + 1 < WHEELS && ticks >> (SLOT_BITS * (wheel + 1)) != 0) {
+            ++wheel;
+        }
+        std::size_t slot;
+        if (ticks >> (SLOT_BITS * WHEELS) != 0) {
+            // out of reach, in the slot that comes around last
+            slot = (_now >> (SLOT_BITS * wheel)) - 1;
+        } else {
+            slot = timer->due >> (SLOT_BITS * wheel);
+        }
+        link(_slots[wheel][slot & (SLOTS - 1)], timer);
+    }
+
+public:
+    explicit TimerWheel(std::uint64_t now = 0) : _now(now)
+    {
+        for (auto& wheel : _slots) {
+            for (auto& slot : wheel) {
+                slot.prev = slot.next = &slot;
+            }
+        }
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    std::uint64_t now() const
+    {
+        return _now;
+    }
+
+    /**
+     * The number of timers set.
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * Set @a timer, which must not be set already, to be due at tick @a due, or at the next one
+     * if that has passed.
+     */
+    void schedule(Timer* timer, std::uint64_t due)
+    {
+        timer->due = due > _now ? due : _now + 1;
+        place(timer);
+        ++_size;
+    }
+
+    /**
+     * Cancel @a timer, if it is set.
+     */
+    void cancel(Timer* timer)
+    {
+        if (timer->scheduled()) {
+            unlink(timer);
+            --_size;
+        }
+    }
+
+    /**
+     * Advance to tick @a to, and call @a expire with every timer due by then, in the order of
+     * their ticks. A timer is no longer set when @a expire gets it, which may set it again.
+     */
+    template<typename Expire>
+    void advance(std::uint64_t to, Expire&& expire)
+    {
+        while (_now < to) {
+            ++_now;
+            // the wheels that came around move the timers of their current slot down
+            std::size_t wheel = 1;
+            while (wheel < WHEELS && (_now & ((std::uint64_t{1} << (SLOT_BITS * wheel)) - 1)) == 0) {
+                ++wheel;
+            }
+            while (--wheel > 0) {
+                Timer& slot = _slots[wheel][(_now >> (SLOT_BITS * wheel)) & (SLOTS - 1)];
+                while (slot.next != &slot) {
+                    Timer* timer = slot.next;
+                    unlink(timer);
+                    place(timer);
+                }
+            }
+            Timer& slot = _slots[0][_now & (SLOTS - 1)];
+            while (slot.next != &slot) {
+                Timer* timer = slot.next;
+                unlink(timer);
+                --_size;
+                expire(timer);
+            }
+        }
+    }
+};
+
+}   // namespace bb
@@ -0,0 +1,248 @@
+#include "wal.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "file.h"
+
+using namespace std;
+using namespace bb;
+
+// a record is its payload after a header of the payload length and its CRC-32, in host byte order
+static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+// a compacted log starts with a mark of the records compacted away: a header of this length,
+// which no record has, and the CRC-32 of the count after it
+static constexpr uint32_t COMPACTED = UINT32_MAX;
+static constexpr size_t MARK_SIZE = HEADER_SIZE + sizeof(uint64_t);
+
+static uint32_t crc32(string_view data)
+{
+    static const auto table = [] {
+        array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    uint32_t crc = ~uint32_t{0};
+    for (unsigned char byte : data) {
+        crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, chrono::microseconds group_window)
+    : _path(path), _fd(file::open(path.c_str(), true)), _group_window(group_window)
+{
+    if (_fd < 0) {
+        throw system_error(errno, generic_category(), "WriteAheadLog: cannot open " + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    file::close(_fd);
+}
+
+size_t WriteAheadLog::replay(const function<void(string_view)>& apply, size_t skip)
+{
+    string data = file::readAll(_fd);
+
+    uint64_t compacted = 0;
+    size_t offset = 0;
+    if (data.size() >= MARK_SIZE) {
+        uint32_t size, crc;
+        memcpy(&size, data.data(), sizeof(size));
+        memcpy(&crc, data.data() + sizeof(size), sizeof(crc));
+        string_view count(data.data() + HEADER_SIZE, sizeof(compacted));
+        if (size == COMPACTED && crc32(count) == crc) {
+            memcpy(&compacted, count.data(), sizeof(compacted));
+            offset = MARK_SIZE;
+        }
+    }
+    if (skip < compacted) {
+        throw invalid_argument("replay: the log starts after record " + to_string(compacted) +
+                               ", not " + to_string(skip));
+    }
+
+    deque<uint64_t> ends;
+    size_t records = compacted;
+    while (data.size() - offset >= HEADER_SIZE) {
+        uint32_t size, crc;
+        memcpy(&size, data.data() + offset, sizeof(size));
+        memcpy(&crc, data.data() + offset + sizeof(size), sizeof(crc));
+        if (data.size() - offset - HEADER_SIZE < size) {
+            break;
+        }
+        string_view payload(data.data() + offset + HEADER_SIZE, size);
+        if (crc32(payload) != crc) {
+            break;
+        }
+        if (records >= skip) {
+            apply(payload);
+        }
+        ++records;
+        offset += HEADER_SIZE + size;
+        ends.push_back(offset);
+    }
+    if (offset != data.size() && file::truncate(_fd, offset) != 0) {
+        throw system_error(errno, generic_category(), "replay: cannot cut off the torn tail");
+    }
+    // the records appended next are numbered after the ones in the log
+    const lock_guard<mutex> lock(_m);
+    _appended = _durable = records;
+    _compacted = compacted;
+    _ends = move(ends);
+    return records;
+}
+
+WriteAheadLog::Lsn WriteAheadLog::append(string_view payload)
+{
+    uint32_t header[] = {uint32_t(payload.size()), crc32(payload)};
+    const lock_guard<mutex> lock(_m);
+    _pending.append(reinterpret_cast<const char*>(header), sizeof(header));
+    _pending.append(payload);
+    _ends.push_back((_ends.empty() ? _compacted ? MARK_SIZE : 0 : _ends.back()) + sizeof(header) + payload.size());
+    return ++_appended;
+}
+
+void WriteAheadLog::sync(Lsn lsn)
+{
+    unique_lock<mutex> lock(_m);
+    while (_durable < lsn && !_error) {
+        if (_syncing) {
+            _synced.wait(lock);
+            continue;
+        }
+
+        // lead this group: give concurrent bookings the window to join it, then write them all
+        _syncing = true;
+        if (_group_window.count() > 0) {
+            lock.unlock();
+            this_thread::sleep_for(_group_window);
+            lock.lock();
+        }
+        _writing.swap(_pending);
+        Lsn last = _appended;
+        lock.unlock();
+
+        int error = file::writeAll(_fd, _writing.data(), _writing.size());
+        if (!error && file::sync(_fd) != 0) {
+            error = errno;
+        }
+        _writing.clear();
+
+        lock.lock();
+        _syncing = false;
+        _error = error;
+        if (!error) {
+            _durable = last;
+            ++_syncs;
+        }
+        _synced.notify_all();
+    }
+    if (_durable < lsn) {
+        throw system_error(_error, generic_category(), "sync: cannot write the log");
+    }
+}
+
+void WriteAheadLog::compact(Lsn covered)
+{
+    unique_lock<mutex> lock(_m);
+    covered = min(covered, _durable);
+    if (covered <= _compacted) {
+        return;
+    }
+    // no group is written while the records after the covered ones are copied
+    _synced.wait(lock, [this] { return !_syncing; });
+    _syncing = true;
+    const uint64_t from = _ends[covered - _compacted - 1];
+    lock.unlock();
+
+    const string temp = _path + ".tmp";
+    int fd = -1;
+    int error = 0;
+    try {
+        // only the durable records are in the file, anything appended since waits in memory
+        if (file::seek(_fd, from) < 0) {
+            throw system_error(errno, generic_category(), "compact: cannot read " + _path);
+        }
+        string tail = file::readAll(_fd);
+        // opened to append, it goes on as the log once it takes the log's place
+        error_code ignored;
+        filesystem::remove(temp, ignored);
+        fd = file::open(temp.c_str(), true);
+        if (fd < 0) {
+            throw system_error(errno, generic_category(), "compact: cannot open " + temp);
+        }
+        uint64_t count = covered;
+        string_view count_bytes(reinterpret_cast<const char*>(&count), sizeof(count));
+        uint32_t header[] = {COMPACTED, crc32(count_bytes)};
+        error = file::writeAll(fd, header, sizeof(header));
+        if (!error) {
+            error = file::writeAll(fd, &count, sizeof(count));
+        }
+        if (!error) {
+            error = file::writeAll(fd, tail.data(), tail.size());
+        }
+        if (!error && file::sync(fd) != 0) {
+            error = errno;
+        }
+        if (error) {
+            throw system_error(error, generic_category(), "compact: cannot write " + temp);
+        }
+        error_code ec;
+        filesystem::rename(temp, _path, ec);
+        if (ec) {
+            throw system_error(ec, "compact: cannot replace " + _path);
+        }
+    } catch (...) {
+        if (fd >= 0) {
+            file::close(fd);
+        }
+        error_code ignored;
+        filesystem::remove(temp, ignored);
+        lock.lock();
+        _syncing = false;
+        _synced.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    file::close(_fd);
+    _fd = fd;
+    // the records left, and those appended meanwhile, now follow the mark
+    _ends.erase(_ends.begin(), _ends.begin() + (covered - _compacted));
+    for (auto& end : _ends) {
+        end = end - from + MARK_SIZE;
+    }
+    _compacted = covered;
+    _syncing = false;
+    _synced.notify_all();
+}
+
+WriteAheadLog::Lsn WriteAheadLog::durable() const
+{
+    const lock_guard<mutex> lock(_m);
+    return _durable;
+}
+
+WriteAheadLog::Lsn WriteAheadLog::appended() const
+{
+    const lock_guard<mutex> lock(_m);
+    return _appended;
+}
+
+uint64_t WriteAheadLog::syncs() const
+{
+    const lock_guard<mutex> lock(_m);
+    return _syncs;
+}
@@ -0,0 +1,121 @@
+/*
+ * An append-only log of bookings, written ahead of acknowledging them
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace bb {
+
+/**
+ * @internal
+ * An append-only file of records. append() only queues a record, which is durable once sync()
+ * for its sequence number returns. Concurrent callers of sync() share their fsyncs (group
+ * commit): the first one to arrive leads, waits for the group window to let more records queue
+ * up, then writes everything queued and syncs the file once for all of them, while the others
+ * wait for it.
+ *
+ * Every record is framed by its length and a CRC-32 of its payload, so a record torn by a crash
+ * is found on replay and cut off, along with whatever follows it.
+ *
+ * Once a snapshot holds the first records, they can be compacted away: the log is written anew
+ * with the records after them only, led by a mark of how many records came before.
+ *
+ * Once writing or syncing fails, nothing appended afterwards can be known to be durable, so
+ * every later sync() throws as well.
+ */
+class WriteAheadLog
+{
+public:
+    using Lsn = std::uint64_t;
+
+    /**
+     * Open the log at @a path, creating it if needed.
+     * @throw std::system_error if the file cannot be opened.
+     */
+    explicit WriteAheadLog(const std::string& path,
+                           std::chrono::microseconds group_window = std::chrono::microseconds(0));
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * Call @a apply with the payload of every intact record in order, except the first @a skip
+     * ones, and cut off a torn tail. Call it before the first append(), so that records are
+     * numbered from 1 across restarts.
+     * @return the number of intact records in the log, those compacted away included.
+     * @throw std::invalid_argument if records that are not to be skipped were compacted away.
+     */
+    std::size_t replay(const std::function<void(std::string_view)>& apply, std::size_t skip = 0);
+
+    /**
+     * Drop the first @a covered records, which must be on disk, by writing the log anew without
+     * them and putting it in place of the old one. Appending goes on meanwhile, while syncing
+     * waits for it. Records dropped already are not dropped again.
+     * @throw std::system_error if the new log cannot be written, in which case the old one is kept.
+     */
+    void compact(Lsn covered);
+
+    /**
+     * Queue a record.
+     * @return its sequence number, to pass to sync().
+     */
+    Lsn append(std::string_view payload);
+
+    /**
+     * Wait until the record @a lsn, and all records before it, are on disk.
+     * @throw std::system_error if they cannot be written.
+     */
+    void sync(Lsn lsn);
+
+    /**
+     * Append a record and wait until it is on disk.
+     */
+    void commit(std::string_view payload)
+    {
+        sync(append(payload));
+    }
+
+    /**
+     * The sequence number of the last record on disk.
+     */
+    Lsn durable() const;
+
+    /**
+     * The sequence number of the last record appended.
+     */
+    Lsn appended() const;
+
+    /**
+     * The number of times the file has been synced.
+     */
+    std::uint64_t syncs() const;
+
+private:
+    std::string _path;
+    int _fd;
+    std::chrono::microseconds _group_window;
+    mutable std::mutex _m;
+    std::condition_variable _synced;
+    // records appended but not written yet, and the batch being written by the leader
+    std::string _pending;
+    std::string _writing;
+    Lsn _appended = 0;
+    Lsn _durable = 0;
+    // the records compacted away, and where every record after them ends in the file
+    Lsn _compacted = 0;
+    std::deque<std::uint64_t> _ends;
+    bool _syncing = false;
+    int _error = 0;
+    std::uint64_t _syncs = 0;
+};
+
+}   // namespace bb
@@ -0,0 +1,188 @@
+/*
+ * A pool of worker threads that steal work from each other, to run the server's requests on
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "service.h"
+
+namespace bb {
+
+/**
+ * @internal
+ * Worker threads with a queue each. Tasks are dealt out to the queues in turn, so enqueueing
+ * contends with one worker at a time instead of with all of them on a single queue. A worker
+ * takes the oldest task of its own queue, and once that is empty, steals the newest of another
+ * one, which would otherwise wait behind all the others there. Workers sleep when there is
+ * nothing to take anywhere.
+ *
+ * The number of tasks waiting may be bounded, past which enqueue() turns tasks down; the server
+ * then closes the connection rather than let it wait for longer than a client would.
+ */
+class WorkerPool
+{
+    struct alignas(CACHE_LINE_SIZE) Worker
+    {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    const std::size_t _max_queued;
+    // the tasks enqueued and not taken yet, what the workers sleep on
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _queued{0};
+    std::atomic<std::size_t> _next{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _sleeping{0};
+    std::mutex _m;
+    std::condition_variable _wake;
+    std::atomic<bool> _stopping{false};
+
+    bool take(std::size_t worker, std::function<void()>& task)
+    {
+        {
+            auto& own = *_workers[worker];
+            const std::lock_guard<std::mutex> lock(own.m);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < _workers.size(); ++i) {
+            auto& other = *_workers[(worker + i) % _workers.size()];
+            const std::lock_guard<std::mutex> lock(other.m);
+            if (!other.tasks.empty()) {
+                task = std::move(other.tasks.back());
+                other.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t worker, bool pin)
+    {
+        if (pin) {
+            parallel::pinThread(worker, _workers.size());
+        }
+        for (;; ) {
+            std::function<void()> task;
+            if (take(worker, task)) {
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_m);
+            _sleeping.fetch_add(1, std::memory_order_seq_cst);
+            _wake.wait(lock, [&] { return _queued.load(std::memory_order_seq_cst) != 0 || _stopping; });
+            _sleeping.fetch_sub(1, std::memory_order_relaxed);
+            if (_stopping.load(std::memory_order_relaxed) && _queued.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    /**
+     * Start @a workers workers, pinned to their share of the cores if @a pin, that take at most
+     * @a max_queued tasks waiting, or any number if 0.
+     */
+    explicit WorkerPool(std::size_t workers, std::size_t max_queued = 0, bool pin = false)
+        : _max_queued(max_queued)
+    {
+        if (workers == 0) {
+            throw std::invalid_argument("WorkerPool: no workers");
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            _workers.push_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            _workers[i]->thread = std::thread([this, i, pin] { work(i, pin); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        shutdown();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    std::size_t workers() const
+    {
+        return _workers.size();
+    }
+
+    /**
+     * Queue @a task to be run by a worker, unless as many tasks as allowed are waiting already,
+     * or the pool is shut down.
+     */
+    bool enqueue(std::function<void()> task)
+    {
+        // counted before it is queued, so it is never taken before it is counted
+        auto queued = _queued.fetch_add(1, std::memory_order_seq_cst);
+        if (_max_queued != 0 && queued >= _max_queued) {
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto& worker = *_workers[_next.fetch_add(1, std::memory_order_relaxed) % _workers.size()];
+        {
+            const std::lock_guard<std::mutex> lock(worker.m);
+            if (_stopping.load(std::memory_order_relaxed)) {
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            worker.tasks.push_back(std::move(task));
+        }
+        // pairs with a worker going to sleep: either it sees the task or this sees it asleep
+        if (_sleeping.load(std::memory_order_seq_cst) != 0) {
+            {
+                const std::lock_guard<std::mutex> lock(_m);
+            }
+            _wake.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * Run the tasks still queued, then stop the workers. Tasks enqueued from now on are turned
+     * down.
+     */
+    void shutdown()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(_m);
+            if (_stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            _stopping.store(true, std::memory_order_relaxed);
+        }
+        _wake.notify_all();
+        for (auto& worker : _workers) {
+            worker->thread.join();
+        }
+        // a task enqueued while the workers stopped is run here
+        for (auto& worker : _workers) {
+            for (auto& task : worker->tasks) {
+                task();
+            }
+            worker->tasks.clear();
+        }
+    }
+};
+
+}   // namespace bb
@@ -0,0 +1,108 @@
+// Test assets.h
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <brotli/decode.h>
+#include <zlib.h>
+
+#include "../src/assets.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    string gunzip(const string& data) {
+        z_stream stream{};
+        EXPECT_EQ(inflateInit2(&stream, 15 + 16), Z_OK);
+        string out(1 << 16, '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = data.size();
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = out.size();
+        EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+        out.resize(stream.total_out);
+        inflateEnd(&stream);
+        return out;
+    }
+
+    string unbrotli(const string& data) {
+        string out(1 << 16, '\0');
+        size_t size = out.size();
+        EXPECT_EQ(BrotliDecoderDecompress(data.size(), reinterpret_cast<const uint8_t*>(data.data()), &size,
+                                          reinterpret_cast<uint8_t*>(out.data())), BROTLI_DECODER_RESULT_SUCCESS);
+        out.resize(size);
+        return out;
+    }
+
+    string content() {
+        string css;
+        for (int i = 0; i < 100; ++i) {
+            css += ".seat-" + to_string(i) + " { margin: 2px; background-color: #ffcc00; }\n";
+        }
+        return css;
+    }
+
+    TEST(AssetsTest, compressesRoundTrip) {
+        auto css = content();
+        auto gzip = gzipCompress(css);
+        auto brotli = brotliCompress(css);
+        EXPECT_LT(gzip.size(), css.size());
+        EXPECT_LT(brotli.size(), css.size());
+        EXPECT_EQ(gunzip(gzip), css);
+        EXPECT_EQ(unbrotli(brotli), css);
+        EXPECT_EQ(gunzip(gzipCompress("")), "");
+    }
+
+    TEST(AssetsTest, pathHasContentHash) {
+        StaticAsset a("bb", "css", "text/css", content());
+        StaticAsset same("bb", "css", "text/css", content());
+        StaticAsset other("bb", "css", "text/css", content() + "body { margin: 0px; }\n");
+        EXPECT_EQ(a.path().rfind("/static/bb.", 0), 0u);
+        EXPECT_EQ(a.path().size(), string("/static/bb.12345678.css").size());
+        EXPECT_EQ(a.path().substr(a.path().size() - 4), ".css");
+        EXPECT_EQ(a.path(), same.path());
+        EXPECT_NE(a.path(), other.path());
+        EXPECT_EQ(a.contentType(), "text/css");
+    }
+
+    TEST(AssetsTest, acceptsEncoding) {
+        EXPECT_TRUE(acceptsEncoding("gzip, deflate, br", "br"));
+        EXPECT_TRUE(acceptsEncoding("gzip, deflate, br", "gzip"));
+        EXPECT_TRUE(acceptsEncoding("GZIP", "gzip"));
+        EXPECT_TRUE(acceptsEncoding("br;q=0.5", "br"));
+        EXPECT_FALSE(acceptsEncoding("br;q=0, gzip", "br"));
+        EXPECT_FALSE(acceptsEncoding("br ; q=0.000", "br"));
+        EXPECT_FALSE(acceptsEncoding("deflate", "gzip"));
+        EXPECT_FALSE(acceptsEncoding("", "gzip"));
+        EXPECT_TRUE(acceptsEncoding("*", "br"));
+        EXPECT_FALSE(acceptsEncoding("*;q=0", "br"));
+        EXPECT_FALSE(acceptsEncoding("*, br;q=0", "br"));
+        EXPECT_TRUE(acceptsEncoding("gzip;q=1, *;q=0", "gzip"));
+    }
+
+    TEST(AssetsTest, negotiates) {
+        auto css = content();
+        StaticAsset asset("bb", "css", "text/css", css);
+
+        auto br = asset.encodedFor("gzip, deflate, br");
+        EXPECT_EQ(br.encoding, "br");
+        EXPECT_EQ(unbrotli(br.body), css);
+
+        auto gzip = asset.encodedFor("gzip, br;q=0");
+        EXPECT_EQ(gzip.encoding, "gzip");
+        EXPECT_EQ(gunzip(gzip.body), css);
+
+        auto identity = asset.encodedFor("");
+        EXPECT_EQ(identity.encoding, "");
+        EXPECT_EQ(identity.body, css);
+    }
+
+    TEST(AssetsTest, keepsWhatDoesNotShrink) {
+        // too short to be smaller compressed
+        StaticAsset asset("bb", "js", "text/javascript", "x");
+        auto encoded = asset.encodedFor("br, gzip");
+        EXPECT_EQ(encoded.encoding, "");
+        EXPECT_EQ(encoded.body, "x");
+    }
+}
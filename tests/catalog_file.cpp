@@ -0,0 +1,138 @@
+// Test CatalogFile
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/catalog_file.cpp"
+
+namespace {
+
+class CatalogFileTest : public ::testing::Test
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_catalog_test.csv").string();
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+
+    void write(const string& text)
+    {
+        ofstream(path, ios::binary) << text;
+    }
+};
+
+TEST_F(CatalogFileTest, csv) {
+    write("movie,theater,seats,seats_per_row\r\n"
+          "\"Garfield Movie, The\",Landmark Cinemas,480,24\r\n"
+          "\n"
+          "Back to Black,Galaxy Cinemas\n"
+          "\"Say \"\"Cheese\"\"\",Cinema Paradiso,100");
+    CatalogFile catalog(path);
+    auto& records = catalog.records();
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records[0].movie_name, "Garfield Movie, The");
+    EXPECT_EQ(records[0].theater_name, "Landmark Cinemas");
+    EXPECT_EQ(records[0].seats, 480);
+    EXPECT_EQ(records[0].seats_per_row, 24);
+    EXPECT_EQ(records[1].movie_name, "Back to Black");
+    EXPECT_EQ(records[1].seats, MAX_SEATS);
+    EXPECT_EQ(records[1].seats_per_row, SEATS_PER_ROW);
+    EXPECT_EQ(records[2].movie_name, "Say \"Cheese\"");
+    EXPECT_EQ(records[2].seats, 100);
+    EXPECT_EQ(records[2].booked_mask, NO_SEATS);
+}
+
+TEST_F(CatalogFileTest, jsonLines) {
+    write("{\"movie\": \"Garfield Movie, The\", \"theater\": \"Landmark Cinemas\", \"seats\": 480, \"seats_per_row\": 24}\n"
+          "  {\"theater\":\"Caf\\u00e9 \\\"Ciné\\\"\",\"movie\":\"Back to Black\",\"rating\":\"PG\",\"new\":true}\n"
+          "{\"movie\": \"\\ud83c\\udfac\", \"theater\": \"Galaxy Cinemas\"}\n");
+    CatalogFile catalog(path);
+    auto& records = catalog.records();
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records[0].movie_name, "Garfield Movie, The");
+    EXPECT_EQ(records[0].seats, 480);
+    EXPECT_EQ(records[0].seats_per_row, 24);
+    EXPECT_EQ(records[1].movie_name, "Back to Black");
+    EXPECT_EQ(records[1].theater_name, "Café \"Ciné\"");
+    EXPECT_EQ(records[1].seats, MAX_SEATS);
+    EXPECT_EQ(records[2].movie_name, "\xf0\x9f\x8e\xac");
+}
+
+TEST_F(CatalogFileTest, startTimes) {
+    write("movie,theater,seats,seats_per_row,start\n"
+          "Back to Black,Galaxy Cinemas,100,10,2024-06-21T18:30\n"
+          "Back to Black,Galaxy Cinemas,100,10,1718994600\n"
+          "Back to Black,Landmark Cinemas\n");
+    CatalogFile csv(path);
+    ASSERT_EQ(csv.records().size(), 3);
+    EXPECT_EQ(csv.records()[0].start, 1718994600);
+    EXPECT_EQ(csv.records()[1].start, 1718994600);
+    EXPECT_EQ(csv.records()[2].start, 0);
+
+    write("{\"movie\": \"Back to Black\", \"theater\": \"Cinema Paradiso\", \"start\": \"2024-06-21 21:15:30\"}\n"
+          "{\"movie\": \"Back to Black\", \"theater\": \"Cinema Paradiso\", \"start\": 1718994600}\n");
+    CatalogFile json(path);
+    ASSERT_EQ(json.records().size(), 2);
+    EXPECT_EQ(json.records()[0].start, 1718994600 + 2 * 3600 + 45 * 60 + 30);
+    EXPECT_EQ(json.records()[1].start, 1718994600);
+}
+
+TEST(StartTimeTest, parseAndFormat) {
+    EXPECT_EQ(parseStartTime("0"), 0);
+    EXPECT_EQ(parseStartTime("-60"), -60);
+    EXPECT_EQ(parseStartTime("1970-01-01T00:00"), 0);
+    EXPECT_EQ(parseStartTime("2000-03-01T00:00:01"), 951868801);
+    EXPECT_EQ(parseStartTime("1969-12-31 23:59"), -60);
+    EXPECT_EQ(formatStartTime(0), "1970-01-01 00:00");
+    EXPECT_EQ(formatStartTime(951868801), "2000-03-01 00:00");
+    EXPECT_EQ(formatStartTime(-60), "1969-12-31 23:59");
+    EXPECT_EQ(formatStartTime(parseStartTime("2024-02-29T18:30")), "2024-02-29 18:30");
+    for (auto s : {"", "-", "12a", "2024-06-21", "2024-06-21T18", "2024-06-21X18:30", "2024-00-21T18:30",
+                   "2024-06-21T24:00", "2024-06-21T18:3x"}) {
+        EXPECT_THROW(parseStartTime(s), invalid_argument) << s;
+    }
+}
+
+TEST_F(CatalogFileTest, invalidLine) {
+    for (auto text : {"MA,TA\nMB\n", "MA,TA\nMB,TB,many\n", "MA,TA\nMB,TB,1,1,1,1\n", "MA,TA\n\"MB,TB\n",
+                      "MA,TA\n,TB\n", "{\"movie\": \"MA\", \"theater\": \"TA\"}\n{\"movie\": \"MB\"}\n",
+                      "{\"movie\": \"MA\", \"theater\": \"TA\"}\n{\"movie\": \"MB\", \"theater\": {}}\n",
+                      "MA,TA\nMB,TB,1,1,tomorrow\n", "MA,TA\nMB,TB,1,1,2024-13-01T18:30\n"}) {
+        write(text);
+        try {
+            CatalogFile catalog(path);
+            FAIL() << text;
+        } catch (invalid_argument& e) {
+            EXPECT_EQ(string(e.what()).rfind("CatalogFile: line 2: ", 0), 0) << e.what();
+        }
+    }
+}
+
+TEST_F(CatalogFileTest, parallel) {
+    // enough lines for every thread to take a part of them
+    string text;
+    for (int i = 0; i < 200000; ++i) {
+        text += "\"Movie " + to_string(i % 1000) + "\",Theater " + to_string(i) + "," + to_string(i % 500 + 1) + "\n";
+    }
+    write(text);
+    CatalogFile one(path, 1);
+    CatalogFile many(path, 8);
+    ASSERT_EQ(one.records().size(), 200000);
+    ASSERT_EQ(many.records().size(), 200000);
+    for (size_t i = 0; i < one.records().size(); ++i) {
+        EXPECT_EQ(many.records()[i].movie_name, one.records()[i].movie_name);
+        EXPECT_EQ(many.records()[i].theater_name, "Theater " + to_string(i));
+        EXPECT_EQ(many.records()[i].seats, i % 500 + 1);
+    }
+}
+
+TEST_F(CatalogFileTest, cannotOpen) {
+    EXPECT_THROW(CatalogFile((filesystem::temp_directory_path() / "bb_no_such_dir" / "catalog.csv").string()),
+                 system_error);
+}
+
+}   // namespace
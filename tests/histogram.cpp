@@ -0,0 +1,56 @@
+// Test histogram.h
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "../src/histogram.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(HistogramTest, smallValuesExact) {
+        Histogram h;
+        EXPECT_EQ(h.percentile(50), 0);
+        for (uint64_t v = 1; v <= 100; ++v) {
+            h.record(v);
+        }
+        EXPECT_EQ(h.count(), 100);
+        EXPECT_EQ(h.max(), 100);
+        EXPECT_EQ(h.percentile(50), 50);
+        EXPECT_EQ(h.percentile(99), 99);
+        EXPECT_EQ(h.percentile(100), 100);
+        EXPECT_EQ(h.percentile(0), 1);
+    }
+
+    TEST(HistogramTest, largeValuesWithinPrecision) {
+        Histogram h;
+        for (uint64_t v : {1000ull, 123456ull, 98765432ull, ~0ull}) {
+            Histogram one;
+            one.record(v);
+            // the bucket's highest value, which is never off by more than 1/128
+            EXPECT_GE(one.percentile(50), v - v / 128);
+            EXPECT_LE(one.percentile(50), v);
+            h.record(v);
+        }
+        EXPECT_EQ(h.percentile(100), ~0ull);
+        EXPECT_GE(h.percentile(50), 123456 - 123456 / 128);
+        EXPECT_LE(h.percentile(50), 123456 + 123456 / 128);
+    }
+
+    TEST(HistogramTest, tail) {
+        // one slow value in a thousand is the 99.9th percentile, not the 99th
+        Histogram h;
+        for (int i = 0; i < 999; ++i) {
+            h.record(200);
+        }
+        Histogram slow;
+        slow.record(50000);
+        h.merge(slow);
+        EXPECT_EQ(h.count(), 1000);
+        EXPECT_EQ(h.percentile(99), 200);
+        EXPECT_EQ(h.percentile(99.9), 200);
+        EXPECT_GE(h.percentile(99.95), 50000 - 50000 / 128);
+        EXPECT_EQ(h.max(), 50000);
+    }
+}
@@ -1,5 +1,6 @@
 // Test html.h
 #include <iostream>
+#include <sstream>
 
 #include <gtest/gtest.h>
 
@@ -19,4 +20,51 @@ namespace {
         out << html::echo("hello, ", "world!");
         EXPECT_EQ(out.str(), "hello, world!");
     }
+    TEST(HTMLTest, echo_values) {
+        html::Buffer out;
+        string name = "world";
+        out << html::echo("hello, ", name, '!', ' ', 42, ' ', size_t{7}, ' ', string_view("view"));
+        EXPECT_EQ(out.str(), "hello, world! 42 7 view");
+    }
+    TEST(HTMLTest, tag) {
+        html::Buffer out;
+        out << html::tag("h1", "title") << html::tag("span", html::attr("class", "x"), 1);
+        EXPECT_EQ(out.str(), "<h1>title</h1><span class=\"x\">1</span>");
+    }
+    TEST(HTMLTest, li) {
+        html::Buffer out;
+        string movie = "Back to Black";
+        out << html::li(false, html::a(html::echo("/movie?name=", movie), movie))
+            << html::li(true, html::a(html::echo("/movie?name=", movie), movie));
+        EXPECT_EQ(out.str(),
+            "<li><a href=\"/movie?name=Back to Black\">Back to Black</a></li>"
+            "<li class=\"selected\"><a href=\"/movie?name=Back to Black\">Back to Black</a></li>");
+    }
+    TEST(HTMLTest, nested) {
+        ostringstream stream;
+        html::Buffer buffer;
+        auto render = [](auto& out, const string& movie) {
+            out << html::tag("h1", html::echo("Theaters that are showing ", html::tag("span", movie), ':'));
+        };
+        render(stream, "Furiosa");
+        render(buffer, "Furiosa");
+        EXPECT_EQ(buffer.str(), "<h1>Theaters that are showing <span>Furiosa</span>:</h1>");
+        // a buffer renders exactly what an ostream does
+        EXPECT_EQ(buffer.str(), stream.str());
+    }
+    TEST(HTMLTest, lvalueStringsNotCopied) {
+        string movie = "Garfield Movie, The";
+        auto echo = html::echo(movie, string("copied"));
+        static_assert(is_same_v<decltype(echo), html::Echo<string_view, string>>);
+        EXPECT_EQ(get<0>(echo.parts).data(), movie.data());
+    }
+    TEST(HTMLTest, bufferReuse) {
+        html::Buffer out;
+        out << html::tag("p", "first page");
+        auto capacity = out.str().capacity();
+        out.clear();
+        out << html::tag("p", "page 2");
+        EXPECT_EQ(out.str(), "<p>page 2</p>");
+        EXPECT_EQ(out.str().capacity(), capacity);
+    }
 }
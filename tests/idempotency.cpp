@@ -0,0 +1,112 @@
+// Test idempotency.h
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/idempotency.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    using Clock = IdempotencyCache::Clock;
+
+    TEST(IdempotencyCacheTest, replayFinished) {
+        IdempotencyCache cache(100, chrono::hours(1));
+        IdempotencyCache::Response response;
+        EXPECT_EQ(cache.claim("k1", "/book?seats=1-2", response), IdempotencyCache::CLAIMED);
+        // a retry before the first request is answered
+        EXPECT_EQ(cache.claim("k1", "/book?seats=1-2", response), IdempotencyCache::IN_PROGRESS);
+        cache.finish("k1", {409, "application/json", "{\"error\":\"SeatAlreadyBooked\"}"});
+        EXPECT_EQ(cache.claim("k1", "/book?seats=1-2", response), IdempotencyCache::DONE);
+        EXPECT_EQ(response.status, 409);
+        EXPECT_EQ(response.content_type, "application/json");
+        EXPECT_EQ(response.body, "{\"error\":\"SeatAlreadyBooked\"}");
+        // the key goes with its request, other keys with theirs
+        EXPECT_EQ(cache.claim("k1", "/book?seats=3", response), IdempotencyCache::MISMATCH);
+        EXPECT_EQ(cache.claim("k2", "/book?seats=3", response), IdempotencyCache::CLAIMED);
+        EXPECT_EQ(cache.size(), 2);
+    }
+
+    TEST(IdempotencyCacheTest, release) {
+        IdempotencyCache cache(100, chrono::hours(1));
+        IdempotencyCache::Response response;
+        auto now = Clock::now();
+        EXPECT_EQ(cache.claim("k1", "a", response, now), IdempotencyCache::CLAIMED);
+        cache.release("k1");
+        EXPECT_EQ(cache.size(), 0);
+        // claimed again, for as long as if it were new
+        EXPECT_EQ(cache.claim("k1", "b", response, now + chrono::minutes(30)), IdempotencyCache::CLAIMED);
+        EXPECT_EQ(cache.claim("k1", "b", response, now + chrono::minutes(61)), IdempotencyCache::IN_PROGRESS);
+        // a finished request is not released
+        cache.finish("k1", {200, "", ""});
+        cache.release("k1");
+        EXPECT_EQ(cache.claim("k1", "b", response, now + chrono::minutes(62)), IdempotencyCache::DONE);
+        EXPECT_EQ(cache.claim("k1", "b", response, now + chrono::minutes(90)), IdempotencyCache::CLAIMED);
+    }
+
+    TEST(IdempotencyCacheTest, expire) {
+        IdempotencyCache cache(100, chrono::minutes(10));
+        IdempotencyCache::Response response;
+        auto now = Clock::now();
+        cache.claim("k1", "a", response, now);
+        cache.finish("k1", {200, "", ""});
+        EXPECT_EQ(cache.claim("k1", "a", response, now + chrono::minutes(9)), IdempotencyCache::DONE);
+        // a key is forgotten once it was kept for the ttl
+        EXPECT_EQ(cache.claim("k1", "b", response, now + chrono::minutes(10)), IdempotencyCache::CLAIMED);
+        // and so does a key whose request never finished
+        cache.claim("k2", "a", response, now);
+        EXPECT_EQ(cache.claim("k2", "a", response, now + chrono::minutes(9)), IdempotencyCache::IN_PROGRESS);
+        EXPECT_EQ(cache.claim("k2", "a", response, now + chrono::minutes(10)), IdempotencyCache::CLAIMED);
+    }
+
+    TEST(IdempotencyCacheTest, bounded) {
+        // 16 shards of 2 keys
+        IdempotencyCache cache(32, chrono::hours(1));
+        IdempotencyCache::Response response;
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_EQ(cache.claim(to_string(i), "a", response), IdempotencyCache::CLAIMED);
+        }
+        EXPECT_LE(cache.size(), 32);
+        EXPECT_EQ(cache.claim("999", "a", response), IdempotencyCache::IN_PROGRESS);
+        EXPECT_EQ(cache.claim("0", "a", response), IdempotencyCache::CLAIMED);
+    }
+
+    TEST(IdempotencyCacheTest, concurrent) {
+        IdempotencyCache cache(1 << 12, chrono::hours(1));
+        atomic<int> claimed{0};
+        atomic<int> replayed{0};
+        vector<thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&]{
+                IdempotencyCache::Response response;
+                for (int j = 0; j < 1000; ++j) {
+                    auto key = to_string(j);
+                    switch (cache.claim(key, "a", response)) {
+                    case IdempotencyCache::CLAIMED:
+                        ++claimed;
+                        cache.finish(key, {200, "text/plain", key});
+                        break;
+                    case IdempotencyCache::DONE:
+                        EXPECT_EQ(response.body, key);
+                        ++replayed;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        // every key was claimed once
+        EXPECT_EQ(claimed, 1000);
+        EXPECT_EQ(cache.size(), 1000);
+        EXPECT_GT(replayed, 0);
+    }
+}
@@ -0,0 +1,52 @@
+// Test json.h
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/json.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(JsonTest, nested) {
+        string out;
+        json::Writer json(out);
+        json.beginObject()
+            .member("movie", "Back to Black")
+            .member("seats", 480)
+            .member("free", true)
+            .key("rows").beginArray().beginArray().endArray().beginObject().endObject().value(-1).null().endArray()
+            .key("empty").beginObject().endObject()
+            .endObject();
+        EXPECT_EQ(out, R"({"movie":"Back to Black","seats":480,"free":true,"rows":[[],{},-1,null],"empty":{}})");
+    }
+
+    TEST(JsonTest, escapes) {
+        string out;
+        json::Writer(out).value(string("\"Quoted\" \\ tab\t line\n bell\x07 \xc3\xa9t\xc3\xa9"));
+        EXPECT_EQ(out, "\"\\\"Quoted\\\" \\\\ tab\\t line\\n bell\\u0007 \xc3\xa9t\xc3\xa9\"");
+        out.clear();
+        json::Writer(out).beginObject().member("a\"b", string_view("\0", 1)).endObject();
+        EXPECT_EQ(out, "{\"a\\\"b\":\"\\u0000\"}");
+    }
+
+    TEST(JsonTest, appendsWithoutAllocating) {
+        string out;
+        out.reserve(256);
+        auto data = out.data();
+        for (int i = 0; i < 10; ++i) {
+            out.clear();
+            json::Writer json(out);
+            json.beginArray();
+            for (uint64_t n : {uint64_t{0}, ~uint64_t{0}}) {
+                json.value(n);
+            }
+            json.endArray();
+        }
+        EXPECT_EQ(out, "[0,18446744073709551615]");
+        EXPECT_EQ(out.data(), data);
+    }
+}
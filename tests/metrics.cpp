@@ -0,0 +1,69 @@
+// Test metrics.h
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/metrics.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(MetricsTest, buckets) {
+        EXPECT_EQ(Metrics::bound(0), 1);
+        EXPECT_EQ(Metrics::bound(2), 3);
+        EXPECT_EQ(Metrics::bound(5), 8);
+        EXPECT_EQ(Metrics::bound(Metrics::BUCKETS - 2), 1 << 24);
+        // every latency goes to the first bucket it is at most the bound of
+        for (uint64_t us = 0; us <= (1 << 12); ++us) {
+            auto i = Metrics::bucketOf(us);
+            EXPECT_LE(us, Metrics::bound(i));
+            EXPECT_TRUE(i == 0 || us > Metrics::bound(i - 1));
+        }
+        EXPECT_EQ(Metrics::bucketOf(uint64_t{1} << 24), Metrics::BUCKETS - 2);
+        EXPECT_EQ(Metrics::bucketOf((uint64_t{1} << 24) + 1), Metrics::BUCKETS - 1);
+        EXPECT_EQ(Metrics::bucketOf(~uint64_t{0}), Metrics::BUCKETS - 1);
+    }
+
+    TEST(MetricsTest, summedOverThreads) {
+        // other tests count as well, so only the differences tell
+        auto before = Metrics::sums();
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 1000; ++i) {
+                    Metrics::booking(100000 + i % 10, i % 4 != 0);
+                    Metrics::latency(Metrics::POST_BOOK, 5);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto after = Metrics::sums();
+        EXPECT_EQ(after.booked - before.booked, 3000);
+        EXPECT_EQ(after.conflicts - before.conflicts, 1000);
+        auto& latency = after.latencies[Metrics::POST_BOOK];
+        auto& earlier = before.latencies[Metrics::POST_BOOK];
+        EXPECT_EQ(latency.count - earlier.count, 4000);
+        EXPECT_EQ(latency.sum_us - earlier.sum_us, 20000);
+        EXPECT_EQ(latency.buckets[Metrics::bucketOf(5)] - earlier.buckets[Metrics::bucketOf(5)], 4000);
+    }
+
+    TEST(MetricsTest, hotShowings) {
+        thread([] {
+            // one showing booked far more than the many others
+            for (ShowingId i = 0; i < 100000; ++i) {
+                Metrics::booking(200000 + i % 5000, true);
+                Metrics::booking(999999, false);
+            }
+        }).join();
+        auto sums = Metrics::sums(3);
+        ASSERT_EQ(sums.hot.size(), 3);
+        EXPECT_EQ(sums.hot[0].first, 999999);
+        EXPECT_GE(sums.hot[0].second, 50000);
+        EXPECT_GE(sums.hot[0].second, sums.hot[1].second);
+    }
+}
@@ -0,0 +1,77 @@
+// Test page_cache.h
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/page_cache.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(PageCacheTest, findByETag) {
+        PageCache cache;
+        EXPECT_EQ(cache.find("/movie?", "\"1\""), nullptr);
+        cache.store("/movie?", "\"1\"", make_shared<const string>("page 1"));
+        ASSERT_NE(cache.find("/movie?", "\"1\""), nullptr);
+        EXPECT_EQ(*cache.find("/movie?", "\"1\""), "page 1");
+        // a newer version of the same page misses until it is rendered again
+        EXPECT_EQ(cache.find("/movie?", "\"2\""), nullptr);
+        EXPECT_EQ(cache.find("/theater?", "\"1\""), nullptr);
+    }
+
+    TEST(PageCacheTest, storeReplaces) {
+        PageCache cache;
+        cache.store("/movie?", "\"1\"", make_shared<const string>("page 1"));
+        auto held = cache.find("/movie?", "\"1\"");
+        cache.store("/movie?", "\"2\"", make_shared<const string>("page 2"));
+        EXPECT_EQ(cache.find("/movie?", "\"1\""), nullptr);
+        EXPECT_EQ(*cache.find("/movie?", "\"2\""), "page 2");
+        EXPECT_EQ(cache.size(), 1);
+        // a page being sent stays valid after it is replaced
+        EXPECT_EQ(*held, "page 1");
+    }
+
+    TEST(PageCacheTest, bounded) {
+        // 16 shards of 1 KiB
+        PageCache cache(16 * 1024);
+        for (int i = 0; i < 10000; ++i) {
+            cache.store("/movie?name=" + to_string(i), "\"1\"", make_shared<const string>(100, 'x'));
+            EXPECT_LE(cache.bytes(), 16 * 1024);
+        }
+        EXPECT_GT(cache.size(), 16);
+        EXPECT_NE(cache.find("/movie?name=9999", "\"1\""), nullptr);
+        // a page larger than a shard is not kept at all
+        cache.store("/theater?", "\"1\"", make_shared<const string>(2000, 'x'));
+        EXPECT_EQ(cache.find("/theater?", "\"1\""), nullptr);
+
+        cache.clear();
+        EXPECT_EQ(cache.size(), 0);
+        EXPECT_EQ(cache.bytes(), 0);
+        EXPECT_EQ(cache.find("/movie?name=9999", "\"1\""), nullptr);
+    }
+
+    TEST(PageCacheTest, concurrent) {
+        PageCache cache;
+        vector<thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&cache, i]{
+                for (int j = 0; j < 1000; ++j) {
+                    auto key = "/movie?name=" + to_string(j % 50);
+                    auto etag = to_string(j / 50);
+                    if (!cache.find(key, etag)) {
+                        cache.store(key, etag, make_shared<const string>(key + etag));
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        EXPECT_EQ(cache.size(), 50);
+        EXPECT_EQ(*cache.find("/movie?name=7", "19"), "/movie?name=719");
+    }
+}
@@ -0,0 +1,188 @@
+// Test the name index behind the typeahead search
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/search.cpp"
+
+namespace {
+
+// the names laid out as the snapshot lays them out, with their index
+class Names
+{
+public:
+    Names(const vector<string>& names, size_t threads = 1)
+    {
+        _offsets.push_back(0);
+        for (auto& name : names) {
+            _pool += name;
+            _offsets.push_back(_pool.size());
+        }
+        size_t words = 0;
+        for (auto& name : names) {
+            words += NameIndex::wordsIn(name);
+        }
+        _entries.resize(words);
+        NameIndex::build(_pool.data(), _offsets.data(), names.size(), _entries.data(), threads);
+    }
+
+    NameIndex index() const
+    {
+        return {_pool.data(), _offsets.data(), _entries.data(), _entries.size()};
+    }
+
+    const vector<NameIndex::Entry>& entries() const { return _entries; }
+
+    vector<string> search(const string& query, size_t limit = 10, size_t max_edits = 0) const
+    {
+        vector<string> found;
+        for (auto id : index().search(query, limit, max_edits)) {
+            found.emplace_back(_pool, _offsets[id], _offsets[id + 1] - _offsets[id]);
+        }
+        return found;
+    }
+
+private:
+    string _pool;
+    vector<uint64_t> _offsets;
+    vector<NameIndex::Entry> _entries;
+};
+
+const vector<string> MOVIES = {
+    "Back to Black", "Dune: Part Two", "Inside Out 2", "Kung Fu Panda 4", "The Fall Guy", "Civil War",
+    "Back to the Future", "Furiosa: A Mad Max Saga",
+};
+
+TEST(NameIndexTest, wordsIn) {
+    EXPECT_EQ(NameIndex::wordsIn(""), 1);
+    EXPECT_EQ(NameIndex::wordsIn("Dune"), 1);
+    EXPECT_EQ(NameIndex::wordsIn("Dune: Part Two"), 3);
+    EXPECT_EQ(NameIndex::wordsIn("  Dune"), 2);
+    EXPECT_EQ(NameIndex::wordsIn("Amélie Poulain"), 2);
+}
+
+TEST(NameIndexTest, findsWordsByPrefix) {
+    Names names(MOVIES);
+    EXPECT_EQ(names.search("Back"), (vector<string>{"Back to Black", "Back to the Future"}));
+    EXPECT_EQ(names.search("part"), vector<string>{"Dune: Part Two"});
+    EXPECT_EQ(names.search("FU"), (vector<string>{"Kung Fu Panda 4", "Furiosa: A Mad Max Saga", "Back to the Future"}));
+    EXPECT_EQ(names.search("4"), vector<string>{"Kung Fu Panda 4"});
+    EXPECT_EQ(names.search("Dune: P"), vector<string>{"Dune: Part Two"});
+    EXPECT_TRUE(names.search("une").empty());
+    EXPECT_TRUE(names.search("Dunes").empty());
+}
+
+TEST(NameIndexTest, listsEachNameOnce) {
+    Names names({"To Be or Not to Be", "Tomorrow"});
+    EXPECT_EQ(names.search("to"), (vector<string>{"To Be or Not to Be", "Tomorrow"}));
+    EXPECT_EQ(names.search("be"), vector<string>{"To Be or Not to Be"});
+}
+
+TEST(NameIndexTest, stopsAtTheLimit) {
+    Names names(MOVIES);
+    EXPECT_EQ(names.search("b", 1), vector<string>{"Back to Black"});
+    EXPECT_EQ(names.search("", 3).size(), 3);
+    EXPECT_EQ(names.search("", 100).size(), MOVIES.size());
+}
+
+TEST(NameIndexTest, findsTypos) {
+    Names names(MOVIES);
+    EXPECT_TRUE(names.search("Frioza", 10, 1).empty());
+    EXPECT_EQ(names.search("Frioza", 10, 2), vector<string>{"Furiosa: A Mad Max Saga"});
+    // two letters the wrong way round are one typo
+    EXPECT_EQ(names.search("Furoisa", 10, 1), vector<string>{"Furiosa: A Mad Max Saga"});
+    EXPECT_EQ(names.search("Pnda", 10, 1), vector<string>{"Kung Fu Panda 4"});
+    EXPECT_EQ(names.search("Civl", 10, 1), vector<string>{"Civil War"});
+    EXPECT_EQ(names.search("Insade", 10, 1), vector<string>{"Inside Out 2"});
+    EXPECT_EQ(names.search("futrue", 10, 1), vector<string>{"Back to the Future"});
+    EXPECT_TRUE(names.search("Pnda", 10, 0).empty());
+}
+
+TEST(NameIndexTest, listsExactMatchesFirst) {
+    Names names({"Blacks", "Back to Black", "Black Adam"});
+    EXPECT_EQ(names.search("Black", 10, 1), (vector<string>{"Back to Black", "Black Adam", "Blacks"}));
+    EXPECT_EQ(names.search("Blak", 10, 0), vector<string>{});
+    EXPECT_EQ(names.search("Blak", 10, 1), (vector<string>{"Back to Black", "Black Adam", "Blacks"}));
+    EXPECT_EQ(names.search("Bakc", 10, 2).front(), "Back to Black");
+    EXPECT_EQ(names.search("Black", 1, 1), vector<string>{"Back to Black"});
+}
+
+TEST(NameIndexTest, searchesEmptyIndex) {
+    Names names({});
+    EXPECT_TRUE(names.search("a", 10, 2).empty());
+}
+
+TEST(NameIndexTest, searchesLongQueries) {
+    string title(500, 'a');
+    Names names({"Dune", title + "b"});
+    // the rows of the edit distances go no deeper than the names
+    string query(8000, 'x');
+    EXPECT_TRUE(names.search(query, 10, 2).empty());
+    EXPECT_EQ(names.search(title + "c", 10, 1), vector<string>{title + "b"});
+    EXPECT_TRUE(names.search(title + "cc", 10, 1).empty());
+}
+
+TEST(NameIndexTest, buildsTheSameOnAnyThreads) {
+    vector<string> movies;
+    for (int i = 0; i < 5000; ++i) {
+        movies.push_back("Movie " + to_string(i * 7919 % 5000) + (i % 3 ? " Returns" : " of the Year"));
+    }
+    Names serial(movies, 1);
+    Names parallel(movies, 4);
+    EXPECT_EQ(serial.entries(), parallel.entries());
+    EXPECT_EQ(serial.search("retu", 5).size(), 5);
+    EXPECT_EQ(parallel.search("movie 4999", 10), vector<string>{"Movie 4999 Returns"});
+}
+
+TEST(NameIndexTest, fuzzyMatchesBruteForce) {
+    // the walk of the sorted words finds what comparing the query to every word prefix finds
+    vector<string> words = {"abc", "abd", "acd", "bcd", "abcd", "xbc", "ab", "a", "bbbb", "cab"};
+    vector<string> movies;
+    for (size_t i = 0; i < words.size(); ++i) {
+        movies.push_back(words[i] + " " + words[(i * 3 + 1) % words.size()]);
+    }
+    Names names(movies);
+    // the optimal string alignment distance, a swap of two letters next to each other being one edit
+    auto distance = [](const string& a, const string& b) {
+        vector<vector<size_t>> d(a.size() + 1, vector<size_t>(b.size() + 1));
+        for (size_t i = 0; i <= a.size(); ++i) {
+            for (size_t j = 0; j <= b.size(); ++j) {
+                if (i == 0 || j == 0) {
+                    d[i][j] = i + j;
+                    continue;
+                }
+                d[i][j] = min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (a[i - 1] != b[j - 1])});
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                    d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+                }
+            }
+        }
+        return d[a.size()][b.size()];
+    };
+    for (string query : {"ab", "bd", "xyz", "cbd", "abcd", "b", "ba", "bacd", "acbd"}) {
+        for (size_t edits = 0; edits <= 2; ++edits) {
+            vector<string> expected;
+            for (auto& movie : movies) {
+                bool match = false;
+                for (size_t start = 0; start < movie.size(); ++start) {
+                    if (start != 0 && movie[start - 1] != ' ') {
+                        continue;
+                    }
+                    for (size_t end = start; end <= movie.size(); ++end) {
+                        match = match || distance(movie.substr(start, end - start), query) <= edits;
+                    }
+                }
+                if (match) {
+                    expected.push_back(movie);
+                }
+            }
+            auto found = names.search(query, 100, edits);
+            sort(found.begin(), found.end());
+            sort(expected.begin(), expected.end());
+            EXPECT_EQ(found, expected) << query << " " << edits;
+        }
+    }
+}
+
+}   // namespace
@@ -0,0 +1,128 @@
+// Test SeatSet and the bit kernels
+#include <random>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "../src/seatset.cpp"
+
+namespace {
+
+SeatSet randomSeats(size_t seats, mt19937_64& rng)
+{
+    SeatSet set(seats);
+    for (size_t i = 0; i < set.words(); ++i) {
+        set.data()[i] = rng();
+    }
+    // clear the bits beyond the last seat
+    return set.flip().flip();
+}
+
+TEST(SeatSetTest, padsToCacheLines) {
+    EXPECT_EQ(SeatSet(1).words(), SeatSet::WORDS_PER_LINE);
+    EXPECT_EQ(SeatSet(512).words(), SeatSet::WORDS_PER_LINE);
+    EXPECT_EQ(SeatSet(513).words(), 2 * SeatSet::WORDS_PER_LINE);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(SeatSet(5000).data()) % CACHE_LINE_SIZE, 0);
+}
+
+TEST(SeatSetTest, setAndTest) {
+    SeatSet set(300);
+    set.set(0);
+    set.set(63, 130);
+    set.set(299);
+    EXPECT_TRUE(set.test(0));
+    EXPECT_FALSE(set.test(1));
+    EXPECT_TRUE(set.test(63));
+    EXPECT_TRUE(set.test(129));
+    EXPECT_FALSE(set.test(130));
+    EXPECT_TRUE(set.test(299));
+    EXPECT_EQ(set.count(), 1 + 67 + 1);
+    set.reset(299);
+    EXPECT_FALSE(set.test(299));
+}
+
+TEST(SeatSetTest, flipStaysWithinSeats) {
+    SeatSet set(300);
+    set.set(10);
+    set.flip();
+    EXPECT_EQ(set.count(), 299);
+    EXPECT_FALSE(set.test(10));
+    EXPECT_EQ(set.flip().count(), 1);
+}
+
+TEST(SeatSetTest, findNext) {
+    SeatSet set(5000);
+    EXPECT_EQ(set.findNext(0), 5000);
+    set.set(64);
+    set.set(4999);
+    EXPECT_EQ(set.findNext(0), 64);
+    EXPECT_EQ(set.findNext(64), 64);
+    EXPECT_EQ(set.findNext(65), 4999);
+    EXPECT_EQ(set.findNext(5000), 5000);
+}
+
+TEST(SeatSetTest, kernelsMatchScalar) {
+    mt19937_64 rng(42);
+    for (size_t seats : {1, 20, 64, 65, 300, 511, 512, 513, 5000}) {
+        SeatSet a = randomSeats(seats, rng);
+        SeatSet b = randomSeats(seats, rng);
+
+        size_t count = 0;
+        bool intersects = false;
+        SeatSet diff(seats);
+        for (size_t i = 0; i < seats; ++i) {
+            count += a.test(i);
+            intersects |= a.test(i) && b.test(i);
+            if (a.test(i) && !b.test(i)) {
+                diff.set(i);
+            }
+        }
+        EXPECT_EQ(a.count(), count) << seats;
+        EXPECT_EQ(a.intersects(b), intersects) << seats;
+        EXPECT_EQ(SeatSet(a).subtract(b), diff) << seats;
+        EXPECT_FALSE(SeatSet(a).subtract(a).any()) << seats;
+    }
+}
+
+TEST(SeatSetTest, intersectsInLastWord) {
+    SeatSet a(5000), b(5000);
+    a.set(4999);
+    EXPECT_FALSE(a.intersects(b));
+    b.set(4999);
+    EXPECT_TRUE(a.intersects(b));
+    EXPECT_THROW(a.intersects(SeatSet(4999)), invalid_argument);
+}
+
+TEST(SeatSetTest, fromMask) {
+    EXPECT_EQ(SeatSet::fromMask(ALL_SEATS, MAX_SEATS).count(), MAX_SEATS);
+    EXPECT_EQ(SeatSet::fromMask(0xbeef, 300).mask(), 0xbeef);
+    EXPECT_THROW(SeatSet::fromMask(ALL_SEATS << 1, MAX_SEATS), invalid_argument);
+}
+
+TEST(SeatSetTest, toRanges) {
+    SeatSet set(300);
+    EXPECT_EQ(set.toRanges(), "");
+    set.set(0, 5);
+    set.set(8);
+    set.set(60, 70);
+    set.set(299);
+    EXPECT_EQ(set.toRanges(), "1-5,9,61-70,300");
+    EXPECT_EQ(SeatSet(300).flip().toRanges(), "1-300");
+}
+
+TEST(SeatSetTest, fromRanges) {
+    mt19937_64 rng(7);
+    SeatSet set = randomSeats(5000, rng);
+    EXPECT_EQ(SeatSet::fromRanges(set.toRanges(), 5000), set);
+
+    SeatSet overlapping = SeatSet::fromRanges("3-6,1-4,6", 10);
+    EXPECT_EQ(overlapping.toRanges(), "1-6");
+}
+
+TEST(SeatSetTest, fromRangesInvalid) {
+    for (auto ranges : {"0", "11", "1-11", "5-3", "1,", ",1", "1;2", "a", "1-", "-1", "1--2"}) {
+        EXPECT_THROW(SeatSet::fromRanges(ranges, 10), invalid_argument) << ranges;
+    }
+}
+
+}
@@ -1,12 +1,19 @@
 // Test ServiceImpl
 #include <algorithm>
+#include <bitset>
 #include <condition_variable>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
 #include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include <sys/resource.h>
+
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -54,6 +61,99 @@ TEST_F(ServiceTest, theatersOfMovie) {
     EXPECT_THROW(service.theaters("MD"), invalid_argument);
 }
 
+TEST_F(ServiceTest, namesSortedWithoutCopies) {
+    EXPECT_THAT(service.movies(), ElementsAre("MA", "MB", "MC"));
+    EXPECT_THAT(service.theaters(), ElementsAre("TA", "TB", "TC"));
+    EXPECT_THAT(service.movies("TC"), ElementsAre("MA", "MC"));
+    EXPECT_THAT(service.theaters("MB"), ElementsAre("TA", "TB"));
+    // every call views the same names
+    EXPECT_EQ(service.movies().begin(), service.movies().begin());
+    EXPECT_EQ(service.movies("TA")[1].data(), service.movies()[1].data());
+    EXPECT_EQ(service.theaters("MC")[0].data(), service.theaters()[1].data());
+}
+
+TEST_F(ServiceTest, ids) {
+    // ids follow the sorted order of the names
+    EXPECT_EQ(service.movieId("MA"), 0);
+    EXPECT_EQ(service.movieId("MC"), 2);
+    EXPECT_EQ(service.theaterId("TB"), 1);
+    EXPECT_THROW(service.movieId("MD"), invalid_argument);
+    EXPECT_THROW(service.theaterId("TD"), invalid_argument);
+
+    // showings are sorted by movie, then theater
+    EXPECT_EQ(service.showing(service.movieId("MA"), service.theaterId("TA")), 0);
+    EXPECT_EQ(service.showing("MA", "TC"), 1);
+    EXPECT_EQ(service.showing("MC", "TC"), 5);
+    EXPECT_THROW(service.showing("MA", "TB"), invalid_argument);
+    EXPECT_THROW(service.showing(3, 0), invalid_argument);
+}
+
+TEST_F(ServiceTest, bookById) {
+    auto showing = service.showing("MB", "TA");
+    EXPECT_EQ(service.availableSeats(showing), ALL_SEATS);
+    EXPECT_TRUE(service.book(showing, 0x0f));
+    EXPECT_FALSE(service.book(showing, SeatSet::fromMask(0x01, MAX_SEATS)));
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0x0f);
+    EXPECT_EQ(service.availableSeatCount(showing), MAX_SEATS - 4);
+    EXPECT_EQ(service.bookBest(showing, 1, SeatPreference::FRONT).toRanges(), "5");
+    EXPECT_THROW(service.book(6, 0x01), invalid_argument);
+}
+
+TEST_F(ServiceTest, versions) {
+    EXPECT_EQ(service.catalogVersion(), 0);
+    auto showing = service.showing("MA", "TC");
+    auto other = service.showing("MB", "TA");
+    EXPECT_EQ(service.version(showing), 0);
+    EXPECT_TRUE(service.book(showing, 0x01));
+    EXPECT_EQ(service.version(showing), 1);
+    // a failed booking changes nothing
+    EXPECT_FALSE(service.book(showing, 0x01));
+    EXPECT_EQ(service.version(showing), 1);
+    EXPECT_TRUE(service.book("MA", "TC", SeatSet::fromMask(0x02, MAX_SEATS)));
+    EXPECT_EQ(service.bookBest(showing, 2, SeatPreference::CENTER).count(), 2);
+    EXPECT_EQ(service.version(showing), 3);
+    EXPECT_EQ(service.version(other), 0);
+    EXPECT_THROW(service.version(6), invalid_argument);
+}
+
+TEST_F(ServiceTest, waitForChange) {
+    auto showing = service.showing("MA", "TC");
+    // nothing changes
+    EXPECT_EQ(service.waitForChange(showing, 0, chrono::milliseconds(10)), 0);
+    // the version has moved on already
+    EXPECT_TRUE(service.book(showing, 0x01));
+    EXPECT_EQ(service.waitForChange(showing, 0, chrono::milliseconds(0)), 1);
+    // woken up by a booking in another thread
+    auto waiter = async(launch::async, [&]{
+        return service.waitForChange(showing, 1, chrono::seconds(30));
+    });
+    this_thread::sleep_for(chrono::milliseconds(10));
+    EXPECT_TRUE(service.book(showing, 0x02));
+    EXPECT_EQ(waiter.get(), 2);
+    EXPECT_THROW(service.waitForChange(6, 0, chrono::milliseconds(0)), invalid_argument);
+}
+
+TEST_F(ServiceTest, waitForChangeManyWaiters) {
+    auto showing = service.showing("MB", "TA");
+    vector<future<uint64_t>> waiters;
+    for (int i = 0; i < 8; ++i) {
+        waiters.push_back(async(launch::async, [&]{
+            return service.waitForChange(showing, 0, chrono::seconds(30));
+        }));
+    }
+    this_thread::sleep_for(chrono::milliseconds(10));
+    // one booking wakes all of them up
+    EXPECT_TRUE(service.book(showing, 0x01));
+    for (auto& waiter : waiters) {
+        EXPECT_GE(waiter.get(), 1);
+    }
+}
+
+TEST_F(ServiceTest, duplicateShowing) {
+    vector<BookingRecord> duplicated = {{ "MA", "TA", 0 }, { "MA", "TA", 0 }};
+    EXPECT_THROW(ServiceImpl(duplicated.begin(), duplicated.end()), invalid_argument);
+}
+
 TEST_F(ServiceTest, availableSeats) {
     EXPECT_EQ(service.availableSeats("MA", "TA"), 0);
     EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS);
@@ -175,3 +275,1210 @@ TEST_F(ServiceTest, bookInvalidMask) {
 
 }
 
+
+namespace {
+
+class LargeVenueTest : public Test
+{
+protected:
+    vector<BookingRecord> br = {
+        { "MA", "TA", 0xff, 300 },
+        { "MA", "TB", 0, 5000 },
+    };
+    ServiceImpl service{br.begin(), br.end()};
+};
+
+TEST_F(LargeVenueTest, seats) {
+    EXPECT_EQ(service.seatCount("MA", "TA"), 300);
+    EXPECT_EQ(service.seatCount("MA", "TB"), 5000);
+    EXPECT_EQ(service.availableSeatCount("MA", "TA"), 292);
+    EXPECT_EQ(service.availableSeatCount("MA", "TB"), 5000);
+    EXPECT_EQ(service.availableSeatSet("MA", "TA").toRanges(), "9-300");
+    EXPECT_EQ(service.availableSeats("MA", "TA"), ~SeatMask{0xff});
+}
+
+TEST_F(LargeVenueTest, bookAcrossWords) {
+    EXPECT_TRUE(service.book("MA", "TB", SeatSet::fromRanges("60-70,4990-5000", 5000)));
+    EXPECT_EQ(service.availableSeatCount("MA", "TB"), 5000 - 22);
+    EXPECT_FALSE(service.book("MA", "TB", SeatSet::fromRanges("1-10,70", 5000)));
+    // a failed booking leaves nothing behind
+    EXPECT_EQ(service.availableSeatCount("MA", "TB"), 5000 - 22);
+    EXPECT_TRUE(service.book("MA", "TB", SeatSet::fromRanges("1-10", 5000)));
+    EXPECT_EQ(service.availableSeatSet("MA", "TB").toRanges(), "11-59,71-4989");
+}
+
+TEST_F(LargeVenueTest, bookWithMask) {
+    EXPECT_FALSE(service.book("MA", "TA", 0x100ff));
+    EXPECT_TRUE(service.book("MA", "TA", 0x10000));
+    EXPECT_FALSE(service.book("MA", "TA", SeatSet::fromRanges("17", 300)));
+}
+
+TEST_F(LargeVenueTest, bookInvalidSeats) {
+    EXPECT_THROW(service.book("MA", "TA", SeatSet(300)), invalid_argument);
+    EXPECT_THROW(service.book("MA", "TA", SeatSet::fromRanges("1", 5000)), invalid_argument);
+}
+
+TEST_F(LargeVenueTest, bookConcurrent) {
+    constexpr size_t TOTAL_THREADS = 64;
+    constexpr size_t SEATS = 5000;
+
+    // every thread books a block that overlaps with its neighbours and spans several words
+    vector<SeatSet> requests;
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        SeatSet seats(SEATS);
+        seats.set(i * 70, min(SEATS, i * 70 + 140));
+        requests.push_back(move(seats));
+    }
+
+    vector<char> booked(TOTAL_THREADS);
+    vector<thread> threads;
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        threads.emplace_back([&, i]{ booked[i] = service.book("MA", "TB", requests[i]); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // verify there's no over bookings, and nothing is taken by a failed booking
+    SeatSet taken(SEATS);
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        if (booked[i]) {
+            EXPECT_FALSE(taken.intersects(requests[i]));
+            taken |= requests[i];
+        }
+    }
+    // and a booking only fails on seats another one won
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        EXPECT_TRUE(booked[i] || taken.intersects(requests[i])) << i;
+    }
+    EXPECT_EQ(service.availableSeatSet("MA", "TB"), taken.flip());
+}
+
+TEST_F(LargeVenueTest, overlappingBookingsProgress) {
+    constexpr size_t SEATS = 5000;
+    constexpr size_t WORD = SeatSet::WORD_BITS;
+    vector<string> movies;
+    for (int i = 0; i < 40; ++i) {
+        movies.push_back("M" + to_string(i));
+    }
+    vector<BookingRecord> showings;
+    for (auto& movie : movies) {
+        showings.push_back({movie, "T", 0, SEATS});
+    }
+    ServiceImpl venues(showings.begin(), showings.end());
+
+    // in every block of three words, A spans the first two, B the last two and C only the last:
+    // one of A and B wins, as does one of B and C
+    struct Round
+    {
+        ShowingId showing;
+        SeatSet seats[3] = {SeatSet(SEATS), SeatSet(SEATS), SeatSet(SEATS)};
+        char booked[3] = {};
+    };
+    vector<Round> rounds;
+    for (auto& movie : movies) {
+        for (size_t w = 0; w + 3 <= SEATS / WORD; w += 3) {
+            Round round{venues.showing(movie, "T")};
+            round.seats[0].set(w * WORD + 50, (w + 1) * WORD + 10);
+            round.seats[1].set((w + 1) * WORD + 5, (w + 2) * WORD + 10);
+            round.seats[2].set((w + 2) * WORD + 5, (w + 2) * WORD + 6);
+            rounds.push_back(move(round));
+        }
+    }
+
+    atomic<size_t> started{0};
+    atomic<size_t> done{0};
+    vector<thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t r = 0; r < rounds.size(); ++r) {
+                while (started.load() <= r) {
+                    this_thread::yield();
+                }
+                rounds[r].booked[t] = venues.book(rounds[r].showing, rounds[r].seats[t]);
+                ++done;
+            }
+        });
+    }
+    for (size_t r = 0; r < rounds.size(); ++r) {
+        started = r + 1;
+        while (done.load() < 3 * (r + 1)) {
+            this_thread::yield();
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (auto& round : rounds) {
+        EXPECT_NE(round.booked[0], round.booked[1]);
+        EXPECT_NE(round.booked[1], round.booked[2]);
+    }
+}
+
+}
+
+namespace {
+
+class BookBestTest : public Test
+{
+protected:
+    vector<BookingRecord> br = {
+        // 4 rows of 5 seats
+        { "MA", "TA", 0, MAX_SEATS, SEATS_PER_ROW },
+        // 10 rows of 30 seats, rows cross word boundaries
+        { "MA", "TB", 0, 300, 30 },
+        // 1 full row of 64 seats
+        { "MA", "TC", 0, 64, 64 },
+    };
+    ServiceImpl service{br.begin(), br.end()};
+};
+
+TEST_F(BookBestTest, centerOfMiddleRow) {
+    // rows 0-3, the middle row is 1, seats 5-9; the middle of 3 seats is 6-8
+    EXPECT_EQ(service.bookBest("MA", "TA", 3, SeatPreference::CENTER).toRanges(), "7-9");
+    // the next best is row 2, then row 0
+    EXPECT_EQ(service.bookBest("MA", "TA", 3, SeatPreference::CENTER).toRanges(), "12-14");
+    EXPECT_EQ(service.bookBest("MA", "TA", 3, SeatPreference::CENTER).toRanges(), "2-4");
+    // rows 0-2 have no 2 adjacent seats left
+    EXPECT_EQ(service.bookBest("MA", "TA", 2, SeatPreference::CENTER).toRanges(), "17-18");
+}
+
+TEST_F(BookBestTest, frontAndBack) {
+    EXPECT_EQ(service.bookBest("MA", "TA", 5, SeatPreference::FRONT).toRanges(), "1-5");
+    EXPECT_EQ(service.bookBest("MA", "TA", 5, SeatPreference::BACK).toRanges(), "16-20");
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::FRONT).toRanges(), "8");
+}
+
+TEST_F(BookBestTest, closestToMiddleOfRow) {
+    // leave seats 1-2 and 5 of row 0 free
+    EXPECT_TRUE(service.book("MA", "TA", 0b01100));
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::FRONT).toRanges(), "2");
+    // a tie goes to the right
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::FRONT).toRanges(), "5");
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::FRONT).toRanges(), "1");
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::FRONT).toRanges(), "8");
+}
+
+TEST_F(BookBestTest, acrossWords) {
+    // row 2 is seats 61-90, its middle 4 seats are 74-77 and span no word boundary; row 4 is
+    // 121-150 and crosses the boundary at seat 128
+    SeatSet taken = SeatSet::fromRanges("1-120,151-300", 300);
+    EXPECT_TRUE(service.book("MA", "TB", taken));
+    EXPECT_EQ(service.bookBest("MA", "TB", 30, SeatPreference::CENTER).toRanges(), "121-150");
+    EXPECT_EQ(service.availableSeatCount("MA", "TB"), 0);
+}
+
+TEST_F(BookBestTest, fullRow) {
+    EXPECT_EQ(service.bookBest("MA", "TC", 64, SeatPreference::CENTER).count(), 64);
+    EXPECT_TRUE(service.bookBest("MA", "TC", 1, SeatPreference::CENTER).none());
+}
+
+TEST_F(BookBestTest, notAvailable) {
+    EXPECT_TRUE(service.book("MA", "TA", 0b11011'11011'11011'11011));
+    EXPECT_TRUE(service.bookBest("MA", "TA", 2, SeatPreference::CENTER).none());
+    EXPECT_EQ(service.bookBest("MA", "TA", 1, SeatPreference::CENTER).toRanges(), "8");
+}
+
+TEST_F(BookBestTest, invalidCount) {
+    EXPECT_THROW(service.bookBest("MA", "TA", 0, SeatPreference::CENTER), invalid_argument);
+    EXPECT_THROW(service.bookBest("MA", "TA", 6, SeatPreference::CENTER), invalid_argument);
+}
+
+TEST_F(BookBestTest, bookConcurrent) {
+    constexpr size_t TOTAL_THREADS = 64;
+
+    vector<SeatSet> booked(TOTAL_THREADS);
+    vector<thread> threads;
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        threads.emplace_back([&, i]{ booked[i] = service.bookBest("MA", "TB", 4, SeatPreference::CENTER); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // each row of 30 fits 7 blocks of 4, enough for every thread
+    SeatSet taken(300);
+    size_t blocks = 0;
+    for (auto& seats : booked) {
+        if (seats.any()) {
+            EXPECT_EQ(seats.count(), 4);
+            EXPECT_FALSE(taken.intersects(seats));
+            taken |= seats;
+            ++blocks;
+        }
+    }
+    EXPECT_EQ(blocks, 64);
+    EXPECT_EQ(service.availableSeatSet("MA", "TB"), taken.flip());
+}
+
+}
+
+namespace {
+
+class BookBatchTest : public ServiceTest
+{
+protected:
+    static Service::Booking booking(const string& movie, const string& theater, SeatMask mask)
+    {
+        return {movie, theater, SeatSet::fromMask(mask, MAX_SEATS)};
+    }
+};
+
+TEST_F(BookBatchTest, allBooked) {
+    EXPECT_TRUE(service.bookBatch({
+        booking("MA", "TC", 0x0f),
+        booking("MB", "TA", 0xf0),
+        booking("MC", "TB", 0x01),
+    }));
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0x0f);
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0xf0);
+    EXPECT_EQ(service.availableSeats("MC", "TB"), ALL_SEATS & ~0x01);
+}
+
+TEST_F(BookBatchTest, noneBookedOnConflict) {
+    EXPECT_TRUE(service.book("MC", "TB", 0x100));
+    EXPECT_FALSE(service.bookBatch({
+        booking("MA", "TC", 0x0f),
+        booking("MB", "TA", 0xf0),
+        booking("MC", "TB", 0x101),
+    }));
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS);
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS);
+    EXPECT_EQ(service.availableSeats("MC", "TB"), ALL_SEATS & ~0x100);
+}
+
+TEST_F(BookBatchTest, sameShowingMerged) {
+    EXPECT_TRUE(service.bookBatch({
+        booking("MA", "TC", 0x0f),
+        booking("MB", "TA", 0x01),
+        booking("MA", "TC", 0xf0),
+    }));
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0xff);
+    EXPECT_THROW(service.bookBatch({booking("MA", "TC", 0x300), booking("MA", "TC", 0x100)}), invalid_argument);
+}
+
+TEST_F(BookBatchTest, countedPerShowing) {
+    auto before = Metrics::sums();
+    EXPECT_TRUE(service.bookBatch({booking("MA", "TC", 0x03), booking("MB", "TA", 0x01)}));
+    EXPECT_FALSE(service.bookBatch({booking("MA", "TC", 0x04), booking("MB", "TB", 0x01)}));
+    auto after = Metrics::sums();
+    EXPECT_EQ(after.booked - before.booked, 2);
+    EXPECT_EQ(after.conflicts - before.conflicts, 2);
+}
+
+TEST_F(BookBatchTest, invalidBookingsBookNothing) {
+    EXPECT_THROW(service.bookBatch({}), invalid_argument);
+    EXPECT_THROW(service.bookBatch({booking("MA", "TC", 0x0f), booking("MA", "TB", 0x0f)}), invalid_argument);
+    EXPECT_THROW(service.bookBatch({booking("MA", "TC", 0x0f), booking("MB", "TA", 0)}), invalid_argument);
+    EXPECT_THROW(service.bookBatch({{"MA", "TC", SeatSet(300)}}), invalid_argument);
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS);
+}
+
+TEST_F(BookBatchTest, bookConcurrent) {
+    constexpr size_t TOTAL_THREADS = 200;
+
+    // every batch takes one seat in two showings, listed in either order
+    vector<char> booked(TOTAL_THREADS);
+    vector<thread> threads;
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        threads.emplace_back([&, i]{
+            SeatMask seat = SeatMask{1} << (i % MAX_SEATS);
+            auto a = booking("MA", "TC", seat);
+            auto b = booking("MC", "TB", seat);
+            booked[i] = i % 2 ? service.bookBatch({a, b}) : service.bookBatch({b, a});
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    SeatMask booked_mask = NO_SEATS;
+    for (size_t i = 0; i < TOTAL_THREADS; ++i) {
+        if (booked[i]) {
+            SeatMask seat = SeatMask{1} << (i % MAX_SEATS);
+            EXPECT_EQ(booked_mask & seat, 0);
+            booked_mask |= seat;
+        }
+    }
+    // both showings always end up with the same seats taken
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~booked_mask);
+    EXPECT_EQ(service.availableSeats("MC", "TB"), ALL_SEATS & ~booked_mask);
+}
+
+TEST_F(BookBatchTest, failedBatchesTakeNoSeats) {
+    // every batch fails on the full MB/TB, so it never holds up the seats it asks for in MA/TC
+    atomic<bool> done{false};
+    thread batches([&]{
+        for (size_t i = 0; !done; ++i) {
+            SeatMask seat = SeatMask{1} << (i % 4);
+            EXPECT_FALSE(service.bookBatch({booking("MA", "TC", seat), booking("MB", "TB", 0x01)}));
+        }
+    });
+    for (int i = 0; i < 20000; ++i) {
+        auto held = service.hold("MA", "TC", SeatMask{1} << (i % 4), chrono::minutes(1));
+        ASSERT_NE(held, 0);
+        EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~(SeatMask{1} << (i % 4)));
+        EXPECT_TRUE(service.release(held));
+    }
+    done = true;
+    batches.join();
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS);
+}
+
+}
+
+namespace {
+
+class BookingLogTest : public ServiceTest
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_booking_log_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+
+    unique_ptr<ServiceImpl> restart()
+    {
+        return make_unique<ServiceImpl>(br.begin(), br.end(), make_unique<WriteAheadLog>(path));
+    }
+};
+
+TEST_F(BookingLogTest, bookingsSurviveRestart) {
+    {
+        auto logged = restart();
+        EXPECT_TRUE(logged->book("MA", "TC", 0x01));
+        EXPECT_TRUE(logged->book(logged->showing("MA", "TC"), SeatSet::fromRanges("2-3", MAX_SEATS)));
+        EXPECT_FALSE(logged->book("MA", "TC", 0x02));
+        EXPECT_EQ(logged->bookBest("MB", "TA", 2, SeatPreference::FRONT).toRanges(), "2-3");
+        EXPECT_TRUE(logged->bookBatch({{"MC", "TB", SeatSet::fromMask(0x10, MAX_SEATS)},
+                                       {"MA", "TC", SeatSet::fromMask(0x10, MAX_SEATS)}}));
+    }
+    auto logged = restart();
+    EXPECT_EQ(logged->availableSeats("MA", "TC"), ALL_SEATS & ~0x17);
+    EXPECT_EQ(logged->availableSeats("MB", "TA"), ALL_SEATS & ~0x06);
+    EXPECT_EQ(logged->availableSeats("MC", "TB"), ALL_SEATS & ~0x10);
+    // and the replayed service keeps logging
+    EXPECT_TRUE(logged->book("MC", "TB", 0x20));
+    logged = restart();
+    EXPECT_EQ(logged->availableSeats("MC", "TB"), ALL_SEATS & ~0x30);
+}
+
+TEST_F(BookingLogTest, catalogChangesDoNotWaitForTheDisk) {
+    // every commit waits out the window, with the booked seats claimed already
+    ServiceImpl logged(br.begin(), br.end(), make_unique<WriteAheadLog>(path, chrono::milliseconds(300)));
+    auto booking = async(launch::async, [&] { return logged.book("MA", "TC", 0x01); });
+    auto best = async(launch::async, [&] { return logged.bookBest("MB", "TA", 2, SeatPreference::FRONT); });
+    while (logged.availableSeats("MA", "TC") == ALL_SEATS || logged.availableSeats("MB", "TA") == ALL_SEATS) {
+        this_thread::yield();
+    }
+    // no reader is left open while the bookings are logged
+    auto start = chrono::steady_clock::now();
+    Rcu::synchronize();
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(150));
+    EXPECT_TRUE(booking.get());
+    EXPECT_EQ(best.get().toRanges(), "2-3");
+}
+
+TEST_F(BookingLogTest, removedShowingsSkipped) {
+    {
+        auto logged = restart();
+        EXPECT_TRUE(logged->book("MA", "TC", 0x01));
+        EXPECT_TRUE(logged->book("MB", "TA", 0x01));
+    }
+    br.erase(br.begin() + 1);
+    auto logged = restart();
+    EXPECT_EQ(logged->availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+}
+
+}
+
+namespace {
+
+class ServiceSnapshotTest : public ServiceTest
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_service_test.snap").string();
+    string log_path = (filesystem::temp_directory_path() / "bb_service_snapshot_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+};
+
+TEST_F(ServiceSnapshotTest, restartFromSnapshot) {
+    EXPECT_TRUE(service.book("MA", "TC", 0x03));
+    EXPECT_TRUE(service.book("MC", "TB", 0x10));
+    service.checkpoint(path);
+
+    ServiceImpl restarted(Snapshot::open(path));
+    EXPECT_THAT(restarted.movies(), ElementsAre("MA", "MB", "MC"));
+    EXPECT_THAT(restarted.theaters("MB"), ElementsAre("TA", "TB"));
+    EXPECT_THAT(restarted.movies("TC"), ElementsAre("MA", "MC"));
+    EXPECT_EQ(restarted.movieId("MC"), service.movieId("MC"));
+    EXPECT_EQ(restarted.showing("MC", "TB"), service.showing("MC", "TB"));
+    EXPECT_THROW(restarted.theaterId("TD"), invalid_argument);
+    EXPECT_EQ(restarted.availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+    EXPECT_EQ(restarted.availableSeats("MC", "TB"), ALL_SEATS & ~0x10);
+    EXPECT_EQ(restarted.availableSeats("MA", "TA"), 0);
+    EXPECT_EQ(restarted.version(restarted.showing("MA", "TC")), 1);
+
+    // bookings after the checkpoint stay apart
+    EXPECT_TRUE(restarted.book("MA", "TC", 0x04));
+    EXPECT_TRUE(service.book("MA", "TC", 0x08));
+    EXPECT_EQ(restarted.availableSeats("MA", "TC"), ALL_SEATS & ~0x07);
+    EXPECT_EQ(ServiceImpl(Snapshot::open(path)).availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+}
+
+TEST_F(ServiceSnapshotTest, logReplayedAfterSnapshot) {
+    {
+        ServiceImpl logged(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+        EXPECT_TRUE(logged.book("MA", "TC", 0x01));
+        logged.checkpoint(path);
+        EXPECT_TRUE(logged.book("MA", "TC", 0x02));
+    }
+    ServiceImpl restarted(Snapshot::open(path), make_unique<WriteAheadLog>(log_path));
+    EXPECT_EQ(restarted.availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+    // only the booking after the snapshot was replayed
+    EXPECT_EQ(restarted.version(restarted.showing("MA", "TC")), 2);
+}
+
+TEST_F(ServiceSnapshotTest, checkpointInBackground) {
+    service.checkpointEvery(path, chrono::milliseconds(1));
+    // the first checkpoint is written without any booking, the catalog was never saved
+    for (int i = 0; i < 5000 && !filesystem::exists(path); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(filesystem::exists(path));
+    EXPECT_TRUE(service.book("MB", "TA", 0x01));
+    for (int i = 0; i < 5000; ++i) {
+        if (ServiceImpl(Snapshot::open(path)).availableSeats("MB", "TA") != ALL_SEATS) {
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    EXPECT_EQ(ServiceImpl(Snapshot::open(path)).availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+}
+
+TEST_F(ServiceSnapshotTest, bookingsNeverLoggedLeftOut) {
+    ServiceImpl logged(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path, chrono::milliseconds(300)));
+    logged.checkpoint(path);
+    // the booking waits out the window with its seat claimed, while the checkpoint copies it
+    auto booking = async(launch::async, [&] { return logged.book("MA", "TC", 0x01); });
+    while (logged.availableSeats("MA", "TC") == ALL_SEATS) {
+        this_thread::yield();
+    }
+    auto checkpoint = async(launch::async, [&] { logged.checkpoint(path); });
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    // and then the log cannot be written
+    auto on_too_large = signal(SIGXFSZ, SIG_IGN);
+    rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    rlimit full = limit;
+    full.rlim_cur = filesystem::file_size(log_path);
+    setrlimit(RLIMIT_FSIZE, &full);
+    EXPECT_THROW(booking.get(), system_error);
+    EXPECT_THROW(checkpoint.get(), system_error);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, on_too_large);
+
+    EXPECT_EQ(logged.availableSeats("MA", "TC"), ALL_SEATS);
+    EXPECT_EQ(ServiceImpl(Snapshot::open(path), make_unique<WriteAheadLog>(log_path)).availableSeats("MA", "TC"),
+              ALL_SEATS);
+}
+
+}
+
+namespace {
+
+class ParallelBuildTest : public Test
+{
+protected:
+    // names the records view, in an order that is not sorted
+    vector<string> movies;
+    vector<string> theaters;
+    vector<BookingRecord> br;
+
+    void SetUp() override
+    {
+        for (int i = 0; i < 600; ++i) {
+            movies.push_back("Movie " + to_string((i * 7919) % 600));
+            theaters.push_back("Theater " + to_string((i * 104729) % 600));
+        }
+        // enough showings for every thread to take a part of them
+        for (size_t t = 0; t < theaters.size(); ++t) {
+            for (size_t m = t % 3; m < movies.size(); m += 3) {
+                br.push_back({movies[m], theaters[t], m, 64 + m, 8 + t % 8});
+            }
+        }
+    }
+};
+
+TEST_F(ParallelBuildTest, sameOnAnyThreads) {
+    auto one = buildSnapshot(br.begin(), br.end(), 1);
+    auto many = buildSnapshot(br.begin(), br.end(), 4);
+    for (uint32_t s = 0; s < Snapshot::SECTIONS; ++s) {
+        auto section = Snapshot::Section(s);
+        ASSERT_EQ(many.count<char>(section), one.count<char>(section));
+        EXPECT_EQ(memcmp(many.section<char>(section), one.section<char>(section), one.count<char>(section)), 0)
+            << "section " << s;
+    }
+
+    ASSERT_EQ(parallel::partsFor(br.size(), 4), 4);
+    ServiceImpl service(br.begin(), br.end(), nullptr, 4);
+    EXPECT_EQ(service.movies().size(), 600);
+    auto movies = service.movies(theaters[1]);
+    EXPECT_EQ(movies.size(), 200);
+    EXPECT_TRUE(is_sorted(movies.begin(), movies.end()));
+    for (auto& record : br) {
+        auto showing = service.showing(string(record.movie_name), string(record.theater_name));
+        ASSERT_EQ(service.seatCount(showing), record.seats);
+        ASSERT_EQ(service.seatsPerRow(showing), record.seats_per_row);
+        ASSERT_EQ(service.availableSeatCount(showing), record.seats - bitset<64>(record.booked_mask).count());
+    }
+}
+
+TEST_F(ParallelBuildTest, duplicateAcrossParts) {
+    br.push_back(br.front());
+    EXPECT_THROW(buildSnapshot(br.begin(), br.end(), 4), invalid_argument);
+}
+
+TEST_F(ParallelBuildTest, createFromCatalogFile) {
+    string path = (filesystem::temp_directory_path() / "bb_service_test.csv").string();
+    {
+        ofstream out(path);
+        for (auto& record : br) {
+            out << record.movie_name << ',' << record.theater_name << ',' << record.seats << ','
+                << record.seats_per_row << '\n';
+        }
+    }
+    Service::Options options;
+    options.catalog_path = path;
+    options.load_threads = 4;
+    auto service = Service::create(options);
+    filesystem::remove(path);
+
+    EXPECT_EQ(service->movies().size(), 600);
+    auto& record = br[br.size() / 2];
+    EXPECT_EQ(service->seatCount(string(record.movie_name), string(record.theater_name)), record.seats);
+    // the catalog file books nothing
+    EXPECT_EQ(service->availableSeatCount(string(record.movie_name), string(record.theater_name)), record.seats);
+    // every third movie is not showing in a theater
+    EXPECT_THROW(service->showing(movies[1], theaters[0]), invalid_argument);
+}
+
+}
+
+namespace {
+
+class CatalogUpdateTest : public ServiceTest
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_catalog_update_test.snap").string();
+    string log_path = (filesystem::temp_directory_path() / "bb_catalog_update_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+};
+
+TEST_F(CatalogUpdateTest, addAndRemove) {
+    auto before = service.movies();
+    auto kept = service.showing("MB", "TA");
+    auto removed = service.showing("MA", "TC");
+    EXPECT_TRUE(service.book(kept, 0x01));
+
+    EXPECT_EQ(service.updateCatalog({{"MA", "TC"}}, {{"MD", "TD", 100, 10}, {"MA", "TB"}}), 1);
+    EXPECT_EQ(service.catalogVersion(), 1);
+    EXPECT_THAT(service.movies(), ElementsAre("MA", "MB", "MC", "MD"));
+    EXPECT_THAT(service.theaters(), ElementsAre("TA", "TB", "TC", "TD"));
+    EXPECT_THAT(service.theaters("MA"), ElementsAre("TA", "TB"));
+    EXPECT_THAT(service.movies("TC"), ElementsAre("MC"));
+    // the lists from before the change still list what was there
+    EXPECT_THAT(before, ElementsAre("MA", "MB", "MC"));
+
+    // the showings that stay keep their ids and their seats, the others are gone for good
+    EXPECT_EQ(service.showing("MB", "TA"), kept);
+    EXPECT_EQ(service.availableSeats(kept), ALL_SEATS & ~0x01);
+    EXPECT_EQ(service.version(kept), 1);
+    EXPECT_THROW(service.showing("MA", "TC"), invalid_argument);
+    EXPECT_THROW(service.seatCount(removed), invalid_argument);
+    EXPECT_THROW(service.book(removed, 0x01), invalid_argument);
+
+    auto added = service.showing("MD", "TD");
+    EXPECT_GE(added, br.size());
+    EXPECT_EQ(service.seatCount(added), 100);
+    EXPECT_EQ(service.seatsPerRow(added), 10);
+    EXPECT_EQ(service.availableSeatCount(added), 100);
+    EXPECT_EQ(service.bookBest(added, 2, SeatPreference::FRONT).toRanges(), "5-6");
+    EXPECT_EQ(service.version(added), 1);
+    EXPECT_EQ(service.seatCount("MA", "TB"), MAX_SEATS);
+
+    // an id is never used again, even for the same showing
+    EXPECT_EQ(service.updateCatalog({{"MD", "TD"}}, {}), 2);
+    EXPECT_EQ(service.updateCatalog({}, {{"MD", "TD"}}), 3);
+    EXPECT_NE(service.showing("MD", "TD"), added);
+    EXPECT_EQ(service.availableSeatCount("MD", "TD"), MAX_SEATS);
+    EXPECT_THROW(service.version(added), invalid_argument);
+}
+
+TEST_F(CatalogUpdateTest, invalidChangesChangeNothing) {
+    EXPECT_THROW(service.updateCatalog({{"MA", "TB"}}, {}), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({{"MA", "TA"}, {"MA", "TA"}}, {}), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({}, {{"MD", "TD"}, {"MB", "TB"}}), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({}, {{"MD", "TD"}, {"MD", "TD"}}), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({}, {{"MD", "TD", 0}}), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({}, {{"MD", "TD", 10, MAX_SEATS_PER_ROW + 1}}), invalid_argument);
+    EXPECT_EQ(service.catalogVersion(), 0);
+    EXPECT_THAT(service.movies(), ElementsAre("MA", "MB", "MC"));
+
+    // removing a showing and adding it back in one change starts it over
+    EXPECT_EQ(service.updateCatalog({{"MA", "TA"}}, {{"MA", "TA", 10}}), 1);
+    EXPECT_EQ(service.availableSeatCount("MA", "TA"), 10);
+    // and an empty change changes nothing
+    EXPECT_EQ(service.updateCatalog({}, {}), 1);
+}
+
+TEST_F(CatalogUpdateTest, waitForRemovedShowing) {
+    auto showing = service.showing("MB", "TA");
+    auto waiter = async(launch::async, [&] {
+        return service.waitForChange(showing, 0, chrono::seconds(30));
+    });
+    this_thread::sleep_for(chrono::milliseconds(10));
+    service.updateCatalog({{"MB", "TA"}}, {});
+    EXPECT_EQ(waiter.wait_for(chrono::seconds(10)), future_status::ready);
+    EXPECT_THROW(waiter.get(), invalid_argument);
+}
+
+TEST_F(CatalogUpdateTest, changesSurviveRestart) {
+    auto restart = [&] {
+        return make_unique<ServiceImpl>(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+    };
+    {
+        auto logged = restart();
+        EXPECT_TRUE(logged->book("MB", "TA", 0x01));
+        EXPECT_TRUE(logged->book("MA", "TC", 0x01));
+        logged->updateCatalog({{"MA", "TC"}}, {{"MD", "TD", 100, 10}});
+        EXPECT_TRUE(logged->book("MD", "TD", 0x06));
+        EXPECT_THROW(logged->updateCatalog({{"MA", "TC"}}, {}), invalid_argument);
+    }
+    auto logged = restart();
+    EXPECT_EQ(logged->catalogVersion(), 1);
+    EXPECT_THROW(logged->showing("MA", "TC"), invalid_argument);
+    EXPECT_EQ(logged->availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+    EXPECT_EQ(logged->seatsPerRow("MD", "TD"), 10);
+    EXPECT_EQ(logged->availableSeats("MD", "TD"), ~SeatMask(0x06));
+}
+
+TEST_F(CatalogUpdateTest, checkpointAfterChange) {
+    {
+        ServiceImpl logged(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+        EXPECT_TRUE(logged.book("MB", "TA", 0x01));
+        logged.updateCatalog({{"MA", "TC"}}, {{"MD", "TD", 100, 10}});
+        EXPECT_TRUE(logged.book("MD", "TD", 0x02));
+        logged.checkpoint(path);
+        logged.updateCatalog({}, {{"ME", "TE"}});
+        EXPECT_TRUE(logged.book("MD", "TD", 0x04));
+    }
+    ServiceImpl restarted(Snapshot::open(path));
+    EXPECT_THAT(restarted.movies(), ElementsAre("MA", "MB", "MC", "MD"));
+    EXPECT_EQ(restarted.availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+    EXPECT_EQ(restarted.seatCount("MD", "TD"), 100);
+    EXPECT_EQ(restarted.availableSeats("MD", "TD"), ~SeatMask(0x02));
+
+    // only the changes after the snapshot are replayed
+    ServiceImpl replayed(Snapshot::open(path), make_unique<WriteAheadLog>(log_path));
+    EXPECT_THAT(replayed.movies(), ElementsAre("MA", "MB", "MC", "MD", "ME"));
+    EXPECT_EQ(replayed.availableSeats("MD", "TD"), ~SeatMask(0x06));
+    EXPECT_EQ(replayed.version(replayed.showing("MD", "TD")), 2);
+}
+
+TEST_F(CatalogUpdateTest, changeConcurrent) {
+    // readers and bookings go on while showings come and go
+    atomic<bool> done{false};
+    atomic<size_t> booked{0};
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i] {
+            for (size_t seat = i; !done.load(); seat += 4) {
+                EXPECT_GE(service.movies().size(), 3);
+                EXPECT_THAT(service.theaters("MB"), ElementsAre("TA", "TB"));
+                if (seat < MAX_SEATS && service.book("MB", "TA", SeatMask(1) << seat)) {
+                    ++booked;
+                }
+                try {
+                    service.bookBest("MD", "TD", 1, SeatPreference::FRONT);
+                } catch (invalid_argument&) {
+                    // not showing right now
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        service.updateCatalog({}, {{"MD", "TD"}});
+        service.updateCatalog({{"MD", "TD"}}, {});
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(service.catalogVersion(), 400);
+    EXPECT_EQ(service.availableSeatCount("MB", "TA"), MAX_SEATS - booked);
+}
+
+}
+
+namespace {
+
+class ShowtimeTest : public Test
+{
+protected:
+    // MA is shown in TA twice, and so is MB, once without a time
+    vector<BookingRecord> br = {
+        { "MA", "TA", 0, MAX_SEATS, SEATS_PER_ROW, 2000 },
+        { "MA", "TB", 0, MAX_SEATS, SEATS_PER_ROW, 1500 },
+        { "MB", "TA", 0, MAX_SEATS, SEATS_PER_ROW, 3000 },
+        { "MA", "TA", 0, MAX_SEATS, SEATS_PER_ROW, 1000 },
+        { "MB", "TA", ALL_SEATS },
+    };
+    ServiceImpl service{br.begin(), br.end()};
+    string path = (filesystem::temp_directory_path() / "bb_showtime_test.snap").string();
+    string log_path = (filesystem::temp_directory_path() / "bb_showtime_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    static vector<StartTime> starts(const Service::ShowtimeList& showtimes)
+    {
+        vector<StartTime> starts;
+        for (auto& showtime : showtimes) {
+            starts.push_back(showtime.start);
+        }
+        return starts;
+    }
+};
+
+TEST_F(ShowtimeTest, showingsAtTimes) {
+    auto first = service.showing("MA", "TA", 1000);
+    auto second = service.showing("MA", "TA", 2000);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(service.start(first), 1000);
+    EXPECT_EQ(service.start(second), 2000);
+    EXPECT_EQ(service.showing(service.movieId("MA"), service.theaterId("TA"), 2000), second);
+    // without a time, the showing that starts first
+    EXPECT_EQ(service.showing("MA", "TA"), first);
+    EXPECT_EQ(service.showing("MB", "TA"), service.showing("MB", "TA", 0));
+    EXPECT_THROW(service.showing("MA", "TA", 1500), invalid_argument);
+    EXPECT_THROW(service.showing("MA", "TC", 1000), invalid_argument);
+
+    // each has seats of its own
+    EXPECT_TRUE(service.book(second, 0x01));
+    EXPECT_EQ(service.availableSeats(first), ALL_SEATS);
+    EXPECT_EQ(service.availableSeats(second), ALL_SEATS & ~0x01);
+    EXPECT_TRUE(service.bookBatch({{"MA", "TA", SeatSet::fromMask(0x02, MAX_SEATS), 2000},
+                                   {"MA", "TA", SeatSet::fromMask(0x02, MAX_SEATS)}}));
+    EXPECT_EQ(service.availableSeats(first), ALL_SEATS & ~0x02);
+    EXPECT_EQ(service.availableSeats(second), ALL_SEATS & ~0x03);
+
+    // a theater is listed once, however many times the movie is shown there
+    EXPECT_THAT(service.theaters("MA"), ElementsAre("TA", "TB"));
+    EXPECT_THAT(service.movies("TA"), ElementsAre("MA", "MB"));
+}
+
+TEST_F(ShowtimeTest, ranges) {
+    EXPECT_THAT(starts(service.movieShowtimes("MA", 0, 10000)), ElementsAre(1000, 1500, 2000));
+    EXPECT_THAT(starts(service.movieShowtimes("MA", 1500, 2000)), ElementsAre(1500));
+    EXPECT_THAT(starts(service.movieShowtimes("MA", 2001, 10000)), ElementsAre());
+    EXPECT_THAT(starts(service.theaterShowtimes("TA", 0, 10000)), ElementsAre(0, 1000, 2000, 3000));
+    EXPECT_THAT(starts(service.theaterShowtimes("TA", 1, 3000)), ElementsAre(1000, 2000));
+
+    auto showtimes = service.theaterShowtimes("TA", 2000, 4000);
+    ASSERT_EQ(showtimes.size(), 2);
+    EXPECT_EQ(showtimes[0].showing, service.showing("MA", "TA", 2000));
+    EXPECT_EQ(showtimes[0].movie, "MA");
+    EXPECT_EQ(showtimes[1].movie, "MB");
+    EXPECT_EQ(showtimes[1].theater, "TA");
+    EXPECT_THROW(service.movieShowtimes("MC", 0, 10000), invalid_argument);
+    EXPECT_THROW(service.theaterShowtimes("TC", 0, 10000), invalid_argument);
+
+    // the list outlives the edition it was taken from
+    service.updateCatalog({{"MA", "TA", MAX_SEATS, SEATS_PER_ROW, 1000}}, {{"MA", "TA", 100, 10, 500}});
+    EXPECT_EQ(showtimes[1].movie, "MB");
+    EXPECT_THAT(starts(service.movieShowtimes("MA", 0, 10000)), ElementsAre(500, 1500, 2000));
+    EXPECT_EQ(service.seatCount("MA", "TA"), 100);
+}
+
+TEST_F(ShowtimeTest, sameShowingTwice) {
+    br.push_back({ "MA", "TA", 0, MAX_SEATS, SEATS_PER_ROW, 1000 });
+    EXPECT_THROW(ServiceImpl(br.begin(), br.end()), invalid_argument);
+    EXPECT_THROW(service.updateCatalog({}, {{"MB", "TA", 10, 10, 3000}}), invalid_argument);
+}
+
+TEST_F(ShowtimeTest, surviveRestart) {
+    auto restart = [&] {
+        return make_unique<ServiceImpl>(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+    };
+    {
+        auto logged = restart();
+        EXPECT_TRUE(logged->book(logged->showing("MA", "TA", 2000), 0x01));
+        EXPECT_TRUE(logged->book("MA", "TA", 0x02));
+        EXPECT_NE(logged->hold(logged->showing("MB", "TA", 3000), SeatSet::fromMask(0x04, MAX_SEATS),
+                               chrono::minutes(1)), 0);
+        logged->updateCatalog({{"MA", "TB", MAX_SEATS, SEATS_PER_ROW, 1500}}, {{"MA", "TB", 100, 10, 2500}});
+        EXPECT_TRUE(logged->book(logged->showing("MA", "TB", 2500), 0x08));
+    }
+    auto check = [&](ServiceImpl& restarted) {
+        EXPECT_EQ(restarted.availableSeats(restarted.showing("MA", "TA", 2000)), ALL_SEATS & ~0x01);
+        EXPECT_EQ(restarted.availableSeats(restarted.showing("MA", "TA", 1000)), ALL_SEATS & ~0x02);
+        EXPECT_EQ(restarted.availableSeats(restarted.showing("MB", "TA", 3000)), ALL_SEATS & ~0x04);
+        EXPECT_EQ(restarted.availableSeats(restarted.showing("MA", "TB", 2500)), ~SeatMask(0x08));
+        EXPECT_THROW(restarted.showing("MA", "TB", 1500), invalid_argument);
+        EXPECT_THAT(starts(restarted.movieShowtimes("MA", 0, 10000)), ElementsAre(1000, 2000, 2500));
+    };
+    {
+        auto logged = restart();
+        check(*logged);
+        logged->checkpoint(path);
+    }
+    // the log keeps only what the snapshot has not, from the open hold on
+    EXPECT_THROW(restart(), invalid_argument);
+    check(*make_unique<ServiceImpl>(Snapshot::open(path), make_unique<WriteAheadLog>(log_path)));
+    check(*make_unique<ServiceImpl>(Snapshot::open(path)));
+}
+
+class SearchTest : public Test
+{
+protected:
+    vector<BookingRecord> br = {
+        { "Back to Black", "Cinema Paradiso", ALL_SEATS },
+        { "Back to the Future", "Cinema Paradiso", ALL_SEATS },
+        { "Dune: Part Two", "The Grand Budapest", ALL_SEATS },
+        { "Furiosa: A Mad Max Saga", "Paradise Cinema", ALL_SEATS },
+    };
+    ServiceImpl service{br.begin(), br.end()};
+    string path = (filesystem::temp_directory_path() / "bb_search_test.snap").string();
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+};
+
+TEST_F(SearchTest, searchNames) {
+    EXPECT_THAT(service.searchMovies("back", 10), ElementsAre("Back to Black", "Back to the Future"));
+    EXPECT_THAT(service.searchMovies("back", 1), ElementsAre("Back to Black"));
+    EXPECT_THAT(service.searchMovies("Part", 10), ElementsAre("Dune: Part Two"));
+    EXPECT_THAT(service.searchTheaters("paradis", 10), ElementsAre("Paradise Cinema", "Cinema Paradiso"));
+    EXPECT_THAT(service.searchTheaters("Back", 10), IsEmpty());
+    // a typo is let through from 4 bytes on, two from 8 on, and the names that match as typed come first
+    EXPECT_THAT(service.searchMovies("Dnue", 10), ElementsAre("Dune: Part Two"));
+    EXPECT_THAT(service.searchMovies("Dne", 10), IsEmpty());
+    EXPECT_THAT(service.searchMovies("Fuirosa Mad", 10), IsEmpty());
+    EXPECT_THAT(service.searchMovies("Fuirosa:", 10), ElementsAre("Furiosa: A Mad Max Saga"));
+    EXPECT_THAT(service.searchTheaters("Budapset", 10), ElementsAre("The Grand Budapest"));
+    // the names are those of the catalog
+    EXPECT_EQ(service.searchMovies("Dune", 1)[0].data(), service.movies()[2].data());
+}
+
+TEST_F(SearchTest, searchAfterChange) {
+    auto before = service.searchMovies("Dune", 10);
+    service.updateCatalog({{"Dune: Part Two", "The Grand Budapest"}}, {{"Dune", "Paradise Cinema"}});
+    EXPECT_THAT(service.searchMovies("Dune", 10), ElementsAre("Dune"));
+    EXPECT_THAT(service.searchTheaters("grand", 10), IsEmpty());
+    // the list from before the change still lists what was found then
+    EXPECT_THAT(before, ElementsAre("Dune: Part Two"));
+
+    service.checkpoint(path);
+    ServiceImpl restarted(Snapshot::open(path));
+    EXPECT_THAT(restarted.searchMovies("dune", 10), ElementsAre("Dune"));
+    EXPECT_THAT(restarted.searchTheaters("Cinema", 10), ElementsAre("Paradise Cinema", "Cinema Paradiso"));
+}
+
+}
+
+namespace {
+
+class ShardTest : public ServiceTest
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_shard_test.snap").string();
+
+    void SetUp() override
+    {
+        // more shards than showings leaves some of them empty
+        service.shard(4);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+};
+
+TEST_F(ShardTest, seatsMoved) {
+    EXPECT_EQ(service.availableSeats("MA", "TA"), 0);
+    EXPECT_EQ(service.availableSeats("MC", "TC"), 0);
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS);
+    EXPECT_TRUE(service.book("MB", "TA", 0x01));
+    EXPECT_FALSE(service.book("MB", "TA", 0x03));
+    EXPECT_TRUE(service.book(service.showing("MC", "TB"), SeatSet::fromRanges("1-3", MAX_SEATS)));
+    EXPECT_EQ(service.bookBest("MA", "TC", 2, SeatPreference::FRONT).toRanges(), "2-3");
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+    EXPECT_EQ(service.version(service.showing("MB", "TA")), 1);
+    // what the shard throws, the caller gets
+    EXPECT_THROW(service.book("MB", "TA", ~ALL_SEATS), invalid_argument);
+    EXPECT_THROW(service.bookBest("MB", "TA", 0, SeatPreference::FRONT), invalid_argument);
+
+    service.checkpoint(path);
+    ServiceImpl restarted(Snapshot::open(path));
+    EXPECT_EQ(restarted.availableSeats("MB", "TA"), ALL_SEATS & ~0x01);
+    EXPECT_EQ(restarted.availableSeats("MC", "TB"), ALL_SEATS & ~0x07);
+    EXPECT_EQ(restarted.availableSeats("MA", "TA"), 0);
+}
+
+TEST_F(ShardTest, replayedHoldsExpire) {
+    string log_path = path + ".log";
+    {
+        ServiceImpl logged(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+        EXPECT_NE(logged.hold("MB", "TA", 0x01, chrono::milliseconds(200)), 0);
+    }
+    // the hold runs out around the sharding, and its seat is released in the shard
+    ServiceImpl restarted(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+    this_thread::sleep_for(chrono::milliseconds(150));
+    restarted.shard(4);
+    for (int i = 0; i < 100 && restarted.availableSeats("MB", "TA") != ALL_SEATS; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    EXPECT_EQ(restarted.availableSeats("MB", "TA"), ALL_SEATS);
+    filesystem::remove(log_path);
+}
+
+TEST_F(ShardTest, addedShowings) {
+    service.updateCatalog({{"MA", "TC"}}, {{"MD", "TD", 100, 10}});
+    EXPECT_TRUE(service.book("MD", "TD", 0x01));
+    EXPECT_TRUE(service.book("MB", "TA", 0x01));
+    EXPECT_TRUE(service.bookBatch({{"MD", "TD", SeatSet::fromMask(0x02, 100)},
+                                   {"MB", "TA", SeatSet::fromMask(0x02, MAX_SEATS)}}));
+    EXPECT_EQ(service.availableSeatCount("MD", "TD"), 98);
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0x03);
+}
+
+TEST_F(ShardTest, bookConcurrent) {
+    // every thread books its own seats of every showing, through the shards and in batches
+    vector<thread> threads;
+    atomic<size_t> failed{0};
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i] {
+            for (size_t seat = i; seat < MAX_SEATS; seat += 4) {
+                for (auto& record : br) {
+                    string movie(record.movie_name);
+                    string theater(record.theater_name);
+                    bool booked = seat % 8 < 4 ? service.book(movie, theater, SeatMask(1) << seat)
+                                               : service.bookBatch({{movie, theater, SeatSet::fromMask(SeatMask(1) << seat, MAX_SEATS)}});
+                    failed += !booked;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // the showings that were full to start with
+    EXPECT_EQ(failed, 3 * MAX_SEATS);
+    for (auto& record : br) {
+        EXPECT_EQ(service.availableSeats(string(record.movie_name), string(record.theater_name)), 0);
+    }
+}
+
+}
+
+namespace {
+
+class HoldTest : public ServiceTest
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_hold_test.snap").string();
+    string log_path = (filesystem::temp_directory_path() / "bb_hold_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+        filesystem::remove(log_path);
+    }
+
+    unique_ptr<ServiceImpl> restart()
+    {
+        return make_unique<ServiceImpl>(br.begin(), br.end(), make_unique<WriteAheadLog>(log_path));
+    }
+};
+
+TEST_F(HoldTest, confirmAndRelease) {
+    auto held = service.hold("MA", "TC", 0x03, chrono::minutes(10));
+    EXPECT_NE(held, 0);
+    // held seats are taken for everyone else
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+    EXPECT_FALSE(service.book("MA", "TC", 0x02));
+    EXPECT_EQ(service.hold("MA", "TC", 0x06, chrono::minutes(10)), 0);
+    EXPECT_TRUE(service.confirm(held));
+    EXPECT_FALSE(service.confirm(held));
+    EXPECT_FALSE(service.release(held));
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+
+    auto released = service.hold(service.showing("MA", "TC"), SeatSet::fromRanges("5-6", MAX_SEATS), chrono::minutes(10));
+    EXPECT_NE(released, 0);
+    EXPECT_NE(released, held);
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0x33);
+    EXPECT_TRUE(service.release(released));
+    EXPECT_FALSE(service.confirm(released));
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS & ~0x03);
+    EXPECT_FALSE(service.release(12345));
+}
+
+TEST_F(HoldTest, countedOnceConfirmed) {
+    auto before = Metrics::sums();
+    auto confirmed = service.hold("MA", "TC", 0x01, chrono::minutes(10));
+    auto released = service.hold("MA", "TC", 0x02, chrono::minutes(10));
+    EXPECT_EQ(Metrics::sums().booked, before.booked);
+    EXPECT_TRUE(service.confirm(confirmed));
+    EXPECT_TRUE(service.release(released));
+    EXPECT_EQ(Metrics::sums().booked, before.booked + 1);
+    EXPECT_EQ(Metrics::sums().conflicts, before.conflicts);
+}
+
+TEST_F(HoldTest, invalidHolds) {
+    EXPECT_THROW(service.hold("MA", "TC", 0x01, chrono::milliseconds(0)), invalid_argument);
+    EXPECT_THROW(service.hold("MA", "TD", 0x01, chrono::minutes(1)), invalid_argument);
+    EXPECT_EQ(service.hold("MA", "TA", 0x01, chrono::minutes(1)), 0);
+    EXPECT_EQ(service.availableSeats("MA", "TC"), ALL_SEATS);
+}
+
+TEST_F(HoldTest, expire) {
+    auto held = service.hold("MB", "TA", 0x01, chrono::milliseconds(150));
+    auto kept = service.hold("MB", "TA", 0x02, chrono::minutes(10));
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0x03);
+    for (int i = 0; i < 500 && service.availableSeats("MB", "TA") != (ALL_SEATS & ~0x02); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    EXPECT_EQ(service.availableSeats("MB", "TA"), ALL_SEATS & ~0x02);
+    EXPECT_FALSE(service.confirm(held));
+    EXPECT_TRUE(service.confirm(kept));
+}
+
+TEST_F(HoldTest, removedShowing) {
+    auto held = service.hold("MA", "TC", 0x01, chrono::minutes(10));
+    service.updateCatalog({{"MA", "TC"}}, {});
+    // nothing left to confirm
+    EXPECT_FALSE(service.confirm(held));
+    EXPECT_FALSE(service.release(held));
+}
+
+TEST_F(HoldTest, holdsSurviveRestart) {
+    HoldId confirmed, released, open;
+    {
+        auto logged = restart();
+        confirmed = logged->hold("MA", "TC", 0x01, chrono::minutes(10));
+        released = logged->hold("MA", "TC", 0x02, chrono::minutes(10));
+        open = logged->hold("MA", "TC", 0x04, chrono::minutes(10));
+        logged->hold("MB", "TA", 0x01, chrono::milliseconds(100));
+        EXPECT_TRUE(logged->confirm(confirmed));
+        EXPECT_TRUE(logged->release(released));
+        EXPECT_TRUE(logged->book("MA", "TC", 0x08));
+    }
+    auto logged = restart();
+    EXPECT_EQ(logged->availableSeats("MA", "TC"), ALL_SEATS & ~0x0d);
+    EXPECT_FALSE(logged->release(confirmed));
+    EXPECT_FALSE(logged->release(released));
+    // the open hold is open still, and the one past its deadline expires right away
+    EXPECT_TRUE(logged->release(open));
+    EXPECT_EQ(logged->availableSeats("MA", "TC"), ALL_SEATS & ~0x09);
+    for (int i = 0; i < 500 && logged->availableSeats("MB", "TA") != ALL_SEATS; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    EXPECT_EQ(logged->availableSeats("MB", "TA"), ALL_SEATS);
+    logged = restart();
+    EXPECT_EQ(logged->availableSeats("MA", "TC"), ALL_SEATS & ~0x09);
+    EXPECT_EQ(logged->availableSeats("MB", "TA"), ALL_SEATS);
+}
+
+TEST_F(HoldTest, checkpointWithOpenHold) {
+    HoldId open;
+    {
+        auto logged = restart();
+        EXPECT_TRUE(logged->book("MB", "TA", 0x01));
+        open = logged->hold("MA", "TC", 0x01, chrono::minutes(10));
+        EXPECT_TRUE(logged->book("MB", "TA", 0x02));
+        logged->checkpoint(path);
+    }
+    // the snapshot has the held seats, and the log the hold itself
+    ServiceImpl replayed(Snapshot::open(path), make_unique<WriteAheadLog>(log_path));
+    EXPECT_EQ(replayed.availableSeats("MA", "TC"), ALL_SEATS & ~0x01);
+    EXPECT_EQ(replayed.availableSeats("MB", "TA"), ALL_SEATS & ~0x03);
+    EXPECT_TRUE(replayed.release(open));
+    EXPECT_EQ(replayed.availableSeats("MA", "TC"), ALL_SEATS);
+}
+
+TEST_F(HoldTest, holdConcurrent) {
+    // every seat ends up either booked or held and then confirmed, never both
+    atomic<size_t> booked{0}, confirmed{0};
+    vector<thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&, i] {
+            for (size_t seat = 0; seat < MAX_SEATS; ++seat) {
+                auto mask = SeatMask(1) << seat;
+                if (i % 2 == 0) {
+                    booked += service.book("MB", "TA", mask);
+                } else if (auto held = service.hold("MB", "TA", mask, chrono::minutes(1))) {
+                    if (seat % 2 == 0) {
+                        confirmed += service.confirm(held);
+                    } else {
+                        EXPECT_TRUE(service.release(held));
+                    }
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(service.availableSeatCount("MB", "TA"), MAX_SEATS - booked - confirmed);
+}
+
+}
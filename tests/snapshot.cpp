@@ -0,0 +1,101 @@
+// Test Snapshot
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/snapshot.cpp"
+
+namespace {
+
+class SnapshotTest : public ::testing::Test
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_snapshot_test.snap").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+
+    static Snapshot::Sizes sizes()
+    {
+        Snapshot::Sizes sizes{};
+        sizes[Snapshot::NAME_POOL] = 5;
+        sizes[Snapshot::MOVIE_NAMES] = 2 * sizeof(uint64_t);
+        sizes[Snapshot::SEATS] = 100 * sizeof(uint64_t);
+        return sizes;
+    }
+};
+
+TEST_F(SnapshotTest, sections) {
+    Snapshot snapshot(sizes());
+    EXPECT_EQ(snapshot.count<char>(Snapshot::NAME_POOL), 5);
+    EXPECT_EQ(snapshot.count<uint64_t>(Snapshot::MOVIE_NAMES), 2);
+    EXPECT_EQ(snapshot.count<uint32_t>(Snapshot::THEATER_SLOTS), 0);
+    EXPECT_EQ(snapshot.count<uint64_t>(Snapshot::SEATS), 100);
+    EXPECT_EQ(snapshot.logRecords(), 0);
+    for (uint32_t s = 0; s < Snapshot::SECTIONS; ++s) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(snapshot.section<char>(Snapshot::Section(s))) % CACHE_LINE_SIZE, 0);
+    }
+    auto seats = snapshot.section<uint64_t>(Snapshot::SEATS);
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(seats[i], 0);
+    }
+}
+
+TEST_F(SnapshotTest, writeAndOpen) {
+    {
+        Snapshot snapshot(sizes());
+        memcpy(snapshot.section<char>(Snapshot::NAME_POOL), "hello", 5);
+        snapshot.section<uint64_t>(Snapshot::MOVIE_NAMES)[1] = 5;
+        snapshot.section<atomic<uint64_t>>(Snapshot::SEATS)[99].store(0xbeef);
+        snapshot.write(path, 42);
+        EXPECT_FALSE(filesystem::exists(path + ".tmp"));
+    }
+    auto snapshot = Snapshot::open(path);
+    EXPECT_EQ(string(snapshot.section<char>(Snapshot::NAME_POOL), 5), "hello");
+    EXPECT_EQ(snapshot.section<uint64_t>(Snapshot::MOVIE_NAMES)[1], 5);
+    EXPECT_EQ(snapshot.count<uint64_t>(Snapshot::SEATS), 100);
+    EXPECT_EQ(snapshot.logRecords(), 42);
+
+    // the file is mapped copy-on-write
+    snapshot.section<uint64_t>(Snapshot::SEATS)[99] = 0;
+    EXPECT_EQ(Snapshot::open(path).section<uint64_t>(Snapshot::SEATS)[99], 0xbeef);
+
+    // a new snapshot replaces the old one, even while it is open
+    Snapshot(sizes()).write(path, 7);
+    EXPECT_EQ(Snapshot::open(path).logRecords(), 7);
+    EXPECT_EQ(snapshot.logRecords(), 42);
+}
+
+TEST_F(SnapshotTest, notASnapshot) {
+    EXPECT_THROW(Snapshot::open(path), system_error);
+    ofstream(path) << "not a snapshot";
+    EXPECT_THROW(Snapshot::open(path), invalid_argument);
+    ofstream{path};
+    EXPECT_THROW(Snapshot::open(path), invalid_argument);
+
+    Snapshot(sizes()).write(path, 0);
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekp(offsetof(Snapshot::Header, format));
+        uint32_t format = Snapshot::FORMAT + 1;
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    }
+    EXPECT_THROW(Snapshot::open(path), invalid_argument);
+
+    Snapshot(sizes()).write(path, 0);
+    filesystem::resize_file(path, filesystem::file_size(path) - CACHE_LINE_SIZE);
+    EXPECT_THROW(Snapshot::open(path), invalid_argument);
+}
+
+}
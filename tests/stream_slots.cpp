@@ -0,0 +1,85 @@
+// Test stream_slots.h
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/stream_slots.h"
+#include "../src/worker_pool.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(StreamSlotsTest, limited) {
+        EXPECT_EQ(StreamSlots::forWorkers(1), 1);
+        EXPECT_EQ(StreamSlots::forWorkers(8), 2);
+        EXPECT_EQ(StreamSlots::forWorkers(32), 8);
+
+        StreamSlots slots(2);
+        auto a = slots.take();
+        auto b = slots.take();
+        ASSERT_TRUE(a && b);
+        EXPECT_FALSE(slots.take());
+        EXPECT_EQ(slots.open(), 2);
+        // a slot is given back with its last copy
+        auto copy = a;
+        a.reset();
+        EXPECT_FALSE(slots.take());
+        copy.reset();
+        EXPECT_TRUE(slots.take());
+        EXPECT_EQ(slots.open(), 1);
+        slots.setLimit(1);
+        b.reset();
+        EXPECT_EQ(slots.open(), 0);
+        auto c = slots.take();
+        EXPECT_TRUE(c);
+        EXPECT_FALSE(slots.take());
+    }
+
+    TEST(StreamSlotsTest, otherRequestsServed) {
+        // many more streams asked for than there are workers, each holding its worker until the end
+        constexpr size_t WORKERS = 8;
+        WorkerPool pool(WORKERS);
+        StreamSlots slots(StreamSlots::forWorkers(WORKERS));
+        mutex m;
+        condition_variable cv;
+        bool closed = false;
+        atomic<int> streaming{0};
+        atomic<int> refused{0};
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_TRUE(pool.enqueue([&] {
+                auto slot = slots.take();
+                if (!slot) {
+                    ++refused;
+                    return;
+                }
+                ++streaming;
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&] { return closed; });
+            }));
+        }
+
+        // the rest of the workers still answer other requests while the streams are open
+        atomic<int> served{0};
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT_TRUE(pool.enqueue([&] { ++served; }));
+        }
+        for (int i = 0; i < 5000 && served < 1000; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        EXPECT_EQ(served, 1000);
+        EXPECT_EQ(streaming, StreamSlots::forWorkers(WORKERS));
+        EXPECT_EQ(streaming + refused, 100);
+        {
+            const lock_guard<mutex> lock(m);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+}
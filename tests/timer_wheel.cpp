@@ -0,0 +1,79 @@
+// Test timer_wheel.h
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/timer_wheel.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    struct Deadline : TimerWheel::Timer
+    {
+        uint64_t expired = 0;
+    };
+
+    TEST(TimerWheelTest, expireWhenDue) {
+        TimerWheel wheel(1000);
+        // due in every wheel, across the boundaries between slots and wheels, and out of reach
+        vector<uint64_t> due = {1001, 1063, 1064, 1065, 1024 + 4096, 1000 + 262144, 300000, 5000000,
+                                1000 + (uint64_t{1} << 24), 3 * (uint64_t{1} << 24) + 7};
+        mt19937_64 random(1);
+        for (int i = 0; i < 1000; ++i) {
+            due.push_back(1001 + random() % (uint64_t{1} << 20));
+        }
+        vector<Deadline> deadlines(due.size());
+        for (size_t i = 0; i < due.size(); ++i) {
+            wheel.schedule(&deadlines[i], due[i]);
+        }
+        EXPECT_EQ(wheel.size(), due.size());
+
+        auto expire = [&](TimerWheel::Timer* timer) {
+            static_cast<Deadline*>(timer)->expired = wheel.now();
+        };
+        wheel.advance(2000, expire);
+        wheel.advance(2000, expire);
+        wheel.advance(3 * (uint64_t{1} << 24) + 100, expire);
+        EXPECT_EQ(wheel.size(), 0);
+        for (size_t i = 0; i < due.size(); ++i) {
+            EXPECT_EQ(deadlines[i].expired, due[i]) << i;
+            EXPECT_FALSE(deadlines[i].scheduled());
+        }
+    }
+
+    TEST(TimerWheelTest, cancel) {
+        TimerWheel wheel;
+        Deadline kept, cancelled, far;
+        wheel.schedule(&kept, 100);
+        wheel.schedule(&cancelled, 100);
+        wheel.schedule(&far, 100000);
+        wheel.cancel(&cancelled);
+        wheel.cancel(&far);
+        wheel.cancel(&far);
+        EXPECT_EQ(wheel.size(), 1);
+        int expired = 0;
+        wheel.advance(200000, [&](TimerWheel::Timer* timer) {
+            EXPECT_EQ(timer, &kept);
+            ++expired;
+        });
+        EXPECT_EQ(expired, 1);
+    }
+
+    TEST(TimerWheelTest, pastAndAgain) {
+        TimerWheel wheel(50);
+        Deadline deadline;
+        // a deadline that has passed is due at the next tick
+        wheel.schedule(&deadline, 10);
+        vector<uint64_t> expired;
+        wheel.advance(200, [&](TimerWheel::Timer* timer) {
+            expired.push_back(wheel.now());
+            if (expired.size() < 3) {
+                wheel.schedule(timer, wheel.now() + 64);
+            }
+        });
+        EXPECT_EQ(expired, (vector<uint64_t>{51, 115, 179}));
+    }
+}
@@ -0,0 +1,167 @@
+// Test WriteAheadLog
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/wal.cpp"
+
+namespace {
+
+class WriteAheadLogTest : public ::testing::Test
+{
+protected:
+    string path = (filesystem::temp_directory_path() / "bb_wal_test.log").string();
+
+    void SetUp() override
+    {
+        filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(path);
+    }
+
+    vector<string> replay(size_t skip = 0)
+    {
+        vector<string> records;
+        WriteAheadLog log(path);
+        log.replay([&](string_view payload) { records.emplace_back(payload); }, skip);
+        return records;
+    }
+};
+
+TEST_F(WriteAheadLogTest, commitAndReplay) {
+    {
+        WriteAheadLog log(path);
+        EXPECT_EQ(log.replay([](string_view) { FAIL(); }), 0);
+        log.commit("first");
+        log.commit("");
+        log.commit(string("with\0zero", 9));
+        EXPECT_EQ(log.syncs(), 3);
+    }
+    EXPECT_EQ(replay(), (vector<string>{"first", "", string("with\0zero", 9)}));
+    // replaying does not change the log
+    EXPECT_EQ(replay().size(), 3);
+}
+
+TEST_F(WriteAheadLogTest, appendIsNotDurableUntilSynced) {
+    {
+        WriteAheadLog log(path);
+        auto lsn = log.append("synced");
+        log.sync(lsn);
+        log.append("lost");
+        EXPECT_EQ(log.syncs(), 1);
+    }
+    EXPECT_EQ(replay(), vector<string>{"synced"});
+}
+
+TEST_F(WriteAheadLogTest, tornTailIsCutOff) {
+    {
+        WriteAheadLog log(path);
+        log.commit("first");
+        log.commit("second");
+    }
+    // a crash in the middle of writing the second record
+    filesystem::resize_file(path, filesystem::file_size(path) - 3);
+    EXPECT_EQ(replay(), vector<string>{"first"});
+    {
+        WriteAheadLog log(path);
+        log.replay([](string_view) {});
+        log.commit("third");
+    }
+    EXPECT_EQ(replay(), (vector<string>{"first", "third"}));
+}
+
+TEST_F(WriteAheadLogTest, corruptRecordIsCutOff) {
+    {
+        WriteAheadLog log(path);
+        log.commit("first");
+        log.commit("second");
+        log.commit("third");
+    }
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekp(HEADER_SIZE + 5 + HEADER_SIZE);
+        file.put('S');
+    }
+    EXPECT_EQ(replay(), vector<string>{"first"});
+}
+
+TEST_F(WriteAheadLogTest, groupCommit) {
+    constexpr int THREADS = 8;
+    constexpr int COMMITS = 50;
+    {
+        WriteAheadLog log(path, chrono::microseconds(200));
+        vector<thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < COMMITS; ++i) {
+                    log.commit(to_string(t) + ':' + to_string(i));
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        // concurrent commits share their fsyncs
+        EXPECT_LT(log.syncs(), THREADS * COMMITS);
+    }
+    auto records = replay();
+    ASSERT_EQ(records.size(), THREADS * COMMITS);
+    // each thread's records are in its own order
+    vector<int> next(THREADS, 0);
+    for (auto& record : records) {
+        auto colon = record.find(':');
+        int t = stoi(record.substr(0, colon));
+        EXPECT_EQ(stoi(record.substr(colon + 1)), next[t]++);
+    }
+}
+
+TEST_F(WriteAheadLogTest, compact) {
+    {
+        WriteAheadLog log(path);
+        log.commit("first");
+        log.commit("second");
+        auto size = filesystem::file_size(path);
+        // only records on disk are dropped
+        auto lsn = log.append("third");
+        log.compact(5);
+        EXPECT_LT(filesystem::file_size(path), size);
+        log.sync(lsn);
+        log.compact(1);
+        log.commit("fourth");
+    }
+    EXPECT_EQ(replay(2), (vector<string>{"third", "fourth"}));
+    EXPECT_THROW(replay(1), invalid_argument);
+    {
+        // records go on being numbered after the ones dropped
+        WriteAheadLog log(path);
+        EXPECT_EQ(log.replay([](string_view) {}, 3), 4);
+        auto lsn = log.append("fifth");
+        EXPECT_EQ(lsn, 5);
+        log.sync(lsn);
+        log.compact(4);
+        log.compact(5);
+        EXPECT_EQ(log.append("sixth"), 6);
+        log.sync(6);
+    }
+    EXPECT_EQ(replay(5), vector<string>{"sixth"});
+    {
+        // a torn tail is cut off after the mark as well
+        filesystem::resize_file(path, filesystem::file_size(path) - 1);
+        WriteAheadLog log(path);
+        EXPECT_EQ(log.replay([](string_view) { FAIL(); }, 5), 5);
+    }
+}
+
+TEST_F(WriteAheadLogTest, cannotOpen) {
+    EXPECT_THROW(WriteAheadLog((filesystem::path(path) / "not_a_dir" / "log").string()), system_error);
+}
+
+}
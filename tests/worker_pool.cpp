@@ -0,0 +1,83 @@
+// Test worker_pool.h
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/worker_pool.h"
+
+using namespace std;
+using namespace bb;
+
+namespace {
+    TEST(WorkerPoolTest, runAll) {
+        atomic<int> done{0};
+        {
+            WorkerPool pool(4);
+            EXPECT_EQ(pool.workers(), 4);
+            for (int i = 0; i < 10000; ++i) {
+                EXPECT_TRUE(pool.enqueue([&] { ++done; }));
+            }
+        }
+        // the tasks still queued are run before the pool is gone
+        EXPECT_EQ(done, 10000);
+        EXPECT_THROW(WorkerPool(0), invalid_argument);
+    }
+
+    TEST(WorkerPoolTest, idleWorkersSteal) {
+        // every other task is dealt to the worker that is blocked, and is run by the other one
+        WorkerPool pool(2);
+        mutex m;
+        condition_variable cv;
+        bool release = false;
+        atomic<int> done{0};
+        EXPECT_TRUE(pool.enqueue([&] {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&] { return release; });
+        }));
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_TRUE(pool.enqueue([&] { ++done; }));
+        }
+        for (int i = 0; i < 5000 && done < 100; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        EXPECT_EQ(done, 100);
+        {
+            const lock_guard<mutex> lock(m);
+            release = true;
+        }
+        cv.notify_all();
+    }
+
+    TEST(WorkerPoolTest, boundedBacklog) {
+        WorkerPool pool(1, 2);
+        mutex m;
+        condition_variable cv;
+        bool started = false, release = false;
+        EXPECT_TRUE(pool.enqueue([&] {
+            unique_lock<mutex> lock(m);
+            started = true;
+            cv.notify_all();
+            cv.wait(lock, [&] { return release; });
+        }));
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&] { return started; });
+        }
+        // the worker is busy, so two may wait and the third is turned down
+        EXPECT_TRUE(pool.enqueue([] {}));
+        EXPECT_TRUE(pool.enqueue([] {}));
+        EXPECT_FALSE(pool.enqueue([] {}));
+        {
+            const lock_guard<mutex> lock(m);
+            release = true;
+        }
+        cv.notify_all();
+        pool.shutdown();
+        EXPECT_FALSE(pool.enqueue([] {}));
+    }
+}